@@ -43,6 +43,10 @@
 #pragma link C++ namespace TCUtils;
 #pragma link C++ namespace TCFitUtils;
 #pragma link C++ class TCFileManager+;
+#pragma link C++ class TCFilePool+;
+#pragma link C++ class TCHistoAccumulator+;
+#pragma link C++ class TCProgress+;
+#pragma link C++ class TCProjCache+;
 #pragma link C++ class TCReadConfig+;
 #pragma link C++ class TCConfigElement+;
 #pragma link C++ class TCReadARCalib+;
@@ -53,6 +57,10 @@
 #pragma link C++ class TCARNeighbours+;
 #pragma link C++ class TCReadACQU+;
 #pragma link C++ class TCACQUFile+;
+#pragma link C++ class TCSetIndex+;
+#pragma link C++ class TCDBConnection+;
+#pragma link C++ class TCParCacheEntry+;
+#pragma link C++ class TCParCache+;
 #pragma link C++ class TCMySQLManager+;
 #pragma link C++ class TCContainer+;
 #pragma link C++ class TCRun+;
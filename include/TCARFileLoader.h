@@ -20,6 +20,7 @@
 #include "TString.h"
 
 class TFile;
+class TCFilePool;
 
 class TCARFileLoader
 {
@@ -31,8 +32,8 @@ protected:
     Int_t* fRuns;            //[fNRuns]    list of run numbers
 
     Int_t fNFiles;                      // number of files (= number of runs)
-    TFile** fFiles;          //[fNRuns]    list of files
-    Int_t fNOpenFiles;                  // number of files opend
+    TCFilePool* fFilePool;              // pool of files (index = run index)
+    Int_t fNOpenFiles;                  // number of files found
 
     void ResetInputFilePathPatt() { if (fInputFilePathPatt) delete fInputFilePathPatt; fInputFilePathPatt = 0; };
     void ResetRunsList() { if (fRuns) delete [] fRuns; fNRuns = 0; fRuns = 0; };
@@ -44,7 +45,7 @@ public:
     TCARFileLoader()
       : fInputFilePathPatt(0),
         fNRuns(0), fRuns(0),
-        fNFiles(0), fFiles(0),
+        fNFiles(0), fFilePool(0),
         fNOpenFiles(0) { };
     TCARFileLoader(const Char_t* inputfilepathpatt);
     TCARFileLoader(Int_t nruns, const Int_t* runs, const Char_t* inputfilepathpatt = 0);
@@ -71,10 +72,16 @@ public:
     const Int_t* GetRuns() const { return fRuns; };
 
     Int_t GetNFiles() const { return fNFiles; };
-    TFile * const * GetFiles() const { return fFiles; };
+    TFile * const * GetFiles() const;
+    TFile* GetFile(Int_t index);
+    TFile* AcquireFile(Int_t index);
+    void ReleaseFile(Int_t index);
+    Bool_t HasFile(Int_t index) const;
+    const Char_t* GetFileName(Int_t index) const;
     Int_t GetNOpenFiles() const { return fNOpenFiles; };
+    const TCFilePool* GetFilePool() const { return fFilePool; };
 
-    Bool_t LoadFiles() { return fFiles ? kTRUE : CreateFileList(); };
+    Bool_t LoadFiles() { return fFilePool ? kTRUE : CreateFileList(); };
 
     Int_t FindRunIndex(Int_t run) const;
 
@@ -20,6 +20,7 @@
 
 class TH1;
 class TH2D;
+class TObject;
 
 class TCARHistoLoader : public TCARFileLoader
 {
@@ -27,6 +28,14 @@ class TCARHistoLoader : public TCARFileLoader
 private:
     TDirectory* fHistoDirectory;        // histo ownership
 
+    Int_t fNPrefetch;                   // number of objects read per file in one pass
+    TString* fPrefetch;  //[fNPrefetch]    names of objects read per file in one pass
+    TString fBatchFile;                 // file of the objects read in one pass
+    TObject** fBatch;    //[fNPrefetch]    objects read in one pass (not handed out yet)
+
+    void ClearBatch();
+    TObject* TakeFromBatch(const Char_t* name, Int_t index);
+
 protected:
 
     void SetHistoName(TH1* h, const Char_t* hnamepatt, Int_t index);
@@ -36,17 +45,24 @@ public:
 
     TCARHistoLoader()
       : TCARFileLoader(),
-        fHistoDirectory(0) { }
+        fHistoDirectory(0),
+        fNPrefetch(0), fPrefetch(0), fBatchFile(), fBatch(0) { }
     TCARHistoLoader(const Char_t* inputfilepathpatt)
       : TCARFileLoader(inputfilepathpatt),
-        fHistoDirectory(0) { }
+        fHistoDirectory(0),
+        fNPrefetch(0), fPrefetch(0), fBatchFile(), fBatch(0) { }
     TCARHistoLoader(Int_t nruns, const Int_t* runs, const Char_t* inputfilepathpatt = 0)
       : TCARFileLoader(nruns, runs, inputfilepathpatt),
-        fHistoDirectory(0) { }
-    virtual ~TCARHistoLoader() { }
+        fHistoDirectory(0),
+        fNPrefetch(0), fPrefetch(0), fBatchFile(), fBatch(0) { }
+    virtual ~TCARHistoLoader();
 
     static TH1* GetHisto(const TFile* f, const Char_t* hname, Bool_t detach = kTRUE);
     static TH1** GetHistos(const TFile* f, const Char_t* hpatt, Int_t& nhistos, Bool_t detach = kTRUE);
+    static TObject** GetObjects(TFile* f, Int_t n, const Char_t* const* names, Bool_t detach = kTRUE);
+
+    void SetPrefetchList(Int_t n, const Char_t* const* names);
+    Int_t GetNPrefetch() const { return fNPrefetch; };
 
     void SetHistoDirectory(TDirectory* histodir) { fHistoDirectory = histodir; };
     const TDirectory* GetHistoDirectory() const { return fHistoDirectory; };
@@ -57,6 +73,9 @@ public:
     TH1** GetHistosForRun(const Char_t* hpatt, Int_t runnumber, Int_t& nhistos, const Char_t* houtnamepatt = 0);
     TH1** GetHistosForIndex(const Char_t* hpatt, Int_t index, Int_t& nhistos, const Char_t* houtnamepatt = 0);
 
+    TObject** GetObjectsForRun(Int_t runnumber, Int_t n, const Char_t* const* names);
+    TObject** GetObjectsForIndex(Int_t index, Int_t n, const Char_t* const* names);
+
     TH1* CreateHistoSum(const Char_t* hname, const Char_t* houtnamepatt = 0);
 
     TH1** CreateHistoArray(const Char_t* hname, const Char_t* houtnamepatt = 0);
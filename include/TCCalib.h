@@ -20,6 +20,8 @@ class TH1;
 class TF1;
 class TCanvas;
 class TCLine;
+class TThread;
+class TCProjCache;
 
 class TCCalib : public TNamed
 {
@@ -43,6 +45,9 @@ protected:
     TH1* fFitHisto;                 // fitting histogram
     TF1* fFitFunc;                  // fitting function
     TCLine* fLine;                  // indicator line
+    TCProjCache* fProjCache;        // projections of the main histogram
+    TH1* fProjCacheHisto;           // main histogram of the projection cache
+    Double_t fProjCacheEntries;     // number of entries of the main histogram of the projection cache
 
     TH1* fOverviewHisto;            // overview result histogram
 
@@ -57,9 +62,28 @@ protected:
     Int_t fNIgnore;                 // number of elements to ignore
     Int_t* fIgnore;                 // list of elements to ignore
 
+    TThread* fWriter;               // background database writer
+    TTimer* fWriteTimer;            // timer checking the background writer
+    Double_t* fWriteVal;            //[fNelem] values written by the background writer
+    volatile Bool_t fWriting;       // background writer running state
+    Bool_t fWriteOk;                // result of the last database write
+
+    Bool_t fIsBatch;                // batch mode flag (no interactive processing)
+    TString fMinimizer;             // minimizer of the batch fits (empty: default)
+
+    static void* WriteThread(void* arg);
+    static void* BatchThread(void* arg);
+
     virtual void Init() = 0;
     virtual void Fit(Int_t elem) = 0;
     virtual void Calculate(Int_t elem) = 0;
+    virtual Bool_t HasFitElement() const { return kFALSE; }
+    virtual Bool_t FitElement(Int_t elem, TH1* h, Double_t& pos) { return kFALSE; }
+    const Char_t* GetMinimizer() const { return fMinimizer.Length() ? fMinimizer.Data() : 0; }
+    virtual void SetFitResult(Int_t elem, Bool_t fitted, Double_t pos) { }
+    TCProjCache* GetProjCache();
+    void ClearProjCache();
+    TH1* GetProjection(Int_t elem, TH1*& h, const Char_t* name);
     void SaveCanvas(TCanvas* c, const Char_t* name);
     Bool_t IsIgnored(Int_t elem);
 
@@ -73,12 +97,15 @@ public:
                 fAvr(0), fAvrDiff(0), fNcalc(0),
                 fConvergenceFactor(1),
                 fMainHisto(0), fFitHisto(0), fFitFunc(0),
-                fLine(0),
+                fLine(0), fProjCache(0), fProjCacheHisto(0), fProjCacheEntries(0),
                 fOverviewHisto(0),
                 fCanvasFit(0), fCanvasResult(0),
                 fTimer(0), fTimerRunning(kFALSE),
                 fIsReFit(kFALSE),
-                fNIgnore(0), fIgnore(0) { }
+                fNIgnore(0), fIgnore(0),
+                fWriter(0), fWriteTimer(0), fWriteVal(0),
+                fWriting(kFALSE), fWriteOk(kFALSE),
+                fIsBatch(kFALSE), fMinimizer() { }
     TCCalib(const Char_t* name, const Char_t* title,
             const Char_t* data, Int_t nElem)
         : TNamed(name, title),
@@ -89,20 +116,29 @@ public:
           fOldVal(0), fNewVal(0),
           fAvr(0), fAvrDiff(0), fNcalc(0),
           fMainHisto(0), fFitHisto(0), fFitFunc(0),
-          fLine(0),
+          fLine(0), fProjCache(0), fProjCacheHisto(0), fProjCacheEntries(0),
           fOverviewHisto(0),
           fCanvasFit(0), fCanvasResult(0),
           fTimer(0), fTimerRunning(kFALSE),
           fIsReFit(kFALSE),
-          fNIgnore(0), fIgnore(0) { }
+          fNIgnore(0), fIgnore(0),
+          fWriter(0), fWriteTimer(0), fWriteVal(0),
+          fWriting(kFALSE), fWriteOk(kFALSE),
+          fIsBatch(kFALSE), fMinimizer() { }
     virtual ~TCCalib();
 
     virtual void WriteValues();
+    Bool_t IsWriting() const { return fWriter != 0; }
+    Bool_t WaitForWrite();
+    void CheckWrite();
     virtual void PrintValues();
     virtual void PrintValuesChanged();
 
     void Start(const Char_t* calibration, Int_t nSet, Int_t* set);
+    void StartBatch(const Char_t* calibration, Int_t nSet, Int_t* set);
     void ProcessAll(Int_t msecDelay = 0);
+    Int_t ProcessBatch();
+    Bool_t IsBatch() const { return fIsBatch; }
     void ProcessElement(Int_t elem, Bool_t ignorePrev = kFALSE);
     void Previous();
     void Next();
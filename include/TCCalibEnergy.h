@@ -19,21 +19,30 @@
 #include "TCReadConfig.h"
 
 class TCLine;
+class TRandom;
 
 class TCCalibEnergy : public TCCalib
 {
 
 private:
     Double_t fPi0Pos;                   // pi0 position
+    Bool_t fIsFitted;                   // fit of the current element performed
+    Double_t fEstMaxChi2;               // max. chi2/ndf of the peak estimate to skip the fit
     TCLine* fLine;                      // indicator line
 
     virtual void Init();
     virtual void Fit(Int_t elem);
     virtual void Calculate(Int_t elem);
     virtual void ReCalculateAll();
+    Double_t FitPeak(TH1* h, TF1* f, Double_t pos, Bool_t refit, TRandom* rnd = 0,
+                     Int_t nThreads = 1, const Char_t* minimizer = 0);
+
+    virtual Bool_t HasFitElement() const { return kTRUE; }
+    virtual Bool_t FitElement(Int_t elem, TH1* h, Double_t& pos);
+    virtual void SetFitResult(Int_t elem, Bool_t fitted, Double_t pos);
 
 public:
-    TCCalibEnergy() : TCCalib(), fPi0Pos(0), fLine(0) { }
+    TCCalibEnergy() : TCCalib(), fPi0Pos(0), fIsFitted(kFALSE), fEstMaxChi2(0), fLine(0) { }
     TCCalibEnergy(const Char_t* name, const Char_t* title, const Char_t* data,
                   Int_t nElem);
     virtual ~TCCalibEnergy();
@@ -22,13 +22,20 @@ class TCCalibPeakFit : public TCCalib
 
 private:
     Double_t fMean;                     // mean time position
+    Bool_t fIsFitted;                   // fit of the current element performed
+    Double_t fEstMaxChi2;               // max. chi2/ndf of the peak estimate to skip the fit
 
     virtual void Init();
     virtual void Fit(Int_t elem);
     virtual void Calculate(Int_t elem);
+    Double_t FitPeak(TH1* h, TF1* f, Double_t mean, Double_t max, const Char_t* minimizer = 0) const;
+
+    virtual Bool_t HasFitElement() const { return kTRUE; }
+    virtual Bool_t FitElement(Int_t elem, TH1* h, Double_t& pos);
+    virtual void SetFitResult(Int_t elem, Bool_t fitted, Double_t pos);
 
 public:
-    TCCalibPeakFit() : TCCalib(), fMean(0) { }
+    TCCalibPeakFit() : TCCalib(), fMean(0), fIsFitted(kFALSE), fEstMaxChi2(0) { }
     TCCalibPeakFit(const Char_t* name, const Char_t* title, const Char_t* data,
                    Int_t nElem);
     virtual ~TCCalibPeakFit();
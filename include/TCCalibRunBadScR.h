@@ -25,8 +25,11 @@ class TLine;
 class TH1;
 class TH2;
 class TCanvas;
+class TCBadElement;
 class TCBadScRElement;
 class TCARHistoLoader;
+class TThread;
+class TMutex;
 
 class TCCalibRunBadScR : public TCCalibRun
 {
@@ -36,6 +39,13 @@ protected:
 
     TCARHistoLoader* fHistoLoader;      //         histo loader
     Bool_t fLoadHistosInAdvance;        //         load histos in advance (and keep in memory)
+    Long64_t fMainCacheMax;             //         memory budget of the main histo cache [byte] (0: no cache)
+    Long64_t fMainCacheSize;            //         memory used by the cached main histos [byte]
+    Int_t* fMainCacheAge;               //[fNRuns] last use of the cached main histos (0: not cached)
+    Int_t fMainCacheClock;              //         use counter of the main histo cache
+    TThread* fPrefetcher;               //!        background reader of the neighbouring main histos
+    Int_t fPrefetchIndex[2];            //!        indices of the runs read in the background (-1: none)
+    TH2* fPrefetchHistos[2];            //!        main histos read in the background
 
     const Char_t* fMainHistoName;       //         name of main histo
     const Char_t* fScalerHistoName;     //         name of scaler histo
@@ -80,14 +90,28 @@ protected:
     TCanvas* fCanvasOverview;           //         overview canvas
 
     const Char_t* fCalibMethod;         //         automatic calibration method name
+    Double_t fMedianTol;                //         relative tolerance of the median method
+    Double_t fMedianNMAD;               //         tolerance of the median method in units of the MAD (0: off)
+    Bool_t fIsBatch;                    //         batch mode flag (no graphics)
 
     //---------------------------- member methods ------------------------------
 
     void CleanUp();
     void LoadHistos(Int_t i);
     void LoadScalerHistos(Int_t i);
+    void ProjectScalerHistos(Int_t i, TH2* hsc);
+    void PreprocessRun(Int_t i, Bool_t loadScaler, Int_t& nscrEvent, TMutex* mutex);
+    static void* PreprocessThread(void* arg);
+    static void* DetectThread(void* arg);
     void NormalizeHisto(Int_t i);
 
+    inline Bool_t IsCached() const { return !fLoadHistosInAdvance && fMainCacheMax > 0; }
+    static Long64_t GetHistoSize(TH1* h);
+    void CacheMainHisto(Int_t i);
+    void StartPrefetch(Int_t i);
+    void WaitForPrefetch();
+    static void* PrefetchThread(void* arg);
+
     void SetBadScalerReads(Int_t bscr1, Int_t bscr2);
     void SetBadScalerRead(Int_t bscr);
 
@@ -95,6 +119,7 @@ protected:
     void ChangeInterval(Int_t i);
 
     virtual void CalibMethodDefault();
+    virtual void CalibMethodMedian();
 
     void UpdateOverviewHisto();
 
@@ -115,6 +140,8 @@ public:
     TCCalibRunBadScR()
       : TCCalibRun(),
         fHistoLoader(0), fLoadHistosInAdvance(kTRUE),
+        fMainCacheMax(0), fMainCacheSize(0), fMainCacheAge(0), fMainCacheClock(0),
+        fPrefetcher(0),
         fMainHistoName(0), fScalerHistoName(0),
         fMainHistos(0), fProjHistos(0), fProjNormHistos(0),
         fScalerP2Histos(0), fScalerLiveHistos(), fScalerFreeHistos(0),
@@ -129,10 +156,16 @@ public:
         fRunMarker(0),
         fLastMouseBin(0), fUserInterval(100), fUserLastInterval(1),
         fCanvasMain(0), fCanvasOverview(0),
-        fCalibMethod(0) { }
+        fCalibMethod(0), fMedianTol(0.1), fMedianNMAD(0), fIsBatch(kFALSE)
+    {
+        fPrefetchIndex[0] = fPrefetchIndex[1] = -1;
+        fPrefetchHistos[0] = fPrefetchHistos[1] = 0;
+    }
     TCCalibRunBadScR(const Char_t* name, const Char_t* title, const Char_t* data, Bool_t istruecalib)
       : TCCalibRun(name, title, data, istruecalib),
         fHistoLoader(0), fLoadHistosInAdvance(kTRUE),
+        fMainCacheMax(0), fMainCacheSize(0), fMainCacheAge(0), fMainCacheClock(0),
+        fPrefetcher(0),
         fMainHistoName(0), fScalerHistoName(0),
         fMainHistos(0), fProjHistos(0), fProjNormHistos(0),
         fScalerP2Histos(0), fScalerLiveHistos(), fScalerFreeHistos(0),
@@ -147,11 +180,22 @@ public:
         fRunMarker(0),
         fLastMouseBin(0), fUserInterval(100), fUserLastInterval(1),
         fCanvasMain(0), fCanvasOverview(0),
-        fCalibMethod(0) { }
+        fCalibMethod(0), fMedianTol(0.1), fMedianNMAD(0), fIsBatch(kFALSE)
+    {
+        fPrefetchIndex[0] = fPrefetchIndex[1] = -1;
+        fPrefetchHistos[0] = fPrefetchHistos[1] = 0;
+    }
     virtual ~TCCalibRunBadScR();
 
     virtual Bool_t Write();
 
+    // batch functions
+    static Int_t FindBadScR(TH1* h, const TCBadElement* badscr, Int_t* bad,
+                            Double_t tol = 0.1, Double_t nmad = 0);
+    Int_t DetectAll();
+    Bool_t ProcessBatch(const Char_t* calibration, Bool_t write = kTRUE);
+    Bool_t IsBatch() const { return fIsBatch; }
+
     virtual void EventHandler(Int_t event, Int_t ox, Int_t oy, TObject* selected);
 
     ClassDef(TCCalibRunBadScR, 0) // Bad scaler read calibration module class
@@ -45,6 +45,8 @@ namespace TCConfig
     extern const Char_t* kCalibMainTableFormat;
     extern const Char_t* kCalibDataTableHeader;
     extern const Char_t* kCalibDataTableSettings;
+    extern const Char_t* kBadScRTableName;
+    extern const Char_t* kBadScRTableFormat;
 
     // version numbers etc.
     extern const Char_t kCaLibVersion[];
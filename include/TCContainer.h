@@ -15,6 +15,7 @@
 #define TCCONTAINER_H
 
 #include "TNamed.h"
+#include "TString.h"
 
 class TCRun : public TObject
 {
@@ -158,6 +159,9 @@ public:
     Int_t GetNParameters() const { return fNpar; }
     Double_t* GetParameters() const { return fPar; }
 
+    virtual const Char_t* GetName() const { return fData; }
+    virtual ULong_t Hash() const { return TString(fData).Hash(); }
+
     virtual void Print(Option_t* option = "") const
     {
         printf("CaLib Calibration Information\n");
@@ -17,30 +17,57 @@
 #include "TString.h"
 
 class TList;
+class THashList;
 class TH1;
+class TNamed;
+class TFile;
+class TCFilePool;
+struct TCFileManagerSparse;
 
 class TCFileManager
 {
 
 private:
     TString fInputFilePatt;                 // input file pattern
-    TList* fFiles;                          // list of files
+    TCFilePool* fFiles;                     // pool of files
     TString fCalibData;                     // calibration data
     TString fCalibration;                   // calibration identifier
     Int_t fNset;                            // number of sets
     Int_t* fSet;                            //[fNset] array of set numbers
+    Int_t fNThreads;                        // number of threads for file access
+    TString fCacheDir;                      // directory of the summed histogram cache
 
     void BuildFileList();
+    void RunParallel(Int_t n, const TString* names, TFile** files, const Int_t* index = 0,
+                     const Char_t* histo = 0, TH1** histos = 0, TCFileManagerSparse** sparse = 0,
+                     Bool_t keepFirst = kFALSE);
+    static Bool_t AddSparse(TH1* hOut, TCFileManagerSparse* sp);
+    TH1* SumHistograms(const Char_t* name, Int_t n, const Int_t* index, TH1* hOut = 0);
+    THashList* BuildManifest() const;
+    TH1* ReadCache(const Char_t* name, THashList* manifest, Int_t* outNew, Int_t& outNNew);
+    void WriteCache(const Char_t* name, TH1* h, THashList* manifest);
 
 public:
     TCFileManager() : fInputFilePatt(0), fFiles(0),
-                      fCalibData(), fCalibration(), fNset(0), fSet(0) { }
+                      fCalibData(), fCalibration(), fNset(0), fSet(0), fNThreads(1),
+                      fCacheDir() { }
     TCFileManager(const Char_t* data, const Char_t* calibration,
                   Int_t nSet, Int_t* set, const Char_t* filePat = 0);
     virtual ~TCFileManager();
 
+    void SetNThreads(Int_t n) { fNThreads = n > 0 ? n : 1; }
+    Int_t GetNThreads() const { return fNThreads; }
+    const TCFilePool* GetFilePool() const { return fFiles; }
     TH1* GetHistogram(const Char_t* name);
 
+    static TString GetCacheKey(const Char_t* filePat, const Char_t* data, const Char_t* calibration,
+                               Int_t nSet, const Int_t* set, const Char_t* name);
+    static TString GetCacheFileName(const Char_t* dir, const Char_t* name, const Char_t* key);
+    static TNamed* CreateManifestEntry(const Char_t* fileName);
+    static TH1* ReadCacheFile(const Char_t* fileName, const Char_t* key, THashList** outManifest);
+    static Bool_t WriteCacheFile(const Char_t* fileName, const Char_t* key, TH1* h,
+                                 THashList* manifest);
+
     ClassDef(TCFileManager, 0) // Histogram building class
 };
 
@@ -0,0 +1,70 @@
+/*************************************************************************
+ * Author: Dominik Werthmueller, Irakli Keshelashvili, Thomas Strub
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TCFilePool                                                           //
+//                                                                      //
+// Pool of lazily opened ROOT files.                                    //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TCFILEPOOL_H
+#define TCFILEPOOL_H
+
+#include "TString.h"
+
+class TFile;
+class TMutex;
+
+class TCFilePool
+{
+
+private:
+    Int_t fN;                   // number of files
+    Int_t fSize;                // size of the arrays
+    TString* fNames;            //[fN] file names (empty: no file)
+    TFile** fFiles;             //[fN] open files (0: closed)
+    Int_t* fPinned;             //[fN] number of users of the files
+    Int_t* fPrev;               //[fN] next more recently used open file
+    Int_t* fNext;               //[fN] next less recently used open file
+    Int_t fHead;                // most recently used open file
+    Int_t fTail;                // least recently used open file
+    Int_t fMaxOpen;             // maximum number of open files (0: unlimited)
+    Int_t fNOpen;               // number of open files
+    Long64_t fNOpened;          // number of file openings
+    Long64_t fNClosed;          // number of file closings
+    TMutex* fMutex;             // access mutex
+
+    void Expand(Int_t size);
+    void Link(Int_t i);
+    void Unlink(Int_t i);
+    void CloseUnused();
+
+public:
+    TCFilePool(Int_t maxOpen = 0);
+    virtual ~TCFilePool();
+
+    void SetMaxOpen(Int_t n);
+    Int_t GetMaxOpen() const { return fMaxOpen; }
+    Int_t GetN() const { return fN; }
+    Int_t GetNOpen() const { return fNOpen; }
+    Long64_t GetNOpened() const { return fNOpened; }
+    Long64_t GetNClosed() const { return fNClosed; }
+    const Char_t* GetFileName(Int_t i) const;
+    Bool_t HasFile(Int_t i) const;
+    TFile* const* GetFiles() const { return fFiles; }
+
+    Int_t Add(const Char_t* name, TFile* f = 0);
+    TFile* Acquire(Int_t i);
+    void Release(Int_t i);
+    TFile* Get(Int_t i);
+    void Clear();
+
+    ClassDef(TCFilePool, 0) // Pool of lazily opened ROOT files
+};
+
+#endif
+
@@ -20,13 +20,18 @@
 
 class TH1;
 class TF1;
+class TRandom;
 
 namespace TCFitUtils
 {
-    Bool_t ReFit(TH1* h, TF1* f, Option_t* option = "", Int_t n = 10);
+    Bool_t ReFit(TH1* h, TF1* f, Option_t* option = "", Int_t n = 10, TRandom* rnd = 0,
+                 Bool_t gausPol = kFALSE, Int_t nThreads = 1, const Char_t* minimizer = 0);
+    Int_t FitGausPol(TH1* h, TF1* f, Option_t* option = "", const Char_t* minimizer = 0);
     TF1* GetBestChi2Func(TF1* f1, TF1* f);
-    void RandomizeParameter(TF1* f, Int_t i);
-    void RandomizeParameters(TF1* f, Bool_t* isrand = 0);
+    void RandomizeParameter(TF1* f, Int_t i, TRandom* rnd = 0);
+    void RandomizeParameters(TF1* f, Bool_t* isrand = 0, TRandom* rnd = 0);
+    Double_t EstimatePeak(TH1* h, Double_t xmin, Double_t xmax, Double_t* outPar, Int_t* outNDF = 0);
+    Bool_t EstimateFit(TH1* h, TF1* f, Double_t maxChi2);
 }
 
 #endif
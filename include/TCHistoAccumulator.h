@@ -0,0 +1,73 @@
+/*************************************************************************
+ * Author: Dominik Werthmueller, Irakli Keshelashvili, Thomas Strub
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TCHistoAccumulator                                                   //
+//                                                                      //
+// Run-by-run histogram accumulation class.                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TCHISTOACCUMULATOR_H
+#define TCHISTOACCUMULATOR_H
+
+#include "TObject.h"
+#include "TString.h"
+
+class TList;
+class TObjArray;
+class THashList;
+class TTimer;
+class TH1;
+
+class TCHistoAccumulator : public TObject
+{
+
+private:
+    TString fInputFilePatt;                 // input file pattern
+    TString fCalibData;                     // calibration data
+    TString fCalibration;                   // calibration identifier
+    Int_t fNset;                            // number of sets
+    Int_t* fSet;                            //[fNset] array of set numbers
+    TString fCheckpointDir;                 // checkpoint directory
+    Int_t fMinAge;                          // minimum age of files to add [s]
+    TList* fNames;                          // names of the histograms
+    TObjArray* fSums;                       // summed histograms
+    TObjArray* fManifests;                  // manifests of the summed files
+    TTimer* fTimer;                         // watch timer
+
+    TString GetCacheKey(const Char_t* name) const;
+    void ReadCheckpoint(Int_t i);
+    void ResetHistogram(Int_t i);
+
+public:
+    TCHistoAccumulator() : TObject(),
+                           fInputFilePatt(), fCalibData(), fCalibration(),
+                           fNset(0), fSet(0), fCheckpointDir(), fMinAge(0),
+                           fNames(0), fSums(0), fManifests(0), fTimer(0) { }
+    TCHistoAccumulator(const Char_t* data, const Char_t* calibration,
+                       Int_t nSet, Int_t* set, const Char_t* filePat = 0);
+    virtual ~TCHistoAccumulator();
+
+    void SetCheckpointDir(const Char_t* dir) { fCheckpointDir = dir; }
+    void SetMinAge(Int_t age) { fMinAge = age; }
+    const Char_t* GetCheckpointDir() const { return fCheckpointDir.Data(); }
+    Int_t GetMinAge() const { return fMinAge; }
+
+    void AddHistogram(const Char_t* name);
+    TH1* GetHistogram(const Char_t* name) const;
+    Int_t GetNFiles(const Char_t* name) const;
+
+    Int_t Update();
+    Bool_t Checkpoint();
+    void Watch(Long_t interval);
+    virtual Bool_t HandleTimer(TTimer* timer);
+
+    ClassDef(TCHistoAccumulator, 0) // Run-by-run histogram accumulation class
+};
+
+#endif
+
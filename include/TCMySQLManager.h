@@ -14,16 +14,26 @@
 #ifndef TCMYSQLMANAGER_H
 #define TCMYSQLMANAGER_H
 
+#include "TObject.h"
+#include "TString.h"
+
 #include "TCConfig.h"
+#include "TCSetIndex.h"
 
 class TSQLServer;
 class TSQLResult;
+class TSQLStatement;
+class TMutex;
 class THashList;
 class TList;
+class TCollection;
 class TCBadScRElement;
 class TCContainer;
+class TCRun;
 class TCCalibType;
 class TCCalibData;
+class TCCalibration;
+class TCParCache;
 
 enum EServerType {
     kNoType,
@@ -32,22 +42,106 @@ enum EServerType {
 };
 typedef EServerType ServerType_t;
 
+enum EParStorage {
+    kParColumns,        // one DOUBLE column per parameter
+    kParBlob            // all parameters packed in one BLOB column
+};
+typedef EParStorage ParStorage_t;
+
+// run handler function used by TCMySQLManager::ForEachRun()
+typedef void (*RunHandler_t)(TCRun* run, void* arg);
+
+class TCDBConnection : public TObject
+{
+
+private:
+    TSQLServer* fServer;        // database connection
+    Long_t fThread;             // id of the thread using the connection
+
+public:
+    TCDBConnection() : TObject(), fServer(0), fThread(0) { }
+    TCDBConnection(TSQLServer* server, Long_t thread)
+        : TObject(), fServer(server), fThread(thread) { }
+    virtual ~TCDBConnection() { }
+
+    void SetThread(Long_t thread) { fThread = thread; }
+
+    TSQLServer* GetServer() const { return fServer; }
+    Long_t GetThread() const { return fThread; }
+
+    ClassDef(TCDBConnection, 0) // Pooled database connection
+};
+
 class TCMySQLManager
 {
 
 private:
-    TSQLServer* fDB;                            // SQL database connection
+    // parameter statement types
+    enum EParStatement {
+        kParSelect,
+        kParSelectSet,
+        kParSelectAll,
+        kParUpdate,
+        kParInsert
+    };
+
+    TSQLServer* fDB;                            // SQL database connection (main thread)
+    TString fDBUrl;                             // URL of the database
+    TString fDBUser;                            // database user
+    TString fDBPass;                            // database password
+    Long_t fMainThread;                         // id of the thread owning the main connection
+    TList* fConnBusy;                           // connections used by other threads
+    TList* fConnIdle;                           // idle pooled connections
+    Int_t fPoolSize;                            // maximum number of idle pooled connections
+    Int_t fRetries;                             // number of reconnection attempts
+    Int_t fRetryDelay;                          // initial delay between reconnection attempts [ms]
+    TMutex* fMutex;                             // mutex for the caches and the pool
     ServerType_t fDBType;                       // server type
+    ParStorage_t fParStorage;                   // parameter storage mode of new data tables
+    THashList* fTableStorage;                   // parameter storage modes of the existing data tables
+    Bool_t fBadScRTable;                        // bad scaler reads are stored in their own table
     Bool_t fSilence;                            // silence mode toggle
     THashList* fData;                           // calibration data
     THashList* fTypes;                          // calibration types
+    THashList* fSetIndex;                       // cached run interval indices of the sets
+    UInt_t fSetIndexGen;                        // incremented when set indices are removed
+    THashList* fStmtCache;                      // cached SQL of the parameter statements
+    Int_t fTransDepth;                          // depth of nested transactions
+    Int_t fBatchSize;                           // number of rows per bulk write transaction
+    TCParCache* fParCache;                      // local parameter cache file
     static TCMySQLManager* fgMySQLManager;      // pointer to static instance of this class
 
     Bool_t ReadCaLibData();
     Bool_t ReadCaLibTypes();
 
+    TSQLServer* Connect(Bool_t readOnly = kFALSE);
+    TSQLServer* GetConnection();
+    Bool_t IsMainThread() const;
+    Bool_t CheckConnection(TSQLServer* server) const;
+    Bool_t IsConnectionLost(TSQLServer* server) const;
+
     TSQLResult* SendQuery(const Char_t* query);
     Bool_t SendExec(const Char_t* sql);
+    TSQLStatement* PrepareStatement(const Char_t* sql);
+    TSQLStatement* PrepareBindStatement(const Char_t* sql);
+    const Char_t* GetParameterSQL(EParStatement type, const Char_t* table, Int_t length);
+    TString QuoteString(const Char_t* str) const;
+
+    void DetectParStorage();
+    ParStorage_t GetTableStorage(const Char_t* table) const;
+    void SetTableStorage(const Char_t* table, ParStorage_t storage);
+    void DetectBadScRStorage();
+    void ReadParStorageConfig();
+    Bool_t ConvertDataTableToBlob(TCCalibData* data);
+    void CreateDataTableTrigger(const Char_t* table);
+    static void PackParameters(const Double_t* par, Int_t n, Char_t* outBuffer);
+    static void UnpackParameters(const Char_t* buffer, Int_t n, Double_t* outPar);
+
+    Bool_t BeginTransaction();
+    Bool_t CommitTransaction();
+    Bool_t RollbackTransaction();
+    Int_t BulkInsert(const Char_t* table, const Char_t* columns, TList* rows,
+                     Bool_t* outAdded = 0);
 
     Bool_t SearchTable(const Char_t* data, Char_t* outTableName);
     Bool_t SearchRunEntry(Int_t run, const Char_t* name, TString& outInfo);
@@ -55,6 +149,11 @@ private:
                           const Char_t* name, Char_t* outInfo);
     TList* SearchDistinctEntries(const Char_t* field, const Char_t* table);
 
+    Bool_t LoadSetIndex(const Char_t* data, const Char_t* calibration);
+    TCSetIndex* GetSetIndex(const Char_t* data, const Char_t* calibration);
+    void ClearSetIndex(const Char_t* data = 0, const Char_t* calibration = 0,
+                       Int_t nSet = 0, const Int_t* firstRun = 0);
+
     Bool_t ChangeRunEntries(Int_t first_run, Int_t last_run,
                             const Char_t* name, const Char_t* value);
     Bool_t ChangeSetEntry(const Char_t* data, const Char_t* calibration, Int_t set,
@@ -65,13 +164,30 @@ private:
                       Bool_t skipChecks = kFALSE);
     Bool_t AddDataSet(const Char_t* data, const Char_t* calibration, const Char_t* desc,
                       Int_t first_run, Int_t last_run, Double_t par);
+    Bool_t CheckRunRanges(TCollection* sets);
     Bool_t RemoveDataSet(const Char_t* data, const Char_t* calibration, Int_t set);
     Bool_t SplitDataSet(const Char_t* data, const Char_t* calibration, Int_t set,
                         Int_t lastRunFirstSet);
     Bool_t MergeDataSets(const Char_t* data, const Char_t* calibration,
                          Int_t set1, Int_t set2);
 
+    TSQLStatement* QueryRuns(Int_t first_run, Int_t last_run);
+    void FillRun(TCRun* run, TSQLStatement* stmt);
+
+    TCCalibration* ReadSetRow(TCCalibData* data, const Char_t* calibration, TSQLStatement* stmt);
+    TCCalibration* ReadSet(TCCalibData* data, const Char_t* calibration, Int_t first_run);
+    TList* ReadSets(TCCalibData* data, const Char_t* calibration);
+    Bool_t ReadParametersCached(TCCalibData* data, const Char_t* calibration, Int_t set,
+                                Double_t* par, Int_t length);
+
     Bool_t ReadAllBadScR(Int_t run, TCBadScRElement**& badscr_data, Int_t& ndata);
+    void ParseAllBadScR(Char_t* str, TCBadScRElement**& badscr_data, Int_t& ndata);
+    static TString FormatAllBadScR(TCBadScRElement* const* badscr_data, Int_t ndata);
+    static Char_t* PackBadScR(Int_t nbadscr, const Int_t* badscr, Int_t& outSize);
+    static void UnpackBadScR(const Char_t* buffer, Int_t size, TCBadScRElement* outBadScR);
+    Bool_t ReadBadScRStrings(Int_t nRuns, const Int_t* sorted, Int_t* outNScR, TString* outStr);
+    void CreateBadScRTable();
+    Bool_t MigrateBadScR(Int_t first_run, Int_t last_run);
 
     TCMySQLManager();
 
@@ -79,11 +195,22 @@ public:
     virtual ~TCMySQLManager();
 
     void SetSilenceMode(Bool_t s) { fSilence = s; }
+    void SetPoolSize(Int_t n) { fPoolSize = n; }
+    void SetReconnect(Int_t retries, Int_t delay) { fRetries = retries; fRetryDelay = delay; }
+    void SetBulkBatchSize(Int_t n) { fBatchSize = n > 0 ? n : 1; }
+    Int_t GetBulkBatchSize() const { return fBatchSize; }
     Bool_t IsConnected();
+    Bool_t Reconnect();
+    void ReleaseConnection();
+    Bool_t SetMainThread();
+    Bool_t OpenParCache(const Char_t* fileName);
+    void CloseParCache();
+    TCParCache* GetParCache() const { return fParCache; }
 
     const Char_t* GetDBName() const;
     const Char_t* GetDBHost() const;
     ServerType_t GetDBType() const  { return fDBType; }
+    ParStorage_t GetParStorage() const { return fParStorage; }
     THashList* GetDataTable() const { return fData; }
     THashList* GetTypeTable() const { return fTypes; }
     TCCalibType* GetCalibType(const Char_t* type) const;
@@ -113,8 +240,12 @@ public:
                           Double_t* par, Int_t length);
     Bool_t ReadParametersRun(const Char_t* data, const Char_t* calibration, Int_t run,
                              Double_t* par, Int_t length);
+    THashList* ReadParametersRunMulti(const Char_t* calibration, Int_t run,
+                                      TCollection* dataList);
     Bool_t WriteParameters(const Char_t* data, const Char_t* calibration, Int_t set,
                            Double_t* par, Int_t length);
+    Bool_t WriteParametersSets(const Char_t* data, const Char_t* calibration,
+                               Int_t nSet, const Int_t* set, Double_t* par, Int_t length);
 
     Bool_t ChangeRunPath(Int_t first_run, Int_t last_run, const Char_t* path);
     Bool_t ChangeRunTarget(Int_t first_run, Int_t last_run, const Char_t* target);
@@ -128,6 +259,10 @@ public:
 
     Bool_t ChangeRunBadScR(Int_t run, Int_t nbadscr, const Int_t* badscr, const Char_t* data);
     Bool_t GetRunBadScR(Int_t run, Int_t& nbadscr, Int_t*& badscr, const Char_t* data = 0);
+    Bool_t GetRunsBadScR(Int_t nRuns, const Int_t* runs, Int_t* outNScR,
+                         TCBadScRElement** outBadScR, const Char_t* data = 0);
+    Bool_t ChangeRunsBadScR(Int_t nRuns, TCBadScRElement* const* badscr, const Char_t* data);
+    Bool_t HasBadScRTable() const { return fBadScRTable; }
 
     Bool_t ChangeCalibrationRunRange(const Char_t* calibration, const UInt_t firstRun,
                                      const UInt_t lastRun);
@@ -137,6 +272,7 @@ public:
     Int_t RemoveAllCalibrations(const Char_t* calibration);
     Bool_t RemoveAllRuns();
 
+    Bool_t AddDataSets(TCollection* sets, Bool_t skipChecks = kFALSE);
     Bool_t AddSet(const Char_t* type, const Char_t* calibration, const Char_t* desc,
                   Int_t first_run, Int_t last_run, Double_t par);
     Bool_t RemoveSet(const Char_t* type, const Char_t* calibration, Int_t set);
@@ -160,6 +296,7 @@ public:
     TCContainer* LoadContainer(const Char_t* filename);
 
     Int_t DumpRuns(TCContainer* container, Int_t first_run = 0, Int_t last_run = 0);
+    Int_t ForEachRun(RunHandler_t handler, void* arg = 0, Int_t first_run = 0, Int_t last_run = 0);
     Int_t DumpAllCalibrations(TCContainer* container, const Char_t* calibration);
     Int_t DumpCalibrations(TCContainer* container, const Char_t* calibration,
                            const Char_t* data);
@@ -180,5 +317,21 @@ public:
     ClassDef(TCMySQLManager, 0) // Communication with MySQL Server
 };
 
+// Returns the database connection of the thread to the pool when leaving the
+// scope (see TCMySQLManager::ReleaseConnection()).
+class TCDBConnectionGuard
+{
+
+private:
+    TCMySQLManager* fManager;                   // database manager
+
+    TCDBConnectionGuard(const TCDBConnectionGuard&);
+    TCDBConnectionGuard& operator=(const TCDBConnectionGuard&);
+
+public:
+    TCDBConnectionGuard(TCMySQLManager* manager) : fManager(manager) { }
+    ~TCDBConnectionGuard() { if (fManager) fManager->ReleaseConnection(); }
+};
+
 #endif
 
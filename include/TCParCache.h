@@ -0,0 +1,92 @@
+/*************************************************************************
+ * Author: Dominik Werthmueller, Irakli Keshelashvili, Thomas Strub
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TCParCache                                                           //
+//                                                                      //
+// Local read-through cache file of calibration parameters.             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TCPARCACHE_H
+#define TCPARCACHE_H
+
+#include "TObject.h"
+#include "TString.h"
+
+class THashList;
+class TCCalibration;
+
+class TCParCacheEntry : public TObject
+{
+
+private:
+    TString fKey;               // entry key
+    Long64_t fOffset;           // offset of the latest record in the file
+
+public:
+    TCParCacheEntry() : TObject(), fKey(), fOffset(0) { }
+    TCParCacheEntry(const Char_t* key, Long64_t offset)
+        : TObject(), fKey(key), fOffset(offset) { }
+    virtual ~TCParCacheEntry() { }
+
+    void SetOffset(Long64_t offset) { fOffset = offset; }
+    Long64_t GetOffset() const { return fOffset; }
+
+    virtual const Char_t* GetName() const { return fKey.Data(); }
+    virtual ULong_t Hash() const { return fKey.Hash(); }
+
+    ClassDef(TCParCacheEntry, 0) // Parameter cache file entry
+};
+
+class TCParCache
+{
+
+private:
+    TString fFileName;          // name of the cache file
+    TString fID;                // identifier of the cached database
+    Int_t fFD;                  // file descriptor
+    Bool_t fReadOnly;           // read-only access to the file
+    Char_t* fMap;               //! memory mapped file
+    Long64_t fMapSize;          // size of the mapped file
+    Long64_t fScanned;          // file offset up to which the records were indexed
+    Int_t fNRecords;            // number of indexed records
+    THashList* fIndex;          // index of the latest record of all keys
+    Bool_t fSilence;            // silence mode toggle
+
+    Bool_t Open();
+    void Close();
+    Bool_t Lock(Bool_t exclusive);
+    void Unlock();
+    Bool_t Update();
+    Bool_t Append(const Char_t* key, UInt_t changed, Int_t firstRun, Int_t lastRun,
+                  Int_t npar, const Char_t* desc, const Char_t* ctime, const Double_t* par);
+
+    static TString BuildKey(const Char_t* data, const Char_t* calibration, Int_t firstRun);
+
+public:
+    TCParCache() : fFileName(), fID(), fFD(-1), fReadOnly(kFALSE), fMap(0),
+                   fMapSize(0), fScanned(0), fNRecords(0), fIndex(0), fSilence(kFALSE) { }
+    TCParCache(const Char_t* fileName, const Char_t* id, Bool_t silence = kFALSE);
+    virtual ~TCParCache();
+
+    void SetSilenceMode(Bool_t s) { fSilence = s; }
+    Bool_t IsOpen() const { return fFD != -1; }
+    const Char_t* GetFileName() const { return fFileName.Data(); }
+    Int_t GetNEntries() const;
+
+    TCCalibration* Read(const Char_t* data, const Char_t* calibration, Int_t firstRun,
+                        UInt_t changed);
+    Bool_t Write(TCCalibration* calibration, UInt_t changed);
+    void Invalidate(const Char_t* data, const Char_t* calibration, Int_t nSet = 0,
+                    const Int_t* firstRun = 0);
+    Bool_t Compact();
+
+    ClassDef(TCParCache, 0) // Local parameter cache file
+};
+
+#endif
+
@@ -0,0 +1,47 @@
+/*************************************************************************
+ * Author: Dominik Werthmueller, Irakli Keshelashvili, Thomas Strub
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TCProgress                                                           //
+//                                                                      //
+// Thread-safe progress reporter.                                       //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TCPROGRESS_H
+#define TCPROGRESS_H
+
+#include "TString.h"
+
+class TMutex;
+
+class TCProgress
+{
+
+private:
+    TString fName;              // name of the task
+    Int_t fTotal;               // total number of steps
+    Int_t fDone;                // number of finished steps
+    Int_t fStep;                // reporting step [%]
+    Int_t fNext;                // next reported percentage
+    Long64_t fStart;            // start time [ms]
+    TMutex* fMutex;             // access mutex
+
+public:
+    TCProgress(const Char_t* name, Int_t total, Int_t step = 5);
+    virtual ~TCProgress();
+
+    Int_t GetTotal() const { return fTotal; }
+    Int_t GetDone() const { return fDone; }
+
+    void Increment(Int_t n = 1);
+    void Finish();
+
+    ClassDef(TCProgress, 0) // Thread-safe progress reporter
+};
+
+#endif
+
@@ -0,0 +1,50 @@
+/*************************************************************************
+ * Author: Dominik Werthmueller, Irakli Keshelashvili, Thomas Strub
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TCProjCache                                                          //
+//                                                                      //
+// Cache of the x-projections of all y-bins of a 2D histogram.          //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TCPROJCACHE_H
+#define TCPROJCACHE_H
+
+#include "TString.h"
+
+class TH1;
+class TH2;
+class TAxis;
+
+class TCProjCache
+{
+
+private:
+    Int_t fNproj;               // number of projections
+    Int_t fNbins;               // number of bins of a projection (incl. under- and overflow)
+    Bool_t fIsVariable;         // variable bin size flag
+    Double_t* fEdges;           //[fNbins-1] bin edges of the projections
+    Double_t* fContent;         //[fNproj*fNbins] bin contents of the projections
+    Double_t* fError2;          //[fNproj*fNbins] squared bin errors of the projections
+    TString fTitle;             // title of the projections
+    TAxis* fAxis;               // x-axis of the projected histogram (for the attributes)
+
+public:
+    TCProjCache(TH2* h);
+    virtual ~TCProjCache();
+
+    Int_t GetNproj() const { return fNproj; }
+    Int_t GetNbins() const { return fNbins - 2; }
+    const Double_t* GetContent(Int_t i) const { return fContent + i*fNbins; }
+    const Double_t* GetError2(Int_t i) const { return fError2 + i*fNbins; }
+
+    TH1* Fill(Int_t i, TH1*& h, const Char_t* name) const;
+
+    ClassDef(TCProjCache, 0) // Cache of the projections of a 2D histogram
+};
+
+#endif
@@ -0,0 +1,63 @@
+/*************************************************************************
+ * Author: Dominik Werthmueller, Irakli Keshelashvili, Thomas Strub
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TCSetIndex                                                           //
+//                                                                      //
+// Run interval index of the sets of a calibration.                     //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TCSETINDEX_H
+#define TCSETINDEX_H
+
+#include "TObject.h"
+#include "TString.h"
+
+class TCSetIndex : public TObject
+{
+
+private:
+    TString fKey;               // index key
+    TString fData;              // calibration data
+    TString fCalibration;       // calibration identifier
+    Int_t fNset;                // number of sets
+    Int_t fSize;                // size of the arrays
+    Int_t* fFirstRun;           //[fNset] first runs of the sets
+    Int_t* fLastRun;            //[fNset] last runs of the sets
+    UInt_t* fChanged;           //[fNset] change times of the sets
+
+    void Expand(Int_t size);
+
+public:
+    TCSetIndex() : TObject(), fKey(), fData(), fCalibration(),
+                   fNset(0), fSize(0), fFirstRun(0), fLastRun(0), fChanged(0) { }
+    TCSetIndex(const Char_t* data, const Char_t* calibration, Int_t nSet = 0);
+    virtual ~TCSetIndex();
+
+    void SetSet(Int_t set, Int_t firstRun, Int_t lastRun, UInt_t changed = 0);
+    void AddSet(Int_t firstRun, Int_t lastRun, UInt_t changed = 0);
+
+    const Char_t* GetCalibData() const { return fData.Data(); }
+    const Char_t* GetCalibration() const { return fCalibration.Data(); }
+    Int_t GetNsets() const { return fNset; }
+    Int_t GetFirstRun(Int_t set) const { return fFirstRun[set]; }
+    Int_t GetLastRun(Int_t set) const { return fLastRun[set]; }
+    UInt_t GetChanged(Int_t set) const { return fChanged[set]; }
+    Bool_t HasSet(Int_t set) const { return set >= 0 && set < fNset; }
+
+    Int_t FindSet(Int_t run) const;
+
+    static TString BuildKey(const Char_t* data, const Char_t* calibration);
+
+    virtual const Char_t* GetName() const { return fKey.Data(); }
+    virtual ULong_t Hash() const { return fKey.Hash(); }
+
+    ClassDef(TCSetIndex, 0) // Run interval index of calibration sets
+};
+
+#endif
+
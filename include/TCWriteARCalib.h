@@ -16,6 +16,8 @@
 
 #include "TCConfig.h"
 
+class THashList;
+
 class TCWriteARCalib
 {
 
@@ -23,6 +25,9 @@ private:
     CalibDetector_t fDetector;              // detector type
     Char_t fTemplate[256];                  // template calibration file
 
+    Bool_t CopyParameters(THashList* calibs, const Char_t* data,
+                          Double_t* par, Int_t length);
+
 public:
     TCWriteARCalib()
     {
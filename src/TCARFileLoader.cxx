@@ -19,6 +19,7 @@
 #include "TFile.h"
 #include "TCReadConfig.h"
 #include "TCMySQLManager.h"
+#include "TCFilePool.h"
 #include "TRegexp.h"
 #include "TMath.h"
 
@@ -38,7 +39,7 @@ TCARFileLoader::TCARFileLoader(const Char_t* inputfilepathpatt)
     fRuns = 0;
 
     fNFiles = 0;
-    fFiles = 0;
+    fFilePool = 0;
 
     fNOpenFiles = 0;
 
@@ -85,7 +86,7 @@ TCARFileLoader::TCARFileLoader(Int_t nruns, const Int_t* runs, const Char_t* inp
         fRuns[i] = runs[i];
 
     fNFiles = 0;
-    fFiles = 0;
+    fFilePool = 0;
 
     fNOpenFiles = 0;
 
@@ -124,12 +125,7 @@ TCARFileLoader::~TCARFileLoader()
     // Destructor
 
     if (fRuns) delete [] fRuns;
-    if (fFiles)
-    {
-        for (Int_t i = 0; i < fNFiles; i++)
-           if (fFiles[i]) delete fFiles[i];
-        delete [] fFiles;
-    }
+    if (fFilePool) delete fFilePool;
     if (fInputFilePathPatt) delete fInputFilePathPatt;
 }
 
@@ -137,15 +133,13 @@ TCARFileLoader::~TCARFileLoader()
 //______________________________________________________________________________
 void TCARFileLoader::ResetFileList()
 {
-    // Deletes the array of open files 'fFiles' and resets 'fNOpenFiles'.
+    // Deletes the pool of files 'fFilePool' and resets 'fNOpenFiles'.
 
     // delete old file list
-    if (fFiles)
+    if (fFilePool)
     {
-        for (Int_t i = 0; i < fNFiles; i++)
-            if (fFiles[i]) delete fFiles[i];
-        delete [] fFiles;
-        fFiles = 0;
+        delete fFilePool;
+        fFilePool = 0;
     }
 
     // reset number of files
@@ -159,10 +153,12 @@ void TCARFileLoader::ResetFileList()
 //______________________________________________________________________________
 Bool_t TCARFileLoader::CreateFileList()
 {
-    // Creates the array 'fFiles' of pointers to open files (length 'fNRuns').
+    // Creates the pool 'fFilePool' of files (length 'fNRuns').
     // The path of the i-th file is gained form the pattern 'fInputFilePathPatt'
-    // by replacing "RUN" by the i-th run number of the array 'fRuns'. If a file
-    // cannot be opened the NULL pointer is set for this file.
+    // by replacing "RUN" by the i-th run number of the array 'fRuns'. If a local
+    // file does not exist an empty entry is set for this file.
+    // The files are opened on first access and at most 'File.MaxOpen' files
+    // (configuration file) are kept open, the others are reopened on demand.
     // If 'fInputFilePathPatt' is NULL the pattern will be taken from the config
     // file using the TCReadConfig reader.
     // Returns 'kTRUE' on success, 'kFALSE' otherwise.
@@ -192,58 +188,113 @@ Bool_t TCARFileLoader::CreateFileList()
         }
     }
 
-    // save the current directory, since it will be changed when opening the files
-    TString currdir(gDirectory->GetPath());
-
-    // create file array
+    // create file pool
     fNFiles = fNRuns;
-    fFiles = new TFile*[fNFiles];
+    fFilePool = new TCFilePool(TCReadConfig::GetReader()->GetConfigInt("File.MaxOpen"));
 
     // loop over runs
     for (Int_t i = 0; i < fNRuns; i++)
     {
-        // init file pointer
-        fFiles[i] = 0;
-
         // construct file name
         TString filename(*fInputFilePathPatt);
         filename.ReplaceAll("RUN", TString::Format("%d", fRuns[i]));
 
-        // try to open the file
-        TFile* f = TFile::Open(filename.Data(), "READ");
-
-        // check for non-existing file
-        if (!f)
-        {
-            Warning("CreateFileList", "%03d : Could not open file '%s'", i, filename.Data());
-            continue;
-        }
-
-        // check bad file
-        if (f->IsZombie())
+        // check for non-existing local file (remote files are checked when opened)
+        if (!filename.Contains("://") && !IsRegularFile(filename.Data()))
         {
-            Warning("CreateFileList", "%03d : Could not open zombie file '%s'", i, filename.Data());
-            delete f;
+            Warning("CreateFileList", "%03d : Could not find file '%s'", i, filename.Data());
+            fFilePool->Add(0);
             continue;
         }
 
-        // add file to list
-        fFiles[i] = f;
-
-        // increment number of open files
+        // increment number of files
         fNOpenFiles++;
 
         // user information
-        Info("CreateFileList", "%03d : added file '%s'", i, f->GetName());
-    }
+        Info("CreateFileList", "%03d : added file '%s'", i, filename.Data());
 
-    // recover the current directory
-    gDirectory->cd(currdir.Data());
+        // add file to list (opened on first access)
+        fFilePool->Add(filename.Data());
+    }
 
     return kTRUE;
 }
 
 
+//______________________________________________________________________________
+TFile * const * TCARFileLoader::GetFiles() const
+{
+    // Returns the array of files (length 'fNFiles'). The entries of files that
+    // could not be opened are NULL.
+    // NOTE: Entries of files not opened yet or closed by the pool are NULL as
+    //       well. Use GetFile() and HasFile() instead.
+
+    return fFilePool ? fFilePool->GetFiles() : 0;
+}
+
+
+//______________________________________________________________________________
+TFile* TCARFileLoader::GetFile(Int_t index)
+{
+    // Returns the file with index 'index' and reopens it if it was closed.
+    // Returns NULL if the file does not exist. The file may be closed again
+    // by the next call of this method.
+
+    if (!fFilePool || index < 0 || index >= fNFiles) return 0;
+
+    return fFilePool->Get(index);
+}
+
+
+//______________________________________________________________________________
+TFile* TCARFileLoader::AcquireFile(Int_t index)
+{
+    // Returns the file with index 'index' and reopens it if it was closed.
+    // The file is kept open until 'ReleaseFile()' is called for it, which
+    // allows using it from several threads.
+    // Returns NULL if the file does not exist.
+
+    if (!fFilePool || index < 0 || index >= fNFiles) return 0;
+
+    return fFilePool->Acquire(index);
+}
+
+
+//______________________________________________________________________________
+void TCARFileLoader::ReleaseFile(Int_t index)
+{
+    // Releases the file with index 'index' acquired via 'AcquireFile()'.
+
+    if (!fFilePool || index < 0 || index >= fNFiles) return;
+
+    fFilePool->Release(index);
+}
+
+
+//______________________________________________________________________________
+Bool_t TCARFileLoader::HasFile(Int_t index) const
+{
+    // Returns kTRUE if the file with index 'index' was found, kFALSE
+    // otherwise.
+
+    if (!fFilePool || index < 0 || index >= fNFiles) return kFALSE;
+
+    return fFilePool->HasFile(index);
+}
+
+
+//______________________________________________________________________________
+const Char_t* TCARFileLoader::GetFileName(Int_t index) const
+{
+    // Returns the name of the file with index 'index' or NULL if the file does
+    // not exist.
+
+    if (!HasFile(index)) return 0;
+
+    return fFilePool->GetFileName(index);
+}
+
+
 //______________________________________________________________________________
 Bool_t TCARFileLoader::IsRegularFile(const Char_t* file)
 {
@@ -583,7 +634,7 @@ Bool_t TCARFileLoader::SetInputFilePathPatt(const Char_t* inputfilepathpatt)
 {
     // Sets the path pattern 'fInputFilePathPatt' to 'inputfilepathpatt'. If
     // 'inputfilepathpatt' is NULL 'fInputFilePathPatt' is set to NULL.
-    // The list of files 'fFiles' is deleted.
+    // The pool of files 'fFilePool' is deleted.
 
     // reset file list
     ResetFileList();
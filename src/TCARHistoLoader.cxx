@@ -19,6 +19,12 @@
 //        "MyHistograms_[0-9]+". The Length of the array is returned through the
 //        argument 'n'.
 //
+//    3)  Load multiple objects from a file f in one pass
+//          const Char_t* names[2] = { "MyHistogram", "EventInfo" };
+//          TObject** os = TCARHistoLoader::GetObjects(f, 2, names);
+//        The keys of all objects are prefetched with a single (vectored) read
+//        request, which is much faster on network file systems.
+//
 // B) Loading histograms:
 //   1.1) Load single histograms from one file, e.g.,
 //          TH1* h1 = hl.GetHistoForRun("MyHistogram", 2347, "#NAME");
@@ -32,6 +38,13 @@
 //        Now, hs is an array of length n of histograms having the names matching
 //        the pattern, i.e., 'MyHistogram_' followed by a number.
 //
+//   1.3) Load multiple objects from one file in one pass, e.g.,
+//          TObject** os = hl.GetObjectsForIndex(hl.FindRunIndex(2347), 2, names);
+//        or set the objects needed per file up front
+//          hl.SetPrefetchList(2, names);
+//        Then, all objects in the list are read in one pass when one of them
+//        is loaded for a file, and the others are handed out from memory.
+//
 //   2)   Load summed up histograms, e.g.,
 //          TH1* h = hl.CreateHistoSum("MyHistogram");
 //
@@ -85,6 +98,8 @@
 #include "TFile.h"
 #include "TError.h"
 #include "TRegexp.h"
+#include "TMath.h"
+#include "TFileCacheRead.h"
 
 ClassImp(TCARHistoLoader)
 
@@ -92,6 +107,78 @@ ClassImp(TCARHistoLoader)
 const Int_t TCARHistoLoader::kLastBin = -2147483648; // = (Int_t) 2^31
 
 
+//______________________________________________________________________________
+TCARHistoLoader::~TCARHistoLoader()
+{
+    // Destructor
+
+    ClearBatch();
+    if (fPrefetch) delete [] fPrefetch;
+}
+
+
+//______________________________________________________________________________
+void TCARHistoLoader::ClearBatch()
+{
+    // Deletes the objects read in one pass that were not handed out.
+
+    if (fBatch)
+    {
+        for (Int_t i = 0; i < fNPrefetch; i++)
+            if (fBatch[i]) delete fBatch[i];
+        delete [] fBatch;
+        fBatch = 0;
+    }
+    fBatchFile = "";
+}
+
+
+//______________________________________________________________________________
+TObject* TCARHistoLoader::TakeFromBatch(const Char_t* name, Int_t index)
+{
+    // Returns the object named 'name' of the file with index 'index' if it is
+    // in the prefetch list. All objects of the prefetch list are read in one
+    // pass from the file when the first one is requested. Every object is
+    // handed out only once, i.e., the caller owns it.
+    // Returns 0 if the object is not in the prefetch list or was already
+    // handed out.
+
+    // check prefetch list
+    Int_t n = -1;
+    for (Int_t i = 0; i < fNPrefetch; i++)
+    {
+        if (fPrefetch[i] == name)
+        {
+            n = i;
+            break;
+        }
+    }
+    if (n < 0) return 0;
+
+    // read the objects of the file
+    if (!fBatch || fBatchFile != GetFileName(index))
+    {
+        ClearBatch();
+
+        // get the file
+        TFile* f = GetFile(index);
+        if (!f) return 0;
+
+        // read the objects
+        const Char_t* names[fNPrefetch];
+        for (Int_t i = 0; i < fNPrefetch; i++) names[i] = fPrefetch[i].Data();
+        fBatch = GetObjects(f, fNPrefetch, names);
+        fBatchFile = GetFileName(index);
+    }
+
+    // hand out the object
+    TObject* o = fBatch[n];
+    fBatch[n] = 0;
+
+    return o;
+}
+
+
 //______________________________________________________________________________
 void TCARHistoLoader::SetHistoName(TH1* h, const Char_t* hnamepatt, Int_t index)
 {
@@ -234,6 +321,103 @@ TH1** TCARHistoLoader::GetHistos(const TFile* f, const Char_t* hpatt, Int_t& nhi
 }
 
 
+//______________________________________________________________________________
+TObject** TCARHistoLoader::GetObjects(TFile* f, Int_t n, const Char_t* const* names, Bool_t detach /*= kTRUE*/)
+{
+    // Basic *static* batch getter method! Returns an array of length 'n' of
+    // the objects named 'names' from the file 'f'. The keys of all objects are
+    // prefetched in the order of their file positions, so that the file is
+    // read in one pass with a single (vectored) read request. Objects in
+    // subdirectories are read without prefetching.
+    // If detach is kTRUE histograms are detached from the file.
+    // Elements of objects that do not exist are set to 0.
+    // NOTE: the array (incl. objects) has to be destroyed by the caller.
+
+    // check for file
+    if (!f || n <= 0) return 0;
+
+    // create object array
+    TObject** oOut = new TObject*[n];
+
+    // look up the keys
+    TKey* keys[n];
+    Long64_t pos[n];
+    Long64_t size = 0;
+    for (Int_t i = 0; i < n; i++)
+    {
+        oOut[i] = 0;
+        keys[i] = names[i] ? f->GetKey(names[i]) : 0;
+        pos[i] = keys[i] ? keys[i]->GetSeekKey() : 0;
+        if (keys[i]) size += keys[i]->GetNbytes();
+    }
+
+    // prefetch the keys in the order of their positions
+    TFileCacheRead* cache = 0;
+    if (size > 0)
+    {
+        cache = new TFileCacheRead(f, (Int_t) TMath::Min(size, (Long64_t) 1000000000));
+        f->SetCacheRead(cache);
+
+        Int_t index[n];
+        TMath::Sort(n, pos, index, kFALSE);
+        for (Int_t i = 0; i < n; i++)
+        {
+            TKey* key = keys[index[i]];
+            if (key) cache->Prefetch(key->GetSeekKey(), key->GetNbytes());
+        }
+    }
+
+    // read the objects (detached)
+    Bool_t status = TH1::AddDirectoryStatus();
+    if (detach) TH1::AddDirectory(kFALSE);
+    else TH1::AddDirectory(kTRUE);
+
+    for (Int_t i = 0; i < n; i++)
+    {
+        if (keys[i]) oOut[i] = keys[i]->ReadObj();
+        else if (names[i] && strchr(names[i], '/')) oOut[i] = f->Get(names[i]);
+    }
+
+    TH1::AddDirectory(status);
+
+    // clean up
+    if (cache)
+    {
+        f->SetCacheRead(0);
+        delete cache;
+    }
+
+    return oOut;
+}
+
+
+//______________________________________________________________________________
+void TCARHistoLoader::SetPrefetchList(Int_t n, const Char_t* const* names)
+{
+    // Sets the list of 'n' objects named 'names' needed per file. When one of
+    // them is loaded via GetHistoForIndex() all of them are read from the file
+    // in one pass (c.f., 'GetObjects()'). Null names are ignored.
+    // Pass n = 0 to disable prefetching.
+
+    // reset old list
+    ClearBatch();
+    if (fPrefetch) delete [] fPrefetch;
+    fPrefetch = 0;
+    fNPrefetch = 0;
+
+    // count names
+    Int_t nnames = 0;
+    for (Int_t i = 0; i < n; i++)
+        if (names[i]) nnames++;
+    if (!nnames) return;
+
+    // set new list
+    fPrefetch = new TString[nnames];
+    for (Int_t i = 0; i < n; i++)
+        if (names[i]) fPrefetch[fNPrefetch++] = names[i];
+}
+
+
 //______________________________________________________________________________
 TH1* TCARHistoLoader::GetHistoForRun(const Char_t* hname, Int_t runnumber, const Char_t* houtnamepatt /* = 0*/)
 {
@@ -260,7 +444,7 @@ TH1* TCARHistoLoader::GetHistoForRun(const Char_t* hname, Int_t runnumber, const
 TH1* TCARHistoLoader::GetHistoForIndex(const Char_t* hname, Int_t index, const Char_t* houtnamepatt /*= 0*/)
 {
     // Returns the pointer to the histogram with name 'hname' loaded from the
-    // file 'fFiles[index]' (i.e., the AR file of the run with run number
+    // file 'GetFile(index)' (i.e., the AR file of the run with run number
     // 'fRuns[i]'). The histogram name is suffixed with an underscore followed
     // by the associated the run number or renamed according to the 'houtnamepatt'.
     // If the file does not exist or if the histogram cannot be found, the NULL
@@ -278,16 +462,22 @@ TH1* TCARHistoLoader::GetHistoForIndex(const Char_t* hname, Int_t index, const C
     if (!LoadFiles()) return 0;
 
     // check for file
-    if (!fFiles[index]) return 0;
+    if (!HasFile(index)) return 0;
 
-    // get histogram detached
-    TH1* h = GetHisto(fFiles[index], hname);
+    // get histogram detached (from the objects read in one pass if possible)
+    TH1* h = 0;
+    if (TObject* o = TakeFromBatch(hname, index))
+    {
+        if (o->InheritsFrom("TH1")) h = (TH1*) o;
+        else delete o;
+    }
+    if (!h) h = GetHisto(GetFile(index), hname);
 
     // check for histogram
     if (!h)
     {
         Error("GetHistoForIndex", "Histogram '%s' was not found in file '%s'!",
-                                  hname, fFiles[index]->GetName());
+                                  hname, GetFileName(index));
         return 0;
     }
 
@@ -351,7 +541,7 @@ TH1** TCARHistoLoader::GetHistosForIndex(const Char_t* hpatt, Int_t index, Int_t
     if (!LoadFiles()) return 0;
 
     // get the histos
-    TH1** hOut = GetHistos(fFiles[index], hpatt, nhistos);
+    TH1** hOut = GetHistos(GetFile(index), hpatt, nhistos);
 
     if (!hOut) return 0;
 
@@ -381,6 +571,51 @@ TH1** TCARHistoLoader::GetHistosForIndex(const Char_t* hpatt, Int_t index, Int_t
 }
 
 
+//______________________________________________________________________________
+TObject** TCARHistoLoader::GetObjectsForRun(Int_t runnumber, Int_t n, const Char_t* const* names)
+{
+    // Returns the array of length 'n' of the objects named 'names' for the
+    // runnumber 'runnumber' (c.f, 'GetObjects()' for further information). If
+    // 'runnumber' is not a valid runnumber the NULL pointer is returned.
+
+    // get index
+    Int_t index = FindRunIndex(runnumber);
+
+    // check whether runnumber was found
+    if (index < 0)
+    {
+        Error("GetObjectsForRun", "Runnumber '%d' is not a valid runnumber!", runnumber);
+        return 0;
+    }
+
+    // return objects
+    return GetObjectsForIndex(index, n, names);
+}
+
+
+//______________________________________________________________________________
+TObject** TCARHistoLoader::GetObjectsForIndex(Int_t index, Int_t n, const Char_t* const* names)
+{
+    // Returns the array of length 'n' of the objects named 'names' read in one
+    // pass from the file 'GetFile(index)' (c.f, 'GetObjects()' for further
+    // information). Histograms are detached.
+    // NOTE: the array (incl. objects) has to be destroyed by the caller.
+
+    // check index
+    if (0 > index || index >= fNRuns)
+    {
+        Error("GetObjectsForIndex", "Index '%d' out allowed range [0,%d]!", index, TMath::Max(0, fNRuns-1));
+        return 0;
+    }
+
+    // load files first (if not already loaded)
+    if (!LoadFiles()) return 0;
+
+    // get the objects
+    return GetObjects(GetFile(index), n, names);
+}
+
+
 //______________________________________________________________________________
 TH1* TCARHistoLoader::CreateHistoSum(const Char_t* hname, const Char_t* houtnamepatt /*= 0*/)
 {
@@ -499,7 +734,7 @@ TH1** TCARHistoLoader::CreateHistoArray(const Char_t* hname, const Char_t* houtn
 {
     // Creates an array of histogram pointers of length 'fNRuns'. The i-th array
     // element points to the histogram with name 'hname' loaded from the file
-    // 'fFiles[i]' (i.e., the AR file of the run with run number 'fRuns[i]').
+    // 'GetFile(i)' (i.e., the AR file of the run with run number 'fRuns[i]').
     // The individual histogram names are suffixed with an underscore followed
     // by the associated the run number.
     // If the histogram cannot be found for some file, the NULL pointer is set
@@ -554,7 +789,7 @@ TH1** TCARHistoLoader::CreateHistoArrayOfProj(const Char_t* hname, const Char_t
 {
     // Creates an array of histogram pointers of length 'fNRuns'. The i-th array
     // element is the projection on the axis 'projaxis' of the histogram with
-    // name 'hname' loaded from the file 'fFiles[i]' (i.e., the AR file of the
+    // name 'hname' loaded from the file 'GetFile(i)' (i.e., the AR file of the
     // run with run number 'fRuns[i]').
     // If the histogram cannot be found for some file, the NULL pointer is set
     // for the corresponding array element. If no histogram is found the NULL
@@ -711,7 +946,7 @@ TH2D* TCARHistoLoader::CreateHistoOfProj(const Char_t* hname, const Char_t proja
 {
     // Creates a TH2D histogram with 'fNRuns' y-bins. Its i-th y-slice is filled
     // with the projection on the axis 'projaxis' of the histogram named 'hname'
-    // from the file 'fFiles[i]' (i.e., the AR file of the run with run number
+    // from the file 'GetFile(i)' (i.e., the AR file of the run with run number
     // 'fRuns[i]').
     // NOTE: the histogram has to be destroyed by the caller.
 
@@ -743,7 +978,7 @@ TH2D* TCARHistoLoader::CreateHistoOfProj(const Char_t* hname, const Char_t proja
     for (Int_t i = 0; i < fNRuns; i++)
     {
         // check for file
-        if (!fFiles[i]) continue;
+        if (!HasFile(i)) continue;
 
         // get histogram detached
         Bool_t status = TH1::AddDirectoryStatus();
@@ -755,7 +990,7 @@ TH2D* TCARHistoLoader::CreateHistoOfProj(const Char_t* hname, const Char_t proja
         if (!h)
         {
             Error("CreateHistoOfProj", "Histogram '%s' was not found in file '%s'!",
-                                      hname, fFiles[i]->GetName());
+                                      hname, GetFileName(i));
             continue;
         }
 
@@ -763,7 +998,7 @@ TH2D* TCARHistoLoader::CreateHistoOfProj(const Char_t* hname, const Char_t proja
         if (!h->InheritsFrom("TH1"))
         {
             Error("CreateHistoOfProj", "Object named '%s' of file '%s' is not a histogram!",
-                                       hname, fFiles[i]->GetName());
+                                       hname, GetFileName(i));
 
             // delete h form memory
             h->ResetBit(kMustCleanup);
@@ -14,10 +14,16 @@
 #include <algorithm>
 
 #include "TH1.h"
+#include "TH2.h"
 #include "TF1.h"
 #include "TCanvas.h"
 #include "TStyle.h"
 #include "TTimer.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TVirtualMutex.h"
+#include "TROOT.h"
+#include "RVersion.h"
 #include "TTimeStamp.h"
 #include "TSystem.h"
 #include "TGClient.h"
@@ -28,15 +34,31 @@
 #include "TCMySQLManager.h"
 #include "TCReadConfig.h"
 #include "TCLine.h"
+#include "TCProgress.h"
+#include "TCProjCache.h"
 
 
 ClassImp(TCCalib)
 
+// elements shared by the batch fitting threads
+struct TCCalibBatchJob
+{
+    TCCalib* fCalib;                        // calibration module
+    Int_t fNext;                            // next element to fit
+    Double_t* fPos;                         // fitted positions
+    Bool_t* fFitted;                        // fit performed flags
+    TMutex* fMutex;                         // mutex for the element index and histogram creation
+    TCProgress* fProgress;                  // progress reporter
+};
+
 //______________________________________________________________________________
 TCCalib::~TCCalib()
 {
     // Destructor.
 
+    // wait for the background writer
+    WaitForWrite();
+
     if (fSet) delete [] fSet;
     if (fOldVal) delete [] fOldVal;
     if (fNewVal) delete [] fNewVal;
@@ -44,10 +66,13 @@ TCCalib::~TCCalib()
     if (fFitHisto) delete fFitHisto;
     if (fFitFunc) delete fFitFunc;
     if (fLine) delete fLine;
+    if (fProjCache) delete fProjCache;
     if (fOverviewHisto) delete fOverviewHisto;
     //if (fCanvasFit) delete fCanvasFit;            // comment this to prevent crash
     //if (fCanvasResult) delete fCanvasResult;      // comment this to prevent crash
     if (fTimer) delete fTimer;
+    if (fWriteTimer) delete fWriteTimer;
+    if (fWriteVal) delete [] fWriteVal;
     //if (fIgnore) delete [] fIgnore;
 }
 
@@ -57,9 +82,17 @@ void TCCalib::Start(const Char_t* calibration, Int_t nSet, Int_t* set)
     // Start the calibration module for the 'nSet' sets in 'set' using the calibration
     // identifier 'calibration'.
 
+    // wait for the background writer of a previous start (it reads the
+    // members set below)
+    WaitForWrite();
+
+    // this thread drives the GUI and uses the main database connection
+    TCMySQLManager::GetManager()->SetMainThread();
+
     // init members
     fCalibration = calibration;
     fNset = nSet;
+    if (fSet) delete [] fSet;
     fSet = new Int_t[fNset];
     for (Int_t i = 0; i < fNset; i++) fSet[i] = set[i];
     fHistoName = "";
@@ -69,6 +102,7 @@ void TCCalib::Start(const Char_t* calibration, Int_t nSet, Int_t* set)
     fFitHisto = 0;
     fFitFunc = 0;
     fLine = 0;
+    ClearProjCache();
 
     fOverviewHisto = 0;
 
@@ -115,13 +149,23 @@ void TCCalib::Start(const Char_t* calibration, Int_t nSet, Int_t* set)
     }
 
     // create timer
+    if (fTimer) delete fTimer;
     fTimer = new TTimer(100);
     fTimer->Connect("Timeout()", "TCCalib", this, "Next()");
     fTimerRunning = kFALSE;
 
+    // create background writer timer
+    if (fWriteTimer) delete fWriteTimer;
+    fWriteTimer = new TTimer(100);
+    fWriteTimer->Connect("Timeout()", "TCCalib", this, "CheckWrite()");
+
     // create arrays
+    if (fOldVal) delete [] fOldVal;
+    if (fNewVal) delete [] fNewVal;
+    if (fWriteVal) delete [] fWriteVal;
     fOldVal = new Double_t[fNelem];
     fNewVal = new Double_t[fNelem];
+    fWriteVal = new Double_t[fNelem];
 
     // init arrays
     for (Int_t i = 0; i < fNelem; i++)
@@ -159,13 +203,34 @@ void TCCalib::Start(const Char_t* calibration, Int_t nSet, Int_t* set)
                         "EventHandler(Int_t, Int_t, Int_t, TObject*)");
 
     // draw the result canvas
-    fCanvasResult = new TCanvas("Result", "Result", gClient->GetDisplayWidth() - 900, 0, 900, 400);
+    fCanvasResult = new TCanvas("Result", "Result", gClient ? gClient->GetDisplayWidth() - 900 : 0, 0, 900, 400);
 
     // init sub-class
     Init();
 
     // start with the first element
-    ProcessElement(0);
+    if (!fIsBatch) ProcessElement(0);
+}
+
+//______________________________________________________________________________
+void TCCalib::StartBatch(const Char_t* calibration, Int_t nSet, Int_t* set)
+{
+    // Start the calibration module like Start() but without displaying any
+    // graphics and process all elements using ProcessBatch().
+
+    // set batch mode
+    fIsBatch = kTRUE;
+    Bool_t batch = gROOT->IsBatch();
+    gROOT->SetBatch(kTRUE);
+
+    // start the module
+    Start(calibration, nSet, set);
+
+    // process all elements
+    ProcessBatch();
+
+    // restore the graphics mode
+    gROOT->SetBatch(batch);
 }
 
 //______________________________________________________________________________
@@ -264,6 +329,13 @@ void TCCalib::ProcessAll(Int_t msecDelay)
 {
     // Process all elements using 'msecDelay' milliseconds delay.
 
+    // process all elements at once in batch mode
+    if (fIsBatch)
+    {
+        ProcessBatch();
+        return;
+    }
+
     // check for delay
     if (msecDelay > 0)
     {
@@ -278,6 +350,181 @@ void TCCalib::ProcessAll(Int_t msecDelay)
     }
 }
 
+//______________________________________________________________________________
+Int_t TCCalib::ProcessBatch()
+{
+    // Fit all elements using 'Calib.Threads' threads and calculate the new
+    // values in element order. The elements are fitted on thread-local copies
+    // of the cached projections of the main histogram using FitElement()
+    // without drawing.
+    // Modules not providing FitElement() are processed element by element.
+    // Return the number of flagged elements, i.e., of elements that were not
+    // fitted and are not ignored.
+
+    // check for batch fitting
+    if (!HasFitElement() || !GetProjCache())
+    {
+        Warning("ProcessBatch", "Module %s does not support batch fitting, processing elements one by one", GetName());
+
+        // fit the first element (not done by Start() in batch mode)
+        if (fIsBatch) Fit(fCurrentElem);
+
+        // loop over elements
+        for (Int_t i = fCurrentElem; i < fNelem; i++) Next();
+        return 0;
+    }
+
+    // stop automatic iteration
+    StopProcessing();
+
+    // set up the fits
+    Double_t* pos = new Double_t[fNelem];
+    Bool_t* fitted = new Bool_t[fNelem];
+    for (Int_t i = 0; i < fNelem; i++)
+    {
+        pos[i] = 0;
+        fitted[i] = kFALSE;
+    }
+    TCCalibBatchJob job;
+    job.fCalib = this;
+    job.fNext = 0;
+    job.fPos = pos;
+    job.fFitted = fitted;
+    job.fMutex = new TMutex();
+    job.fProgress = new TCProgress("ProcessBatch", fNelem);
+
+    // detach the projections
+    Bool_t status = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(kFALSE);
+
+    // get number of threads
+    Int_t nThreads = TMath::Min(TCReadConfig::GetReader()->GetConfigInt("Calib.Threads"), fNelem);
+#if ROOT_VERSION_CODE < ROOT_VERSION(6,0,0)
+    // fits are not thread-safe before ROOT 6
+    nThreads = 1;
+#endif
+
+    // start the threads
+    fMinimizer = "";
+    TThread* threads[nThreads > 1 ? nThreads : 1];
+    if (nThreads > 1)
+    {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+        // enable ROOT's thread safety and use a thread-safe minimizer
+        ROOT::EnableThreadSafety();
+        fMinimizer = "Minuit2";
+#endif
+
+        for (Int_t i = 0; i < nThreads; i++)
+        {
+            threads[i] = new TThread(TCCalib::BatchThread, (void*) &job);
+            if (threads[i]->Run())
+            {
+                delete threads[i];
+                threads[i] = 0;
+            }
+        }
+    }
+
+    // fit the remaining elements in this thread
+    BatchThread((void*) &job);
+
+    // wait for the threads
+    for (Int_t i = 0; nThreads > 1 && i < nThreads; i++)
+    {
+        if (!threads[i]) continue;
+        threads[i]->Join();
+        delete threads[i];
+    }
+    TH1::AddDirectory(status);
+    fMinimizer = "";
+
+    // clean up
+    job.fProgress->Finish();
+    delete job.fProgress;
+    delete job.fMutex;
+
+    // calculate the new values in element order
+    fAvr = 0;
+    fAvrDiff = 0;
+    fNcalc = 0;
+    Int_t nFlagged = 0;
+    TString flagged;
+    for (Int_t i = 0; i < fNelem; i++)
+    {
+        fCurrentElem = i;
+        SetFitResult(i, fitted[i], pos[i]);
+        Calculate(i);
+
+        // flag elements without fit
+        if (!fitted[i] && !IsIgnored(i))
+        {
+            if (nFlagged++) flagged += ", ";
+            flagged += TString::Format("%d", i);
+        }
+    }
+
+    // user information
+    if (nFlagged) Info("ProcessBatch", "%d element(s) could not be fitted: %s", nFlagged, flagged.Data());
+
+    // show the last element and update result canvas
+    if (!fIsBatch) Fit(fCurrentElem);
+    if (fOverviewHisto)
+    {
+        fCanvasResult->cd();
+        fOverviewHisto->Draw("E1");
+        fCanvasResult->Update();
+    }
+
+    // clean up
+    delete [] pos;
+    delete [] fitted;
+
+    return nFlagged;
+}
+
+//______________________________________________________________________________
+void* TCCalib::BatchThread(void* arg)
+{
+    // Fit the elements of the job 'arg' until all elements were fitted.
+    // This is the function executed by the batch fitting threads.
+
+    TCCalibBatchJob* job = (TCCalibBatchJob*) arg;
+    TCCalib* calib = job->fCalib;
+    TCProjCache* cache = calib->fProjCache;
+    TH1* h = 0;
+
+    while (kTRUE)
+    {
+        // get the next element
+        Int_t elem;
+        {
+            TLockGuard lock(job->fMutex);
+            elem = job->fNext++;
+        }
+        if (elem >= calib->fNelem) break;
+
+        // copy the projection to the thread-local histogram
+        // (created under the lock since it looks up its name in the global lists)
+        Bool_t ok;
+        if (h) ok = cache->Fill(elem, h, "BatchProjHisto") != 0;
+        else
+        {
+            TLockGuard lock(job->fMutex);
+            ok = cache->Fill(elem, h, "BatchProjHisto") != 0;
+        }
+
+        // fit the element
+        if (ok) job->fFitted[elem] = calib->FitElement(elem, h, job->fPos[elem]);
+        job->fProgress->Increment();
+    }
+
+    // clean up
+    if (h) delete h;
+
+    return 0;
+}
+
 //______________________________________________________________________________
 void TCCalib::Previous()
 {
@@ -367,13 +614,134 @@ void TCCalib::PrintValuesChanged()
 void TCCalib::WriteValues()
 {
     // Write the obtained calibration values to the database.
+    // The values of all sets are written in one transaction by a background
+    // thread while the overview picture is saved. The result is reported
+    // when the writer has finished (see CheckWrite() and WaitForWrite()).
 
-    // write values to database
-    for (Int_t i = 0; i < fNset; i++)
-        TCMySQLManager::GetManager()->WriteParameters(fData.Data(), fCalibration.Data(), fSet[i], fNewVal, fNelem);
+    // wait for the previous write
+    WaitForWrite();
+
+    // copy the values
+    for (Int_t i = 0; i < fNelem; i++) fWriteVal[i] = fNewVal[i];
+
+    // start the background writer
+    fWriting = kTRUE;
+    fWriter = new TThread("TCCalibWriter", TCCalib::WriteThread, (void*) this);
+    if (fWriter->Run())
+    {
+        // write the values in this thread if no thread could be started
+        delete fWriter;
+        fWriter = 0;
+        WriteThread((void*) this);
+        if (!fWriteOk) Error("WriteValues", "Could not write the values to the database!");
+    }
 
     // save overview picture
     SaveCanvas(fCanvasResult, "Overview");
+
+    // check the background writer periodically
+    if (fWriter) fWriteTimer->Start(100, kFALSE);
+}
+
+//______________________________________________________________________________
+void* TCCalib::WriteThread(void* arg)
+{
+    // Write the values of the calibration module 'arg' to the database.
+    // This is the function executed by the background writer.
+
+    TCCalib* calib = (TCCalib*) arg;
+
+    // write the values of all sets (the database connection of this thread
+    // is returned to the pool when leaving the scope)
+    {
+        TCDBConnectionGuard guard(TCMySQLManager::GetManager());
+        calib->fWriteOk = TCMySQLManager::GetManager()->WriteParametersSets(calib->fData.Data(),
+                                                                            calib->fCalibration.Data(),
+                                                                            calib->fNset, calib->fSet,
+                                                                            calib->fWriteVal, calib->fNelem);
+    }
+
+    calib->fWriting = kFALSE;
+
+    return 0;
+}
+
+//______________________________________________________________________________
+void TCCalib::CheckWrite()
+{
+    // Check if the background writer has finished and report its result.
+
+    if (fWriter && !fWriting) WaitForWrite();
+}
+
+//______________________________________________________________________________
+Bool_t TCCalib::WaitForWrite()
+{
+    // Wait for the background writer to finish and report its result.
+    // Return the result of the last database write.
+
+    // check the background writer
+    if (!fWriter) return fWriteOk;
+
+    // wait for the writer
+    fWriter->Join();
+    delete fWriter;
+    fWriter = 0;
+    fWriteTimer->Stop();
+
+    // report the result
+    if (fWriteOk) Info("WriteValues", "Wrote the values of %d set(s) to the database", fNset);
+    else Error("WriteValues", "Could not write the values to the database!");
+
+    return fWriteOk;
+}
+
+//______________________________________________________________________________
+TCProjCache* TCCalib::GetProjCache()
+{
+    // Return the projection cache of the main histogram. The projections of
+    // all elements are extracted at the first call and again after the main
+    // histogram was replaced.
+    // Return 0 if the main histogram is not a 2D histogram.
+
+    // rebuild the cache if the main histogram was replaced
+    if (fProjCache && (fProjCacheHisto != fMainHisto ||
+                       (fMainHisto && fMainHisto->GetEntries() != fProjCacheEntries))) ClearProjCache();
+
+    // create the cache
+    if (!fProjCache && fMainHisto && fMainHisto->InheritsFrom("TH2"))
+    {
+        fProjCache = new TCProjCache((TH2*) fMainHisto);
+        fProjCacheHisto = fMainHisto;
+        fProjCacheEntries = fMainHisto->GetEntries();
+    }
+
+    return fProjCache;
+}
+
+//______________________________________________________________________________
+void TCCalib::ClearProjCache()
+{
+    // Delete the projection cache of the main histogram. This has to be called
+    // if the main histogram was modified in place.
+
+    if (fProjCache) delete fProjCache;
+    fProjCache = 0;
+    fProjCacheHisto = 0;
+    fProjCacheEntries = 0;
+}
+
+//______________________________________________________________________________
+TH1* TCCalib::GetProjection(Int_t elem, TH1*& h, const Char_t* name)
+{
+    // Copy the projection of the element 'elem' of the main histogram to the
+    // histogram 'h' named 'name', which is created if necessary and reused
+    // otherwise (see TCProjCache::Fill()), and return it.
+
+    TCProjCache* cache = GetProjCache();
+    if (!cache) return 0;
+
+    return cache->Fill(elem, h, name);
 }
 
 //______________________________________________________________________________
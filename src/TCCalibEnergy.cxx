@@ -15,6 +15,7 @@
 #include "TCanvas.h"
 #include "TH2.h"
 #include "TF1.h"
+#include "TRandom3.h"
 
 #include "TCCalibEnergy.h"
 #include "TCMySQLManager.h"
@@ -34,6 +35,8 @@ TCCalibEnergy::TCCalibEnergy(const Char_t* name, const Char_t* title, const Char
 
     // init members
     fPi0Pos = 0;
+    fIsFitted = kFALSE;
+    fEstMaxChi2 = 0;
     fLine = 0;
 }
 
@@ -69,6 +72,9 @@ void TCCalibEnergy::Init()
     }
     else fHistoName = *TCReadConfig::GetReader()->GetConfig(tmp);
 
+    // get the quality limit of the peak estimate
+    fEstMaxChi2 = TCReadConfig::GetReader()->GetConfigDouble("Calib.Estimate.MaxChi2");
+
     // read old parameters (only from first set)
     TCMySQLManager::GetManager()->ReadParameters(fData, fCalibration.Data(), fSet[0], fOldVal, fNelem);
 
@@ -114,9 +120,7 @@ void TCCalibEnergy::Fit(Int_t elem)
 
     // create histogram projection for this element
     sprintf(tmp, "ProjHisto_%i", elem);
-    TH2* h2 = (TH2*) fMainHisto;
-    if (fFitHisto) delete fFitHisto;
-    fFitHisto = (TH1D*) h2->ProjectionX(tmp, elem+1, elem+1, "e");
+    GetProjection(elem, fFitHisto, tmp);
 
     // draw histogram
     fFitHisto->SetFillColor(35);
@@ -126,7 +130,8 @@ void TCCalibEnergy::Fit(Int_t elem)
     fFitHisto->Draw("hist");
 
     // check for sufficient statistics
-    if (fFitHisto->Integral() > 100 && !IsIgnored(elem))
+    fIsFitted = fFitHisto->Integral() > 100 && !IsIgnored(elem);
+    if (fIsFitted)
     {
         // delete old function
         if (fFitFunc) delete fFitFunc;
@@ -146,36 +151,9 @@ void TCCalibEnergy::Fit(Int_t elem)
             if (fPi0Pos < 100 || fPi0Pos > 160) fPi0Pos = 135;
         }
 
-        // configure fitting function
-        if (this->InheritsFrom("TCCalibCBEnergy"))
-        {
-            fFitFunc->SetRange(fPi0Pos - 10, fPi0Pos + 10);
-            fFitFunc->SetParameters(fFitHisto->GetMaximum(), fPi0Pos, 11, 1, 1, 1, 0.1);
-            fFitFunc->SetParLimits(1, 130, 140);
-            fFitFunc->SetParLimits(2, 7, 18);
-        }
-        else if (this->InheritsFrom("TCCalibTAPSEnergyLG"))
-        {
-            fFitFunc->SetRange(60, 200);
-            fFitFunc->SetParameters(fFitHisto->GetMaximum(), fPi0Pos, 10, 1, 1, 1, 0.1);
-            fFitFunc->SetParLimits(0, 1, fFitHisto->GetMaximum()*1.5);
-            fFitFunc->SetParLimits(1, 115, 140);
-            fFitFunc->SetParLimits(2, 5, 15);
-            fFitFunc->FixParameter(6, 0);
-        }
-
-        // set +/- 3% peak position limits
-        if (fIsReFit) fFitFunc->SetParLimits(1, (1. - 0.03)*fPi0Pos, (1. + 0.03)*fPi0Pos);
-
-        // fit
-        TCFitUtils::ReFit(fFitHisto, fFitFunc, "RBQ0", 10);
-
-        // final results
-        fPi0Pos = fFitFunc->GetParameter(1);
-
-        // check if mass is in normal range
-        if (!fIsReFit &&
-            (fPi0Pos < fFitHisto->GetXaxis()->GetXmin() || fPi0Pos > fFitHisto->GetXaxis()->GetXmax())) fPi0Pos = 135;
+        // fit (the tries of the fit are performed concurrently)
+        fPi0Pos = FitPeak(fFitHisto, fFitFunc, fPi0Pos, fIsReFit, 0,
+                          TCReadConfig::GetReader()->GetConfigInt("Calib.Threads"));
 
         // set indicator line
         fLine->SetPos(fPi0Pos);
@@ -199,6 +177,88 @@ void TCCalibEnergy::Fit(Int_t elem)
     }
 }
 
+//______________________________________________________________________________
+Double_t TCCalibEnergy::FitPeak(TH1* h, TF1* f, Double_t pos, Bool_t refit, TRandom* rnd,
+                                Int_t nThreads, const Char_t* minimizer)
+{
+    // Fit the pi0 peak of the histogram 'h' with the function 'f' starting at
+    // the position 'pos' and return the fitted peak position. If 'refit' is
+    // kTRUE the peak position is limited to +/- 3% around 'pos'. The fit is
+    // restarted using the random generator 'rnd' (gRandom if 0) by 'nThreads'
+    // threads and the minimizer 'minimizer' (see TCFitUtils::ReFit()).
+    // The fit is skipped if the estimate of the peak is good enough.
+
+    // configure fitting function
+    if (this->InheritsFrom("TCCalibCBEnergy"))
+    {
+        f->SetRange(pos - 10, pos + 10);
+        f->SetParameters(h->GetMaximum(), pos, 11, 1, 1, 1, 0.1);
+        f->SetParLimits(1, 130, 140);
+        f->SetParLimits(2, 7, 18);
+    }
+    else if (this->InheritsFrom("TCCalibTAPSEnergyLG"))
+    {
+        f->SetRange(60, 200);
+        f->SetParameters(h->GetMaximum(), pos, 10, 1, 1, 1, 0.1);
+        f->SetParLimits(0, 1, h->GetMaximum()*1.5);
+        f->SetParLimits(1, 115, 140);
+        f->SetParLimits(2, 5, 15);
+        f->FixParameter(6, 0);
+    }
+
+    // set +/- 3% peak position limits
+    if (refit) f->SetParLimits(1, (1. - 0.03)*pos, (1. + 0.03)*pos);
+
+    // fit only if the peak estimate is bad
+    if (!TCFitUtils::EstimateFit(h, f, fEstMaxChi2))
+        TCFitUtils::ReFit(h, f, "RBQ0", 10, rnd, kTRUE, nThreads, minimizer);
+
+    // final results
+    pos = f->GetParameter(1);
+
+    // check if mass is in normal range
+    if (!refit &&
+        (pos < h->GetXaxis()->GetXmin() || pos > h->GetXaxis()->GetXmax())) pos = 135;
+
+    return pos;
+}
+
+//______________________________________________________________________________
+Bool_t TCCalibEnergy::FitElement(Int_t elem, TH1* h, Double_t& pos)
+{
+    // Fit the projection 'h' of the element 'elem' without drawing and store
+    // the peak position to 'pos'. Return kFALSE if the element was not fitted.
+    // NOTE: this can be called by several threads at once.
+
+    // check for sufficient statistics
+    if (h->Integral() <= 100 || IsIgnored(elem)) return kFALSE;
+
+    // thread-local fitting function and random generator
+    Char_t tmp[256];
+    sprintf(tmp, "fEnergy_%i", elem);
+    TF1 func(tmp, "gaus(0)+pol3(3)");
+    TRandom3 rnd(elem+1);
+
+    // estimate peak position
+    pos = h->GetBinCenter(h->GetMaximumBin());
+    if (pos < 100 || pos > 160) pos = 135;
+
+    // fit
+    pos = FitPeak(h, &func, pos, kFALSE, &rnd, 1, GetMinimizer());
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+void TCCalibEnergy::SetFitResult(Int_t elem, Bool_t fitted, Double_t pos)
+{
+    // Set the result of the batch fit of the element 'elem'.
+
+    fIsFitted = fitted;
+    fPi0Pos = fitted ? pos : 0;
+    if (fitted) fLine->SetPos(pos);
+}
+
 //______________________________________________________________________________
 void TCCalibEnergy::ReCalculateAll()
 {
@@ -256,7 +316,7 @@ void TCCalibEnergy::Calculate(Int_t elem)
     Bool_t unchanged = kFALSE;
 
     // check if fit was performed
-    if (fFitHisto->Integral() > 100 && !IsIgnored(elem))
+    if (fIsFitted)
     {
         // check if line position was modified by hand
         if (fLine->GetPos() != fPi0Pos) fPi0Pos = fLine->GetPos();
@@ -18,6 +18,7 @@
 #include "TCCalibPeakFit.h"
 #include "TCFileManager.h"
 #include "TCUtils.h"
+#include "TCFitUtils.h"
 #include "TCLine.h"
 #include "TCReadConfig.h"
 
@@ -32,6 +33,8 @@ TCCalibPeakFit::TCCalibPeakFit(const Char_t* name, const Char_t* title, const Ch
 
     // init members
     fMean = 0;
+    fIsFitted = kFALSE;
+    fEstMaxChi2 = 0;
 }
 
 //______________________________________________________________________________
@@ -65,6 +68,9 @@ void TCCalibPeakFit::Init()
     }
     else fHistoName = *TCReadConfig::GetReader()->GetConfig(tmp);
 
+    // get the quality limit of the peak estimate
+    fEstMaxChi2 = TCReadConfig::GetReader()->GetConfigDouble("Calib.Estimate.MaxChi2");
+
     // sum up all files contained in this runset
     TCFileManager f(fData, fCalibration.Data(), fNset, fSet);
 
@@ -107,9 +113,7 @@ void TCCalibPeakFit::Fit(Int_t elem)
 
     // create histogram projection for this element
     sprintf(tmp, "ProjHisto_%i", elem);
-    TH2* h2 = (TH2*) fMainHisto;
-    if (fFitHisto) delete fFitHisto;
-    fFitHisto = (TH1D*) h2->ProjectionX(tmp, elem+1, elem+1, "e");
+    GetProjection(elem, fFitHisto, tmp);
 
     // draw histogram
     fFitHisto->SetFillColor(35);
@@ -126,7 +130,8 @@ void TCCalibPeakFit::Fit(Int_t elem)
     TCReadConfig::GetReader()->GetConfigDoubleDouble(tmp, &lowLimit, &highLimit);
 
     // check for sufficient statistics
-    if (fFitHisto->GetEntries() && !IsIgnored(elem))
+    fIsFitted = fFitHisto->GetEntries() && !IsIgnored(elem);
+    if (fIsFitted)
     {
         // delete old function
         if (fFitFunc) delete fFitFunc;
@@ -149,20 +154,8 @@ void TCCalibPeakFit::Fit(Int_t elem)
         //fFitFunc = new TF1("fFitFunc", "gaus(0)", lowLimit, highLimit);
         fFitFunc->SetLineColor(2);
 
-        // configure fitting function
-        fFitFunc->SetParameters(max, fMean, 3, 1, 0.1, 0.1);
-        //fFitFunc->SetParLimits(0, 0.1, max*10);
-
-        // second iteration
-        for (Int_t i = 0; i < 10; i++)
-            if (!fFitHisto->Fit(fFitFunc, "RQ0")) break;
-
-        // final results
-        fMean = fFitFunc->GetParameter(1);
-
-        // correct bad position
-        if (fMean < fFitHisto->GetXaxis()->GetXmin() || fMean > fFitHisto->GetXaxis()->GetXmax())
-            fMean = 0.5 * (fFitHisto->GetXaxis()->GetXmin() + fFitHisto->GetXaxis()->GetXmax());
+        // fit
+        fMean = FitPeak(fFitHisto, fFitFunc, fMean, max);
 
         // draw mean indicator line
         fLine->SetPos(fMean);
@@ -186,6 +179,76 @@ void TCCalibPeakFit::Fit(Int_t elem)
     }
 }
 
+//______________________________________________________________________________
+Double_t TCCalibPeakFit::FitPeak(TH1* h, TF1* f, Double_t mean, Double_t max,
+                                 const Char_t* minimizer) const
+{
+    // Fit the peak of the histogram 'h' with the function 'f' starting at the
+    // position 'mean' with the height 'max' using the minimizer 'minimizer'
+    // (0: default) and return the peak position.
+    // The fit is skipped if the estimate of the peak is good enough.
+
+    // configure fitting function
+    f->SetParameters(max, mean, 3, 1, 0.1, 0.1);
+    //f->SetParLimits(0, 0.1, max*10);
+
+    // fit only if the peak estimate is bad
+    if (!TCFitUtils::EstimateFit(h, f, fEstMaxChi2))
+    {
+        // second iteration
+        for (Int_t i = 0; i < 10; i++)
+            if (!TCFitUtils::FitGausPol(h, f, "RQ0", minimizer)) break;
+    }
+
+    // final results
+    mean = f->GetParameter(1);
+
+    // correct bad position
+    if (mean < h->GetXaxis()->GetXmin() || mean > h->GetXaxis()->GetXmax())
+        mean = 0.5 * (h->GetXaxis()->GetXmin() + h->GetXaxis()->GetXmax());
+
+    return mean;
+}
+
+//______________________________________________________________________________
+Bool_t TCCalibPeakFit::FitElement(Int_t elem, TH1* h, Double_t& pos)
+{
+    // Fit the projection 'h' of the element 'elem' without drawing and store
+    // the peak position to 'pos'. Return kFALSE if the element was not fitted.
+    // NOTE: this can be called by several threads at once.
+
+    Char_t tmp[256];
+
+    // check for sufficient statistics
+    if (!h->GetEntries() || IsIgnored(elem)) return kFALSE;
+
+    // read fit config
+    Double_t lowLimit = h->GetXaxis()->GetXmin();
+    Double_t highLimit = h->GetXaxis()->GetXmax();
+    sprintf(tmp, "%s.Histo.Fit.Range", GetName());
+    TCReadConfig::GetReader()->GetConfigDoubleDouble(tmp, &lowLimit, &highLimit);
+
+    // thread-local fitting function
+    sprintf(tmp, "fFunc_%i", elem);
+    TF1 func(tmp, "gaus(0)+pol2(3)", lowLimit, highLimit);
+
+    // fit
+    pos = FitPeak(h, &func, h->GetXaxis()->GetBinCenter(h->GetMaximumBin()),
+                  h->GetBinContent(h->GetMaximumBin()), GetMinimizer());
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+void TCCalibPeakFit::SetFitResult(Int_t elem, Bool_t fitted, Double_t pos)
+{
+    // Set the result of the batch fit of the element 'elem'.
+
+    fIsFitted = fitted;
+    fMean = fitted ? pos : 0;
+    if (fitted) fLine->SetPos(pos);
+}
+
 //______________________________________________________________________________
 void TCCalibPeakFit::Calculate(Int_t elem)
 {
@@ -195,7 +258,7 @@ void TCCalibPeakFit::Calculate(Int_t elem)
     Bool_t unchanged = kFALSE;
 
     // check if fit was performed
-    if (fFitHisto->GetEntries() && !IsIgnored(elem))
+    if (fIsFitted)
     {
         // check if line position was modified by hand
         if (fLine->GetPos() != fMean) fMean = fLine->GetPos();
@@ -122,19 +122,18 @@ void TCCalibPed::Fit(Int_t elem)
 
     Char_t tmp[256];
 
-    // remove old fit histo
-    if (fFitHisto) delete fFitHisto;
-
     // check for main histo
     if (fMainHisto)
     {
         // create histogram projection for this element
         sprintf(tmp, "ProjHisto_%i", elem);
-        TH2* h2 = (TH2*) fMainHisto;
-        fFitHisto = (TH1D*) h2->ProjectionX(tmp, elem+1, elem+1, "e");
+        GetProjection(elem, fFitHisto, tmp);
     }
     else
     {
+        // remove old fit histo
+        if (fFitHisto) delete fFitHisto;
+
         // load the pedestal histogram
         sprintf(tmp, "ADC%d", fADC[elem]);
         fFitHisto = fFileManager->GetHistogram(tmp);
@@ -123,9 +123,7 @@ void TCCalibPhi::Fit(Int_t elem)
 
     // create histogram projection for this element
     sprintf(tmp, "ProjHisto_%i", elem);
-    TH2* h2 = (TH2*) fMainHisto;
-    if (fFitHisto) delete fFitHisto;
-    fFitHisto = (TH1D*) h2->ProjectionX(tmp, elem+1, elem+1, "e");
+    GetProjection(elem, fFitHisto, tmp);
 
     // check for sufficient statistics
     if (fFitHisto->GetEntries())
@@ -18,6 +18,7 @@
 #include "TMath.h"
 
 #include "TCCalibQuadEnergy.h"
+#include "TCProjCache.h"
 #include "TCMySQLManager.h"
 #include "TCFileManager.h"
 #include "TCUtils.h"
@@ -38,6 +39,8 @@ TCCalibQuadEnergy::TCCalibQuadEnergy(const Char_t* name, const Char_t* title, co
     fPar1New = 0;
     fMainHisto2 = 0;
     fMainHisto3 = 0;
+    fProjCache2 = 0;
+    fProjCache3 = 0;
     fFitHisto1b = 0;
     fFitHisto2 = 0;
     fFitHisto3 = 0;
@@ -67,6 +70,8 @@ TCCalibQuadEnergy::~TCCalibQuadEnergy()
     if (fPar1New) delete [] fPar1New;
     if (fMainHisto2) delete fMainHisto2;
     if (fMainHisto3) delete fMainHisto3;
+    if (fProjCache2) delete fProjCache2;
+    if (fProjCache3) delete fProjCache3;
     if (fFitHisto1b) delete fFitHisto1b;
     if (fFitHisto2) delete fFitHisto2;
     if (fFitHisto3) delete fFitHisto3;
@@ -175,6 +180,16 @@ void TCCalibQuadEnergy::Init()
         return;
     }
 
+    // delete the mean energy histograms and their projections of a previous start
+    if (fMainHisto2) delete fMainHisto2;
+    if (fMainHisto3) delete fMainHisto3;
+    if (fProjCache2) delete fProjCache2;
+    if (fProjCache3) delete fProjCache3;
+    fMainHisto2 = 0;
+    fMainHisto3 = 0;
+    fProjCache2 = 0;
+    fProjCache3 = 0;
+
     // get the pi0 mean energy histogram
     fMainHisto2 = (TH2*) f.GetHistogram(hMeanPi0Name.Data());
     if (!fMainHisto2)
@@ -228,12 +243,9 @@ void TCCalibQuadEnergy::Fit(Int_t elem)
 
     // get the 2g invariant mass histograms
     sprintf(tmp, "ProjHisto_%d", elem);
-    TH2* h2 = (TH2*) fMainHisto;
-    if (fFitHisto) delete fFitHisto;
-    if (fFitHisto1b) delete fFitHisto1b;
-    fFitHisto = (TH1*) h2->ProjectionX(tmp, elem+1, elem+1, "e");
+    GetProjection(elem, fFitHisto, tmp);
     sprintf(tmp, "ProjHisto_%db", elem);
-    fFitHisto1b = (TH1*) fFitHisto->Clone(tmp);
+    GetProjection(elem, fFitHisto1b, tmp);
     sprintf(tmp, "%s.Histo.Fit.Pi0.IM", GetName());
     TCUtils::FormatHistogram(fFitHisto, tmp);
     sprintf(tmp, "%s.Histo.Fit.Eta.IM", GetName());
@@ -241,17 +253,15 @@ void TCCalibQuadEnergy::Fit(Int_t elem)
 
     // get pi0 mean energy projection
     sprintf(tmp, "ProjHistoMeanPi0_%d", elem);
-    h2 = (TH2*) fMainHisto2;
-    if (fFitHisto2) delete fFitHisto2;
-    fFitHisto2 = h2->ProjectionX(tmp, elem+1, elem+1, "e");
+    if (!fProjCache2) fProjCache2 = new TCProjCache(fMainHisto2);
+    fProjCache2->Fill(elem, fFitHisto2, tmp);
     sprintf(tmp, "%s.Histo.Fit.Pi0.MeanE", GetName());
     TCUtils::FormatHistogram(fFitHisto2, tmp);
 
     // get eta mean energy projection
     sprintf(tmp, "ProjHistoMeanEta_%d", elem);
-    h2 = (TH2*) fMainHisto3;
-    if (fFitHisto3) delete fFitHisto3;
-    fFitHisto3 = h2->ProjectionX(tmp, elem+1, elem+1, "e");
+    if (!fProjCache3) fProjCache3 = new TCProjCache(fMainHisto3);
+    fProjCache3->Fill(elem, fFitHisto3, tmp);
     sprintf(tmp, "%s.Histo.Fit.Eta.MeanE", GetName());
     TCUtils::FormatHistogram(fFitHisto3, tmp);
 
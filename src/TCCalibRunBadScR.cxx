@@ -14,6 +14,8 @@
 //////////////////////////////////////////////////////////////////////////
 
 
+#include <algorithm>
+
 #include "TGClient.h"
 #include "TBox.h"
 #include "TCanvas.h"
@@ -22,6 +24,11 @@
 #include "TROOT.h"
 #include "TH2.h"
 #include "TFile.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TVirtualMutex.h"
+#include "TMath.h"
+#include "RVersion.h"
 #include "KeySymbols.h"
 
 #include "TCCalibRunBadScR.h"
@@ -29,9 +36,32 @@
 #include "TCReadConfig.h"
 #include "TCARHistoLoader.h"
 #include "TCMySQLManager.h"
+#include "TCProgress.h"
 
 ClassImp(TCCalibRunBadScR)
 
+// runs shared by the preprocessing threads
+struct TCCalibRunBadScRJob
+{
+    TCCalibRunBadScR* fCalib;               // calibration module
+    Int_t fNext;                            // index of the next run to process
+    Bool_t fLoadScaler;                     // load and normalize with the scaler histos
+    Int_t* fNScREvent;                      // number of scaler reads from the event info histos
+    TMutex* fMutex;                         // mutex for the run index and the cache
+    TCProgress* fProgress;                  // progress reporter
+    Int_t fNBad;                            // number of detected bad scaler reads
+};
+
+//______________________________________________________________________________
+static Double_t TCCalibRunBadScRMedian(Int_t n, Double_t* a)
+{
+    // Sorts the 'n' values of 'a' and returns their median.
+
+    if (n <= 0) return 0;
+    std::sort(a, a+n);
+    return n % 2 ? a[n/2] : 0.5*(a[n/2-1] + a[n/2]);
+}
+
 //______________________________________________________________________________
 TCCalibRunBadScR::~TCCalibRunBadScR()
 {
@@ -62,6 +92,9 @@ void TCCalibRunBadScR::CleanUp()
 {
     // Clean up
 
+    // stop the background reader
+    WaitForPrefetch();
+
     if (fHistoLoader)
     {
         delete fHistoLoader;
@@ -74,6 +107,13 @@ void TCCalibRunBadScR::CleanUp()
         delete [] fMainHistos;
         fMainHistos = 0;
     }
+    if (fMainCacheAge)
+    {
+        delete [] fMainCacheAge;
+        fMainCacheAge = 0;
+    }
+    fMainCacheSize = 0;
+    fMainCacheClock = 0;
     if (fProjHistos)
     {
         for (Int_t i = 0; i < fNRuns; i++)
@@ -206,6 +246,14 @@ Bool_t TCCalibRunBadScR::SetConfig()
         Info("Start", "Using calibration method '%s'.", fCalibMethod);
     }
 
+    // tolerances of the median method
+    sprintf(tmp, "BadScR.Median.Tolerance");
+    if (TCReadConfig::GetReader()->GetConfig(tmp))
+        fMedianTol = TCReadConfig::GetReader()->GetConfigDouble(tmp);
+    sprintf(tmp, "BadScR.Median.NMAD");
+    if (TCReadConfig::GetReader()->GetConfig(tmp))
+        fMedianNMAD = TCReadConfig::GetReader()->GetConfigDouble(tmp);
+
     // load histos in advance
     sprintf(tmp, "BadScR.LoadHistosInAdvance");
     if (TCReadConfig::GetReader()->GetConfig(tmp))
@@ -213,6 +261,21 @@ Bool_t TCCalibRunBadScR::SetConfig()
         fLoadHistosInAdvance = (Bool_t) TCReadConfig::GetReader()->GetConfigInt(tmp);
     }
 
+    // memory budget of the main histo cache
+    sprintf(tmp, "BadScR.Histo.Main.CacheSize");
+    if (TCReadConfig::GetReader()->GetConfig(tmp))
+    {
+        fMainCacheMax = (Long64_t) TCReadConfig::GetReader()->GetConfigInt(tmp) * 1024 * 1024;
+        if (fMainCacheMax < 0) fMainCacheMax = 0;
+    }
+
+    // keep only the projections in batch mode
+    if (fIsBatch)
+    {
+        fLoadHistosInAdvance = kFALSE;
+        fMainCacheMax = 0;
+    }
+
     return kTRUE;
 }
 
@@ -221,21 +284,24 @@ Bool_t TCCalibRunBadScR::Init()
 {
     // Loads main and scaler histogras, creates (normalized) projections of main
     // histograms, reads old bad scaler reads from the calib database, sets up
-    // the overview histogram and creates the canvas.
+    // the overview histogram and creates the canvas (not in batch mode).
 
     // call parent Init()
     TCCalibRun::Init();
 
     // adjust style
-    gStyle->SetOptStat(0);
-    gStyle->SetPadRightMargin(0.03);
-    gStyle->SetPadLeftMargin(0.05);
-    gStyle->SetLabelSize(0.06, "X");
-    gStyle->SetLabelSize(0.06, "Y");
-    gStyle->SetTickLength(0, "Y");
-
-    // force style for loaded histograms too
-    gROOT->ForceStyle();
+    if (!fIsBatch)
+    {
+        gStyle->SetOptStat(0);
+        gStyle->SetPadRightMargin(0.03);
+        gStyle->SetPadLeftMargin(0.05);
+        gStyle->SetLabelSize(0.06, "X");
+        gStyle->SetLabelSize(0.06, "Y");
+        gStyle->SetTickLength(0, "Y");
+
+        // force style for loaded histograms too
+        gROOT->ForceStyle();
+    }
 
 
     // load & prepare histos ---------------------------------------------------
@@ -281,84 +347,118 @@ Bool_t TCCalibRunBadScR::Init()
         }
     }
 
-    // load histos
-    if (!fLoadHistosInAdvance)
+    // create and init main histo and projection arrays
+    fMainHistos = new TH2*[fNRuns];
+    fProjHistos = new TH1*[fNRuns];
+    fProjNormHistos = new TH1*[fNRuns];
+    fMainCacheAge = new Int_t[fNRuns];
+    Int_t* nscrEvent = new Int_t[fNRuns];
+    for (Int_t i = 0; i < fNRuns; i++)
     {
-        // only create and init main histo array
-        fMainHistos = new TH2*[fNRuns];
-
-        for (Int_t i = 0; i < fNRuns; i++)
-            fMainHistos[i] = 0;
+        fMainHistos[i] = 0;
+        fProjHistos[i] = 0;
+        fProjNormHistos[i] = 0;
+        fMainCacheAge[i] = 0;
+        nscrEvent[i] = -1;
     }
-    else
+
+    // load scaler histograms in advance (--> can take a lot of time)
+    // (also when caching the main histograms to keep all projections in memory)
+    Bool_t loadScaler = (fLoadHistosInAdvance || IsCached()) &&
+                        (fScalerP2Histos || fScalerLiveHistos || fScalerFreeHistos);
+
+    // check whether scaler histos are used for normalization
+    if (fScalerP2Histos || fScalerFreeHistos || fScalerLiveHistos)
     {
-        // user info
-        Info("Init", "Loading main histograms...");
+        if (!fScalerP2Histos)
+                Warning("Init", "Histograms will not be P2 corrected.");
 
-        // load main histograms (--> can eat up a lot of memory)
-        if (!(fMainHistos = (TH2**) fHistoLoader->CreateHistoArray(fMainHistoName)))
-        {
-            Error("Init", "Could not load any main histograms named '%s'!", fMainHistoName);
-            CleanUp();
-            return kFALSE;
-        }
+        if (!(fScalerFreeHistos && fScalerLiveHistos))
+                Warning("Init", "Histograms will not be livetime corrected.");
+    }
 
-        // load scaler histograms (--> can take a lot of time)
-        if (fScalerP2Histos || fScalerFreeHistos || fScalerFreeHistos)
-        {
-            // user info
-            Info("Init", "Loading scaler histograms...");
+    // user info
+    if (fLoadHistosInAdvance) Info("Init", "Loading, projecting and normalizing main histograms...");
+    else if (IsCached()) Info("Init", "Projecting and normalizing main histograms (caching up to %lld MB)...",
+                              fMainCacheMax / 1024 / 1024);
+    else Info("Init", "Projecting main histograms...");
+
+    // set up the preprocessing of the runs
+    TCCalibRunBadScRJob job;
+    job.fCalib = this;
+    job.fNext = 0;
+    job.fLoadScaler = loadScaler;
+    job.fNScREvent = nscrEvent;
+    job.fMutex = new TMutex();
+    job.fProgress = new TCProgress("Init", fHistoLoader->GetNOpenFiles());
+    job.fNBad = 0;
+
+    // detach all histograms (not changed by the threads)
+    Bool_t status = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(kFALSE);
+
+    // start the threads (file access is not thread-safe before ROOT 6)
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+    Int_t nThreads = TMath::Min(TCReadConfig::GetReader()->GetConfigInt("File.Threads"), fNRuns);
+#else
+    Int_t nThreads = 1;
+#endif
+    TThread* threads[nThreads > 1 ? nThreads : 1];
+    if (nThreads > 1)
+    {
+        // enable ROOT's thread safety
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+        ROOT::EnableThreadSafety();
+#endif
 
-            Int_t dper = 5;
-            Int_t per = dper;
-            Int_t c = 0;
-            for (Int_t i = 0; i < fNRuns; i++)
+        for (Int_t i = 0; i < nThreads; i++)
+        {
+            threads[i] = new TThread(TCCalibRunBadScR::PreprocessThread, (void*) &job);
+            if (threads[i]->Run())
             {
-                // load histos
-                LoadScalerHistos(i);
-
-                // print progress
-                if (fHistoLoader->GetFiles()[i]) c++;
-                if (Double_t(c+1) / Double_t(fHistoLoader->GetNOpenFiles()) >= Double_t(per)/100.)
-                {
-                    printf("Progress %d%%...\n", per);
-                    per += dper;
-                }
+                delete threads[i];
+                threads[i] = 0;
             }
         }
     }
 
-    // user info
-    Info("Init", "Projecting main histograms...");
+    // read the old bad scaler reads of all runs from the database meanwhile
+    Int_t* nscrDB = new Int_t[fNRuns];
+    TCBadScRElement** badscrDB = new TCBadScRElement*[fNRuns];
+    Bool_t readDB = TCMySQLManager::GetManager()->GetRunsBadScR(fNRuns, fRuns, nscrDB, badscrDB,
+                                                                (*fCalibData).Data());
 
-    // load projection histograms
-    if (!(fProjHistos = (TH1**) fHistoLoader->CreateHistoArrayOfProj(fMainHistoName, 'X')))
+    // process the remaining runs in this thread
+    PreprocessThread((void*) &job);
+
+    // wait for the threads
+    for (Int_t i = 0; nThreads > 1 && i < nThreads; i++)
     {
-        Error("Init", "Could not load any projection of histograms named '%s'!", fMainHistoName);
-        CleanUp();
-        return kFALSE;
+        if (!threads[i]) continue;
+        threads[i]->Join();
+        delete threads[i];
     }
+    TH1::AddDirectory(status);
 
-    // create and init normalized projection array
-    fProjNormHistos = new TH1*[fNRuns];
-    for (Int_t i = 0; i < fNRuns; i++)
-        fProjNormHistos[i] = 0;
+    // clean up
+    job.fProgress->Finish();
+    delete job.fProgress;
+    delete job.fMutex;
 
-    if (fScalerP2Histos || fScalerFreeHistos || fScalerLiveHistos)
+    // check for projections
+    Bool_t isFound = kFALSE;
+    for (Int_t i = 0; i < fNRuns; i++)
+        if (fProjHistos[i]) isFound = kTRUE;
+    if (!isFound)
     {
-        // user infos
-        Info("Init", "Normalizing projection histograms...");
-
-        // check whether scaler histos were loaded
-        if (!fScalerP2Histos)
-                Warning("Init", "Histograms will not be P2 corrected.");
-
-        if (!(fScalerFreeHistos && fScalerLiveHistos))
-                Warning("Init", "Histograms will not be livetime corrected.");
-
-        // loop over runs
+        Error("Init", "Could not load any main histograms named '%s'!", fMainHistoName);
         for (Int_t i = 0; i < fNRuns; i++)
-            if (fLoadHistosInAdvance) NormalizeHisto(i);
+            if (badscrDB[i]) delete badscrDB[i];
+        delete [] badscrDB;
+        delete [] nscrDB;
+        delete [] nscrEvent;
+        CleanUp();
+        return kFALSE;
     }
 
     // load & prepare bad scaler reads -----------------------------------------
@@ -367,10 +467,7 @@ Bool_t TCCalibRunBadScR::Init()
     fBadScROld = new TCBadScRElement*[fNRuns];
     fBadScRNew = new TCBadScRElement*[fNRuns];
 
-    // user info
-    Info("Init", "Reading old bad scaler reads from database...");
-
-    // read bad scaler reads from database
+    // set up bad scaler reads
     for (Int_t i = 0; i < fNRuns; i++)
     {
         // init bad scaler read array
@@ -378,34 +475,23 @@ Bool_t TCCalibRunBadScR::Init()
         fBadScRNew[i] = 0;
 
         // get number of scaler reads from database
-        Int_t nscr = TCMySQLManager::GetManager()->GetRunNScR(fRuns[i]);
+        Int_t nscr = nscrDB[i];
 
-        // get number of scaler reads from event info histo
-        if (fHistoLoader->GetFiles()[i])
+        // check for same number of scaler reads as in the event info histo
+        if (nscrEvent[i] >= 0 && nscr != nscrEvent[i])
         {
-            // get the event info histo for this run
-            TH1* h = (TH1*) fHistoLoader->GetFiles()[i]->Get("EventInfo");
-
-            // check for same number of scaler reads
-            if (h && nscr != h->GetBinContent(TCConfig::kNScREventHBin))
-            {
-                 if (nscr == -1)
-                     Warning("Init", "Number of scaler reads for run '%i' is not set in the database yet!", fRuns[i]);
-                 else
-                     Error("Init", "Number of scaler reads mismatch for run '%i' (database: '%i' vs. EventInfo histogram: '%i'!",
-                           fRuns[i], nscr, (Int_t) h->GetBinContent(TCConfig::kNScREventHBin));
-
-                 // use number of scaler reads from event info histo
-                 nscr = h->GetBinContent(TCConfig::kNScREventHBin);
-            }
+             if (nscr == -1)
+                 Warning("Init", "Number of scaler reads for run '%i' is not set in the database yet!", fRuns[i]);
+             else
+                 Error("Init", "Number of scaler reads mismatch for run '%i' (database: '%i' vs. EventInfo histogram: '%i'!",
+                       fRuns[i], nscr, nscrEvent[i]);
+
+             // use number of scaler reads from event info histo
+             nscr = nscrEvent[i];
         }
 
-        // init helpers
-        Int_t nbadscr = 0;
-        Int_t* badscr = 0;
-
-        // get bad scaler reads from database
-        if (!TCMySQLManager::GetManager()->GetRunBadScR(fRuns[i], nbadscr, badscr, (*fCalibData).Data()))
+        // check bad scaler reads from database
+        if (!readDB || !badscrDB[i])
         {
             Error("Init", "Could not read bad scaler read from database for run '%i'!", fRuns[i]);
             fBadScROld[i] = new TCBadScRElement(fRuns[i], 0, 0, nscr);
@@ -413,7 +499,7 @@ Bool_t TCCalibRunBadScR::Init()
         else
         {
             // set up old bad scaler read element for this run
-            fBadScROld[i] = new TCBadScRElement(fRuns[i], nbadscr, badscr, nscr);
+            fBadScROld[i] = new TCBadScRElement(fRuns[i], badscrDB[i]->GetNBad(), badscrDB[i]->GetBad(), nscr);
         }
 
         // copy to new bad scaler read element for this run
@@ -424,13 +510,21 @@ Bool_t TCCalibRunBadScR::Init()
             fRangeMax = fBadScRNew[i]->GetNElem();
 
         // clean up
-        if (badscr) delete [] badscr;
+        if (badscrDB[i]) delete badscrDB[i];
 
     }//end loop over runs
 
+    // clean up
+    delete [] badscrDB;
+    delete [] nscrDB;
+    delete [] nscrEvent;
+
     // set max. range to number of scaler reads + 2
     fRangeMax += 2;
 
+    // no graphics in batch mode
+    if (fIsBatch) return kTRUE;
+
     // creat empty histos
     for (Int_t i = 0; i < fNRuns; i++)
     {
@@ -495,8 +589,12 @@ Bool_t TCCalibRunBadScR::Init()
     fRunMarker->SetLineWidth(2);
     fRunMarker->SetLineColor(kRed);
 
+    // get the display size (no GUI client in batch mode)
+    UInt_t dispWidth = gClient ? gClient->GetDisplayWidth() : 1280;
+    UInt_t dispHeight = gClient ? gClient->GetDisplayHeight() : 1024;
+
     // setup main canvas
-    fCanvasMain = new TCanvas("Main", "Main", 0, 0, gClient->GetDisplayWidth(), gClient->GetDisplayHeight()/2.+50);
+    fCanvasMain = new TCanvas("Main", "Main", 0, 0, dispWidth, dispHeight/2.+50);
     fCanvasMain->Divide(1, 3, 0.001, 0.001);
     fCanvasMain->GetPad(1)->SetMargin(0.03, 0.03, 0.02, 0.1);
     fCanvasMain->GetPad(2)->SetMargin(0.03, 0.03, 0.02, 0.02);
@@ -506,7 +604,7 @@ Bool_t TCCalibRunBadScR::Init()
     fCanvasMain->GetPad(3)->SetBit(kCannotPick);
 
     // setup overview canvas
-    fCanvasOverview = new TCanvas("Overview", "Overview", 0, gClient->GetDisplayHeight(), 800, gClient->GetDisplayHeight()/4.+20);
+    fCanvasOverview = new TCanvas("Overview", "Overview", 0, dispHeight, 800, dispHeight/4.+20);
     fCanvasOverview->Divide(1, 2, 0.001, 0.001);
 
     // disable ROOT zoom box
@@ -519,6 +617,108 @@ Bool_t TCCalibRunBadScR::Init()
     return kTRUE;
 }
 
+//______________________________________________________________________________
+void* TCCalibRunBadScR::PreprocessThread(void* arg)
+{
+    // Preprocesses the runs of the job 'arg' until all runs were processed.
+    // This is the function executed by the preprocessing threads.
+
+    TCCalibRunBadScRJob* job = (TCCalibRunBadScRJob*) arg;
+    TCCalibRunBadScR* calib = job->fCalib;
+
+    while (kTRUE)
+    {
+        // get the next run
+        Int_t i;
+        {
+            TLockGuard lock(job->fMutex);
+            i = job->fNext++;
+        }
+        if (i >= calib->fNRuns) break;
+
+        // check for file
+        if (!calib->fHistoLoader->HasFile(i)) continue;
+
+        // process the run
+        calib->PreprocessRun(i, job->fLoadScaler, job->fNScREvent[i], job->fMutex);
+        job->fProgress->Increment();
+    }
+
+    return 0;
+}
+
+//______________________________________________________________________________
+void TCCalibRunBadScR::PreprocessRun(Int_t i, Bool_t loadScaler, Int_t& nscrEvent, TMutex* mutex)
+{
+    // Reads the main, the event info and, if 'loadScaler' is kTRUE, the scaler
+    // histos of the index i in one pass, creates the projection of the main
+    // histo and the scaler projections and normalizes the projection. The
+    // number of scaler reads of the event info histo is stored to 'nscrEvent'.
+    // The main histo is kept according to the loading mode, 'mutex' protects
+    // the main histo cache.
+
+    // read all objects needed in one pass
+    const Char_t* names[3] = { fMainHistoName, "EventInfo", loadScaler ? fScalerHistoName : 0 };
+    TFile* f = fHistoLoader->AcquireFile(i);
+    TObject** o = TCARHistoLoader::GetObjects(f, 3, names);
+    fHistoLoader->ReleaseFile(i);
+    if (!o) return;
+
+    // check the main histogram
+    TH2* h = 0;
+    if (o[0] && o[0]->InheritsFrom("TH2")) h = (TH2*) o[0];
+    else
+    {
+        Error("PreprocessRun", "Histogram '%s' was not found in file '%s'!",
+                               fMainHistoName, fHistoLoader->GetFileName(i));
+        if (o[0]) delete o[0];
+    }
+
+    // project the main histogram (--> can eat up a lot of memory if kept)
+    if (h)
+    {
+        // set default name
+        h->SetName(TString::Format("%s_%i", fMainHistoName, fRuns[i]));
+
+        // create projection histogram
+        fProjHistos[i] = h->ProjectionX(TString::Format("%s_%d_px", h->GetName(), fRuns[i]), 1, h->GetNbinsY());
+        fProjHistos[i]->SetDirectory(0);
+
+        // keep main histogram (in the cache as long as it fits)
+        if (fLoadHistosInAdvance) fMainHistos[i] = h;
+        else if (IsCached())
+        {
+            TLockGuard lock(mutex);
+            if (fMainCacheSize + GetHistoSize(h) <= fMainCacheMax)
+            {
+                fMainHistos[i] = h;
+                CacheMainHisto(i);
+            }
+            else delete h;
+        }
+        else delete h;
+    }
+
+    // get number of scaler reads from event info histo
+    if (o[1])
+    {
+        if (o[1]->InheritsFrom("TH1")) nscrEvent = (Int_t) ((TH1*) o[1])->GetBinContent(TCConfig::kNScREventHBin);
+        delete o[1];
+    }
+
+    // project the scaler histogram and normalize the projection
+    if (loadScaler)
+    {
+        if (o[2] && o[2]->InheritsFrom("TH2")) ProjectScalerHistos(i, (TH2*) o[2]);
+        else Error("PreprocessRun", "Could not load scaler histogram named '%s' for index %d!", fScalerHistoName, i);
+        NormalizeHisto(i);
+    }
+    if (o[2]) delete o[2];
+
+    // clean up
+    delete [] o;
+}
+
 //______________________________________________________________________________
 void TCCalibRunBadScR::NormalizeHisto(Int_t i)
 {
@@ -587,7 +787,7 @@ void TCCalibRunBadScR::LoadScalerHistos(Int_t i)
         (!fScalerLiveHistos || fScalerLiveHistos[i]) &&
         (!fScalerFreeHistos || fScalerLiveHistos[i])) return;
 
-    if (!fHistoLoader->GetFiles()[i]) return;
+    if (!fHistoLoader->HasFile(i)) return;
 
     // get the histo
     TH2* hsc = (TH2*) fHistoLoader->GetHistoForIndex(fScalerHistoName, i);
@@ -597,31 +797,193 @@ void TCCalibRunBadScR::LoadScalerHistos(Int_t i)
         Error("LoadScalerHistos", "Could not load scaler histogram named '%s' for index %d!", fScalerHistoName, i);
         return;
     }
-    else
+
+    // create the scaler projections
+    ProjectScalerHistos(i, hsc);
+
+    // clean up
+    delete hsc;
+}
+
+//______________________________________________________________________________
+void TCCalibRunBadScR::ProjectScalerHistos(Int_t i, TH2* hsc)
+{
+    // Creates the missing scaler projections for the index i from the scaler
+    // histo 'hsc'.
+
+    // p2
+    if (fScP2 >= 0 && fScalerP2Histos && !fScalerP2Histos[i])
     {
-        // p2
-        if (fScP2 >= 0 && !fScalerP2Histos[i])
+        fScalerP2Histos[i] = hsc->ProjectionX(TString::Format("%s_%d_px", fScalerHistoName, fRuns[i]), fScP2+1, fScP2+1);
+        fScalerP2Histos[i]->SetDirectory(0);
+    }
+    // live time
+    if (fScFree >= 0 && fScLive >= 0 && fScalerLiveHistos && fScalerFreeHistos)
+    {
+        if (!fScalerLiveHistos[i])
         {
-            fScalerP2Histos[i] = hsc->ProjectionX(TString::Format("%s_%d_px", fScalerHistoName, fRuns[i]), fScP2+1, fScP2+1);
-            fScalerP2Histos[i]->SetDirectory(0);
+            fScalerLiveHistos[i] =  hsc->ProjectionX(TString::Format("%s_%d_px", fScalerHistoName, fRuns[i]), fScLive+1, fScLive+1);
+            fScalerLiveHistos[i]->SetDirectory(0);
         }
-        // live time
-        if (fScFree >= 0 && fScLive >= 0)
+        if (!fScalerFreeHistos[i])
         {
-            if (!fScalerLiveHistos[i])
-            {
-                fScalerLiveHistos[i] =  hsc->ProjectionX(TString::Format("%s_%d_px", fScalerHistoName, fRuns[i]), fScLive+1, fScLive+1);
-                fScalerLiveHistos[i]->SetDirectory(0);
-            }
-            if (!fScalerFreeHistos[i])
-            {
-                fScalerFreeHistos[i] =  hsc->ProjectionX(TString::Format("%s_%d_px", fScalerHistoName, fRuns[i]), fScFree+1, fScFree+1);
-                fScalerFreeHistos[i]->SetDirectory(0);
-            }
+            fScalerFreeHistos[i] =  hsc->ProjectionX(TString::Format("%s_%d_px", fScalerHistoName, fRuns[i]), fScFree+1, fScFree+1);
+            fScalerFreeHistos[i]->SetDirectory(0);
         }
+    }
+}
 
-        // clean up
-        if (hsc) delete hsc;
+//______________________________________________________________________________
+Long64_t TCCalibRunBadScR::GetHistoSize(TH1* h)
+{
+    // Returns the approximate memory used by the bins of the histogram 'h'.
+
+    Long64_t size = h->InheritsFrom("TArrayD") ? sizeof(Double_t) : sizeof(Float_t);
+    return size * h->GetNcells() + (Long64_t) sizeof(Double_t) * h->GetSumw2N();
+}
+
+//______________________________________________________________________________
+void TCCalibRunBadScR::CacheMainHisto(Int_t i)
+{
+    // Marks the main histo i as most recently used and deletes the least
+    // recently used main histos until the memory budget of the cache is
+    // respected. The main histo i is never deleted.
+
+    // check
+    if (!fMainHistos[i]) return;
+
+    // add to cache
+    if (!fMainCacheAge[i]) fMainCacheSize += GetHistoSize(fMainHistos[i]);
+    fMainCacheAge[i] = ++fMainCacheClock;
+
+    // delete least recently used histos
+    while (fMainCacheSize > fMainCacheMax)
+    {
+        // find least recently used histo
+        Int_t lru = -1;
+        for (Int_t j = 0; j < fNRuns; j++)
+        {
+            if (j == i || !fMainCacheAge[j]) continue;
+            if (lru == -1 || fMainCacheAge[j] < fMainCacheAge[lru]) lru = j;
+        }
+        if (lru == -1) break;
+
+        // delete histo
+        fMainCacheSize -= GetHistoSize(fMainHistos[lru]);
+        delete fMainHistos[lru];
+        fMainHistos[lru] = 0;
+        fMainCacheAge[lru] = 0;
+    }
+}
+
+//______________________________________________________________________________
+void TCCalibRunBadScR::StartPrefetch(Int_t i)
+{
+    // Starts reading the main histos of the runs next to the index i in the
+    // background.
+
+    // file access is not thread-safe before ROOT 6
+#if ROOT_VERSION_CODE < ROOT_VERSION(6,0,0)
+    return;
+#endif
+
+    // take the histos of a reader that is still running
+    WaitForPrefetch();
+
+    // set runs to read
+    for (Int_t j = 0; j < 2; j++)
+    {
+        Int_t k = j ? i+1 : i-1;
+        if (k < 0 || k >= fNRuns || fMainHistos[k] || !fHistoLoader->HasFile(k)) k = -1;
+        fPrefetchIndex[j] = k;
+        fPrefetchHistos[j] = 0;
+    }
+
+    // check
+    if (fPrefetchIndex[0] == -1 && fPrefetchIndex[1] == -1) return;
+
+    // enable ROOT's thread safety
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+    ROOT::EnableThreadSafety();
+#endif
+
+    // start the background reader
+    fPrefetcher = new TThread("TCCalibRunBadScRPrefetch", TCCalibRunBadScR::PrefetchThread, (void*) this);
+    if (fPrefetcher->Run())
+    {
+        // do not read in advance if no thread could be started
+        delete fPrefetcher;
+        fPrefetcher = 0;
+        fPrefetchIndex[0] = fPrefetchIndex[1] = -1;
+    }
+}
+
+//______________________________________________________________________________
+void* TCCalibRunBadScR::PrefetchThread(void* arg)
+{
+    // Reads the main histos of the runs set up by StartPrefetch() of the
+    // calibration module 'arg'. This is the function executed by the
+    // background reader.
+    // NOTE: the files are read directly via the file pool because the loader
+    //       state is used by the main thread at the same time.
+
+    TCCalibRunBadScR* calib = (TCCalibRunBadScR*) arg;
+
+    // read the histos
+    for (Int_t j = 0; j < 2; j++)
+    {
+        Int_t k = calib->fPrefetchIndex[j];
+        if (k == -1) continue;
+
+        // read the histo detached
+        TFile* f = calib->fHistoLoader->AcquireFile(k);
+        if (!f) continue;
+        TH1* h = TCARHistoLoader::GetHisto(f, calib->fMainHistoName);
+        calib->fHistoLoader->ReleaseFile(k);
+
+        // check the histo (the main thread reports a missing histo)
+        if (!h) continue;
+        if (!h->InheritsFrom("TH2"))
+        {
+            delete h;
+            continue;
+        }
+
+        // set default name
+        h->SetName(TString::Format("%s_%i", calib->fMainHistoName, calib->fRuns[k]));
+        calib->fPrefetchHistos[j] = (TH2*) h;
+    }
+
+    return 0;
+}
+
+//______________________________________________________________________________
+void TCCalibRunBadScR::WaitForPrefetch()
+{
+    // Waits for the background reader to finish and moves the main histos
+    // read in the background to the cache.
+
+    // check the background reader
+    if (!fPrefetcher) return;
+
+    // wait for the reader
+    fPrefetcher->Join();
+    delete fPrefetcher;
+    fPrefetcher = 0;
+
+    // cache the histos
+    for (Int_t j = 0; j < 2; j++)
+    {
+        Int_t k = fPrefetchIndex[j];
+        if (k == -1 || !fPrefetchHistos[j]) continue;
+        if (fMainHistos && !fMainHistos[k])
+        {
+            fMainHistos[k] = fPrefetchHistos[j];
+            CacheMainHisto(k);
+        }
+        else delete fPrefetchHistos[j];
+        fPrefetchHistos[j] = 0;
+        fPrefetchIndex[j] = -1;
     }
 }
 
@@ -630,6 +992,9 @@ void TCCalibRunBadScR::LoadHistos(Int_t i)
 {
     // Loads and creates all histos for the index i
 
+    // take the main histos read in the background if this run is among them
+    if (fPrefetcher && (fPrefetchIndex[0] == i || fPrefetchIndex[1] == i)) WaitForPrefetch();
+
     // get the histogram
     if (!fMainHistos[i])
         fMainHistos[i] = (TH2*) fHistoLoader->GetHistoForIndex(fMainHistoName, i);
@@ -650,6 +1015,13 @@ void TCCalibRunBadScR::LoadHistos(Int_t i)
 
     // create normalized histos
     NormalizeHisto(i);
+
+    // cache the main histo and read the neighbouring runs in the background
+    if (IsCached())
+    {
+        CacheMainHisto(i);
+        StartPrefetch(i);
+    }
 }
 
 //______________________________________________________________________________
@@ -716,6 +1088,10 @@ void TCCalibRunBadScR::ProcessCurr()
     if (strcmp(fCalibMethod, "default") == 0)
         CalibMethodDefault();
 
+    // median calibration
+    if (strcmp(fCalibMethod, "median") == 0)
+        CalibMethodMedian();
+
     // update overview histo
     UpdateOverviewHisto();
 }
@@ -927,8 +1303,8 @@ void TCCalibRunBadScR::CleanUpCurr()
     // update overview histo
     UpdateOverviewHisto();
 
-    // clear main histo
-    if (!fLoadHistosInAdvance)
+    // clear main histo (cached main histos are deleted when the cache is full)
+    if (!fLoadHistosInAdvance && !IsCached())
     {
        if (fMainHistos[fIndex]) delete fMainHistos[fIndex];
        fMainHistos[fIndex] = 0;
@@ -986,7 +1362,7 @@ Bool_t TCCalibRunBadScR::Write()
     // data type 'fCalibData' to the database.
 
     // check if calibration was started
-    if (!fIsStarted)
+    if (!fIsStarted && !fIsBatch)
     {
         Error("Write", "Not yet started!");
         return kFALSE;
@@ -995,38 +1371,16 @@ Bool_t TCCalibRunBadScR::Write()
     // security check
     if (!fBadScRNew) return kFALSE;
 
-    // init error counter
-    Int_t errors = 0;
-
-    // init run counter
+    // collect the bad scaler reads of all runs
+    TCBadScRElement* badscr[fNRuns];
     Int_t nruns = 0;
-
-    // loop over runs
     for (Int_t i = 0; i < fNRuns; i++)
-    {
-        // check for existing bad scaler reads
-        if (fBadScRNew[i])
-        {
-            // increment counter
-            nruns++;
-
-            // write bad scaler reads for run with index 'i'
-            if (!TCMySQLManager::GetManager()->ChangeRunBadScR(fBadScRNew[i]->GetRunNumber(), fBadScRNew[i]->GetNBad(), fBadScRNew[i]->GetBad(), (*fCalibData).Data()))
-            {
-                // an error occurred
-                Error("Write", "Could not write bad scaler reads for run '%i' to the database!", fRuns[i]);
-                errors++;
-            }
-        }
-        else
-        {
-        }
-    }
+        if (fBadScRNew[i]) badscr[nruns++] = fBadScRNew[i];
 
-    // print user info
-    if (errors)
+    // write the bad scaler reads of all runs in one transaction
+    if (!TCMySQLManager::GetManager()->ChangeRunsBadScR(nruns, badscr, (*fCalibData).Data()))
     {
-        Error("Write", "%i error(s) while writing to the database occurred", errors);
+        Error("Write", "Could not write bad scaler reads of %i runs to the database!", nruns);
         return kFALSE;
     }
     else
@@ -1298,4 +1652,268 @@ void TCCalibRunBadScR::CalibMethodDefault()
     } // iterate
 }
 
+//______________________________________________________________________________
+void TCCalibRunBadScR::CalibMethodMedian()
+{
+    // Rejects all scaler read intervals for which the projection of the main
+    // histogram deviates from the median of the good scaler reads by more than
+    // the configured tolerances (see FindBadScR()).
+
+    // find the bad scaler reads
+    Int_t* bad = new Int_t[fBadScRCurr->GetNElem()];
+    Int_t nbad = FindBadScR(fProjHistos[fIndex], fBadScRCurr, bad, fMedianTol, fMedianNMAD);
+
+    // set the bad scaler reads
+    for (Int_t i = 0; i < nbad; i++) SetBadScalerRead(bad[i]);
+
+    // clean up
+    delete [] bad;
+}
+
+//______________________________________________________________________________
+Int_t TCCalibRunBadScR::FindBadScR(TH1* h, const TCBadElement* badscr, Int_t* bad,
+                                   Double_t tol, Double_t nmad)
+{
+    // Finds the bad scaler reads in the projection 'h' of a main histogram
+    // using the median and the median absolute deviation (MAD) of the scaler
+    // reads that are not yet marked as bad in 'badscr'. Empty scaler reads,
+    // scaler reads below 1% of the median and scaler reads deviating from the
+    // median by at least the fraction 'tol' of the median or by at least
+    // 'nmad' times the MAD (scaled to a standard deviation), whichever is
+    // larger, are rejected. The rejected scaler reads are stored to 'bad',
+    // which has to hold badscr->GetNElem() entries, and their number is
+    // returned. The scaler reads are sorted instead of being scanned
+    // iteratively, i.e., this scales with n*log(n).
+
+    // check number of scaler reads
+    Int_t n = badscr->GetNElem();
+    if (!h || n <= 0) return 0;
+
+    // get the contents of the good scaler reads
+    Double_t* val = new Double_t[n];
+    Double_t* work = new Double_t[n];
+    Bool_t* good = new Bool_t[n];
+    const Int_t* oldBad = badscr->GetBad();
+    Int_t nOldBad = badscr->GetNBad();
+    Int_t nbad = 0;
+    Int_t ngood = 0;
+    for (Int_t i = 0, j = 0; i < n; i++)
+    {
+        // skip scaler reads already marked as bad (sorted list)
+        while (j < nOldBad && oldBad[j] < i) j++;
+        good[i] = !(j < nOldBad && oldBad[j] == i);
+        if (!good[i]) continue;
+
+        // reject empty bins
+        val[i] = h->GetBinContent(i+1);
+        if (val[i] == 0.)
+        {
+            good[i] = kFALSE;
+            bad[nbad++] = i;
+            continue;
+        }
+
+        work[ngood++] = val[i];
+    }
+
+    // reject small bins
+    Double_t median = TCCalibRunBadScRMedian(ngood, work);
+    ngood = 0;
+    for (Int_t i = 0; i < n; i++)
+    {
+        if (!good[i]) continue;
+        if (val[i] < median/100.)
+        {
+            good[i] = kFALSE;
+            bad[nbad++] = i;
+        }
+        else work[ngood++] = val[i];
+    }
+
+    // calculate median and MAD of the remaining scaler reads
+    median = TCCalibRunBadScRMedian(ngood, work);
+    for (Int_t i = 0; i < ngood; i++) work[i] = TMath::Abs(work[i] - median);
+    Double_t mad = 1.4826 * TCCalibRunBadScRMedian(ngood, work);
+
+    // reject outliers
+    Double_t maxdiff = TMath::Max(median * tol, nmad * mad);
+    for (Int_t i = 0; i < n; i++)
+        if (good[i] && TMath::Abs(val[i] - median) >= maxdiff) bad[nbad++] = i;
+
+    // clean up
+    delete [] val;
+    delete [] work;
+    delete [] good;
+
+    return nbad;
+}
+
+//______________________________________________________________________________
+void* TCCalibRunBadScR::DetectThread(void* arg)
+{
+    // Detects the bad scaler reads of the runs of the job 'arg' until all runs
+    // were processed. This is the function executed by the detection threads.
+
+    TCCalibRunBadScRJob* job = (TCCalibRunBadScRJob*) arg;
+    TCCalibRunBadScR* calib = job->fCalib;
+    Int_t* bad = new Int_t[calib->fRangeMax];
+
+    while (kTRUE)
+    {
+        // get the next run
+        Int_t i;
+        {
+            TLockGuard lock(job->fMutex);
+            i = job->fNext++;
+        }
+        if (i >= calib->fNRuns) break;
+
+        // check for projection
+        if (!calib->fProjHistos[i] || !calib->fBadScRNew[i]) continue;
+
+        // find and add the bad scaler reads of this run
+        Int_t nbad = FindBadScR(calib->fProjHistos[i], calib->fBadScRNew[i], bad,
+                                calib->fMedianTol, calib->fMedianNMAD);
+        calib->fBadScRNew[i]->AddBad(nbad, bad);
+
+        // count the bad scaler reads
+        {
+            TLockGuard lock(job->fMutex);
+            job->fNBad += nbad;
+        }
+        job->fProgress->Increment();
+    }
+
+    // clean up
+    delete [] bad;
+
+    return 0;
+}
+
+//______________________________________________________________________________
+Int_t TCCalibRunBadScR::DetectAll()
+{
+    // Detects the bad scaler reads of all runs using the median method (see
+    // FindBadScR()) and adds them to the new bad scaler reads. The runs are
+    // processed in parallel using 'File.Threads' threads. Returns the number
+    // of detected bad scaler reads.
+    // NOTE: the currently displayed run is not updated.
+
+    // check for bad scaler reads
+    if (!fBadScRNew || !fProjHistos) return 0;
+
+    // user info
+    Info("DetectAll", "Detecting bad scaler reads of %d runs...", fNRuns);
+
+    // set up the detection
+    TCCalibRunBadScRJob job;
+    job.fCalib = this;
+    job.fNext = 0;
+    job.fLoadScaler = kFALSE;
+    job.fNScREvent = 0;
+    job.fMutex = new TMutex();
+    job.fProgress = new TCProgress("DetectAll", fNRuns);
+    job.fNBad = 0;
+
+    // start the threads
+    Int_t nThreads = TMath::Min(TCReadConfig::GetReader()->GetConfigInt("File.Threads"), fNRuns);
+    TThread* threads[nThreads > 1 ? nThreads : 1];
+    if (nThreads > 1)
+    {
+        // enable ROOT's thread safety
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+        ROOT::EnableThreadSafety();
+#else
+        TThread::Initialize();
+#endif
+
+        for (Int_t i = 0; i < nThreads; i++)
+        {
+            threads[i] = new TThread(TCCalibRunBadScR::DetectThread, (void*) &job);
+            if (threads[i]->Run())
+            {
+                delete threads[i];
+                threads[i] = 0;
+            }
+        }
+    }
+
+    // process the remaining runs in this thread
+    DetectThread((void*) &job);
+
+    // wait for the threads
+    for (Int_t i = 0; nThreads > 1 && i < nThreads; i++)
+    {
+        if (!threads[i]) continue;
+        threads[i]->Join();
+        delete threads[i];
+    }
+
+    // clean up
+    job.fProgress->Finish();
+    delete job.fProgress;
+    delete job.fMutex;
+
+    // update the overview histogram
+    if (fOverviewHisto)
+    {
+        TCBadScRElement* curr = fBadScRCurr;
+        Int_t index = fIndex;
+        for (Int_t i = 0; i < fNRuns; i++)
+        {
+            if (!fBadScRNew[i]) continue;
+            fIndex = i;
+            fBadScRCurr = fBadScRNew[i];
+            UpdateOverviewHisto();
+        }
+        fIndex = index;
+        fBadScRCurr = curr;
+    }
+
+    // user info
+    Info("DetectAll", "Detected %d bad scaler reads.", job.fNBad);
+
+    return job.fNBad;
+}
+
+//______________________________________________________________________________
+Bool_t TCCalibRunBadScR::ProcessBatch(const Char_t* calibration, Bool_t write)
+{
+    // Detects the bad scaler reads of all runs of the calibration 'calibration'
+    // without any graphics and writes them to the database if 'write' is kTRUE.
+    // The main histograms are not kept in memory.
+
+    // check whether already started
+    if (fIsStarted || fIsBatch)
+    {
+        Error("ProcessBatch", "Is already started!");
+        return kFALSE;
+    }
+
+    // set batch mode
+    fIsBatch = kTRUE;
+
+    // delete old run list
+    if (fRuns) delete [] fRuns;
+
+    // set calibration
+    fCalibration = new TString(calibration);
+
+    // create the run list
+    fRuns = TCMySQLManager::GetManager()->GetRunsOfCalibration((*fCalibration).Data(), &fNRuns);
+    if (!fRuns) return kFALSE;
+
+    // load and project the histograms
+    if (!SetConfig()) return kFALSE;
+    if (!Init()) return kFALSE;
+
+    // detect the bad scaler reads
+    DetectAll();
+
+    // write to the database
+    if (write) return Write();
+
+    return kTRUE;
+}
+
 // finito
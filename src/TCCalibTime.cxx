@@ -140,9 +140,7 @@ void TCCalibTime::Fit(Int_t elem)
 
     // create histogram projection for this element
     sprintf(tmp, "ProjHisto_%i", elem);
-    TH2* h2 = (TH2*) fMainHisto;
-    if (fFitHisto) delete fFitHisto;
-    fFitHisto = (TH1D*) h2->ProjectionX(tmp, elem+1, elem+1, "e");
+    GetProjection(elem, fFitHisto, tmp);
 
     // init variables
     Double_t factor = 2.5;
@@ -57,6 +57,17 @@ namespace TCConfig
     // additional settings for the data tables
     const Char_t* kCalibDataTableSettings = ",PRIMARY KEY (calibration, first_run) ";
 
+    // name of the bad scaler read table
+    const Char_t* kBadScRTableName = "run_badscr";
+
+    // format of the bad scaler read table (one bitmap per run and data)
+    const Char_t* kBadScRTableFormat =
+                    "run INT NOT NULL,"
+                    "data VARCHAR(64) NOT NULL,"
+                    "nbad INT DEFAULT 0,"
+                    "bitmap BLOB,"
+                    "PRIMARY KEY (run, data) ";
+
     // version numbers
     const Char_t kCaLibVersion[] = "0.4.0";
     const Int_t kContainerFormatVersion = 5;
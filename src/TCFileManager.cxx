@@ -11,17 +11,236 @@
 //////////////////////////////////////////////////////////////////////////
 
 
+#include "RVersion.h"
+#include "TROOT.h"
 #include "TList.h"
+#include "THashList.h"
+#include "TNamed.h"
+#include "TSystem.h"
 #include "TFile.h"
 #include "TH1.h"
+#include "TH2.h"
+#include "TH3.h"
+#include "THnSparse.h"
+#include "TAxis.h"
+#include "TArrayD.h"
 #include "TError.h"
+#include "TMath.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TVirtualMutex.h"
 
 #include "TCFileManager.h"
 #include "TCReadConfig.h"
 #include "TCMySQLManager.h"
+#include "TCFilePool.h"
 
 ClassImp(TCFileManager)
 
+// non-zero bins of a histogram
+struct TCFileManagerSparse
+{
+    Int_t fDim;                             // dimension
+    Int_t fNcells;                          // number of bins incl. under-/overflow bins
+    Double_t fMin[3];                       // lower edges of the axes
+    Double_t fMax[3];                       // upper edges of the axes
+    Int_t fN;                               // number of non-zero bins
+    Int_t* fBin;                            //[fN] global bin numbers
+    Double_t* fW;                           //[fN] bin contents
+    Double_t* fW2;                          //[fN] squared bin errors (0 if not stored)
+    Double_t fEntries;                      // number of entries
+    Double_t fStats[13];                    // statistics (see TH1::GetStats())
+    Bool_t fHasStats;                       // statistics are available
+
+    TCFileManagerSparse(Int_t dim, Int_t ncells, Int_t n, Bool_t errors)
+        : fDim(dim), fNcells(ncells), fN(0), fBin(new Int_t[n]), fW(new Double_t[n]),
+          fW2(errors ? new Double_t[n] : 0), fEntries(0), fHasStats(kFALSE)
+    {
+        for (Int_t i = 0; i < 3; i++) fMin[i] = fMax[i] = 0;
+    }
+    ~TCFileManagerSparse()
+    {
+        delete [] fBin;
+        delete [] fW;
+        if (fW2) delete [] fW2;
+    }
+};
+
+// work shared by the file access threads
+struct TCFileManagerJob
+{
+    Int_t fN;                               // number of files
+    Int_t fNext;                            // next file to process
+    TMutex* fMutex;                         // mutex for fNext
+    const TString* fNames;                  // names of the files to open
+    TFile** fFiles;                         // opened files
+    TCFilePool* fPool;                      // pool of the files to read
+    const Int_t* fIndex;                    // pool indices of the files to read
+    const Char_t* fHisto;                   // name of the histogram to read
+    TH1** fHistos;                          // histograms read from the files
+    TCFileManagerSparse** fSparse;          // non-zero bins of sparse histograms
+    Bool_t fKeepFirst;                      // do not convert the first histogram
+};
+
+//______________________________________________________________________________
+static TObject* TCFileManagerDense(TObject* o)
+{
+    // Return the dense histogram of the THnSparse 'o' with up to three
+    // dimensions and destroy 'o'. Return 'o' for all other objects.
+
+    if (!o || !o->InheritsFrom("THnSparse")) return o;
+
+    // project to a histogram of the same dimension
+    THnSparse* s = (THnSparse*) o;
+    TH1* h = 0;
+    if (s->GetNdimensions() == 1) h = s->Projection(0, "E");
+    else if (s->GetNdimensions() == 2) h = s->Projection(1, 0, "E");
+    else if (s->GetNdimensions() == 3) h = s->Projection(0, 1, 2, "E");
+    else return o;
+
+    // clean-up
+    h->SetName(s->GetName());
+    delete s;
+
+    return h;
+}
+
+//______________________________________________________________________________
+static TCFileManagerSparse* TCFileManagerToSparse(TObject* o)
+{
+    // Return the non-zero bins of the TH2/TH3 or THnSparse with up to three
+    // dimensions 'o', or 0 if 'o' is no such histogram or if less than 75% of
+    // the bins of a TH2/TH3 are empty.
+
+    // THnSparse
+    if (o->InheritsFrom("THnSparse"))
+    {
+        THnSparse* s = (THnSparse*) o;
+        Int_t dim = s->GetNdimensions();
+        if (dim > 3) return 0;
+
+        // number of bins per dimension
+        Int_t nb[3] = { 1, 1, 1 };
+        for (Int_t i = 0; i < dim; i++) nb[i] = s->GetAxis(i)->GetNbins() + 2;
+
+        // copy the filled bins
+        Long64_t n = s->GetNbins();
+        TCFileManagerSparse* sp = new TCFileManagerSparse(dim, nb[0]*nb[1]*nb[2], (Int_t) n,
+                                                          s->GetCalculateErrors());
+        for (Int_t i = 0; i < dim; i++)
+        {
+            sp->fMin[i] = s->GetAxis(i)->GetXmin();
+            sp->fMax[i] = s->GetAxis(i)->GetXmax();
+        }
+        Int_t coord[3] = { 0, 0, 0 };
+        for (Long64_t i = 0; i < n; i++)
+        {
+            sp->fW[sp->fN] = s->GetBinContent(i, coord);
+            sp->fBin[sp->fN] = coord[0] + nb[0]*(coord[1] + nb[1]*coord[2]);
+            if (sp->fW2)
+            {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+                sp->fW2[sp->fN] = s->GetBinError2(i);
+#else
+                Double_t e = s->GetBinError(i);
+                sp->fW2[sp->fN] = e*e;
+#endif
+            }
+            sp->fN++;
+        }
+        sp->fEntries = s->GetEntries();
+
+        return sp;
+    }
+
+    // TH2/TH3
+    if (!o->InheritsFrom("TH1")) return 0;
+    TH1* h = (TH1*) o;
+    Int_t dim = h->GetDimension();
+    TArray* a = dynamic_cast<TArray*>(h);
+    if (dim < 2 || !a) return 0;
+
+    // count the non-zero bins
+    TArrayD* w2 = h->GetSumw2();
+    Bool_t errors = w2->GetSize() == a->GetSize();
+    Int_t ncells = a->GetSize();
+    Int_t n = 0;
+    for (Int_t i = 0; i < ncells; i++)
+        if (a->GetAt(i) != 0 || (errors && w2->fArray[i] != 0)) n++;
+
+    // use the dense histogram
+    if (n > ncells / 4) return 0;
+
+    // copy the axis ranges and the non-zero bins
+    TCFileManagerSparse* sp = new TCFileManagerSparse(dim, ncells, n, errors);
+    TAxis* axis[3] = { h->GetXaxis(), h->GetYaxis(), h->GetZaxis() };
+    for (Int_t i = 0; i < dim; i++)
+    {
+        sp->fMin[i] = axis[i]->GetXmin();
+        sp->fMax[i] = axis[i]->GetXmax();
+    }
+    for (Int_t i = 0; i < ncells; i++)
+    {
+        Double_t w = a->GetAt(i);
+        if (w == 0 && !(errors && w2->fArray[i] != 0)) continue;
+        sp->fBin[sp->fN] = i;
+        sp->fW[sp->fN] = w;
+        if (errors) sp->fW2[sp->fN] = w2->fArray[i];
+        sp->fN++;
+    }
+    sp->fEntries = h->GetEntries();
+    h->GetStats(sp->fStats);
+    sp->fHasStats = kTRUE;
+
+    return sp;
+}
+
+//______________________________________________________________________________
+static void* TCFileManagerWorker(void* arg)
+{
+    // Process the files of the job 'arg' until all files were processed:
+    // open the files if no histogram name is set, otherwise read the histogram
+    // from the files of the pool. Sparse histograms are converted to their
+    // non-zero bins if requested.
+
+    TCFileManagerJob* job = (TCFileManagerJob*) arg;
+
+    while (kTRUE)
+    {
+        // get the next file
+        Int_t i;
+        {
+            TLockGuard lock(job->fMutex);
+            i = job->fNext++;
+        }
+        if (i >= job->fN) break;
+
+        // open the file or read the histogram
+        if (!job->fHisto) job->fFiles[i] = TFile::Open(job->fNames[i].Data());
+        else if (TFile* f = job->fPool->Acquire(job->fIndex[i]))
+        {
+            TObject* o = f->Get(job->fHisto);
+            job->fPool->Release(job->fIndex[i]);
+            if (!o) continue;
+            o->ResetBit(kMustCleanup);
+
+            // keep only the non-zero bins of sparse histograms
+            if (job->fSparse && !(i == 0 && job->fKeepFirst))
+            {
+                if ((job->fSparse[i] = TCFileManagerToSparse(o)))
+                {
+                    delete o;
+                    continue;
+                }
+            }
+
+            job->fHistos[i] = (TH1*) TCFileManagerDense(o);
+        }
+    }
+
+    return 0;
+}
+
 //______________________________________________________________________________
 TCFileManager::TCFileManager(const Char_t* data, const Char_t* calibration,
                              Int_t nSet, Int_t* set, const Char_t* filePat)
@@ -37,8 +256,24 @@ TCFileManager::TCFileManager(const Char_t* data, const Char_t* calibration,
     fNset = nSet;
     fSet = new Int_t[fNset];
     for (Int_t i = 0; i < fNset; i++) fSet[i] = set[i];
-    fFiles = new TList();
-    fFiles->SetOwner(kTRUE);
+    fNThreads = 1;
+
+    // read the maximum number of open files
+    fFiles = new TCFilePool(TCReadConfig::GetReader()->GetConfigInt("File.MaxOpen"));
+
+    // read the number of threads for file access (not thread-safe before ROOT 6)
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+    Int_t nThreads = TCReadConfig::GetReader()->GetConfigInt("File.Threads");
+    if (nThreads > 1) fNThreads = nThreads;
+#endif
+
+    // read the directory of the summed histogram cache
+    if (TString* dir = TCReadConfig::GetReader()->GetConfig("File.Cache.Dir"))
+    {
+        Char_t* exp = gSystem->ExpandPathName(dir->Data());
+        fCacheDir = exp;
+        delete [] exp;
+    }
 
     // read input file pattern
     if (filePat) fInputFilePatt = filePat;
@@ -75,117 +310,616 @@ TCFileManager::~TCFileManager()
     if (fSet) delete [] fSet;
 }
 
+//______________________________________________________________________________
+void TCFileManager::RunParallel(Int_t n, const TString* names, TFile** files, const Int_t* index,
+                                const Char_t* histo, TH1** histos, TCFileManagerSparse** sparse,
+                                Bool_t keepFirst)
+{
+    // Open the 'n' files named 'names' to 'files' or, if 'histo' is non-zero,
+    // read the histogram 'histo' from the 'n' files with the pool indices
+    // 'index' to 'histos' using 'fNThreads' threads. The files are processed
+    // serially if only one thread is used.
+    // If 'sparse' is non-zero sparse histograms are stored as their non-zero
+    // bins in 'sparse' instead, except for the first one if 'keepFirst' is
+    // kTRUE.
+
+    // set up the job
+    TCFileManagerJob job;
+    job.fN = n;
+    job.fNext = 0;
+    job.fMutex = 0;
+    job.fNames = names;
+    job.fFiles = files;
+    job.fPool = fFiles;
+    job.fIndex = index;
+    job.fHisto = histo;
+    job.fHistos = histos;
+    job.fSparse = sparse;
+    job.fKeepFirst = keepFirst;
+
+    // process serially (file access is not thread-safe before ROOT 6)
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+    Int_t nThreads = TMath::Min(fNThreads, n);
+#else
+    Int_t nThreads = 1;
+#endif
+    if (nThreads <= 1)
+    {
+        TCFileManagerWorker(&job);
+        return;
+    }
+
+    // enable thread-safe file access
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+    ROOT::EnableThreadSafety();
+#endif
+
+    // start the threads
+    job.fMutex = new TMutex();
+    TThread* threads[nThreads];
+    for (Int_t i = 0; i < nThreads; i++)
+    {
+        threads[i] = new TThread(TCFileManagerWorker, (void*) &job);
+        if (threads[i]->Run())
+        {
+            delete threads[i];
+            threads[i] = 0;
+        }
+    }
+
+    // process the remaining files in this thread (if no thread could be started)
+    TCFileManagerWorker(&job);
+
+    // wait for the threads
+    for (Int_t i = 0; i < nThreads; i++)
+    {
+        if (!threads[i]) continue;
+        threads[i]->Join();
+        delete threads[i];
+    }
+    delete job.fMutex;
+}
+
 //______________________________________________________________________________
 void TCFileManager::BuildFileList()
 {
     // Build the list of files belonging to the runsets.
+    // The files are opened using 'fNThreads' threads and added to the pool of
+    // files, which closes them again if too many files are open.
 
-    // loop over sets
+    // get the runs of all sets
+    Int_t* nRun = new Int_t[fNset];
+    Int_t** runs = new Int_t*[fNset];
+    Int_t n = 0;
     for (Int_t i = 0; i < fNset; i++)
     {
         // get the list of runs for this set
-        Int_t nRun;
-        Int_t* runs = TCMySQLManager::GetManager()->GetRunsOfSet(fCalibData.Data(), fCalibration.Data(), fSet[i], &nRun);
+        nRun[i] = 0;
+        runs[i] = TCMySQLManager::GetManager()->GetRunsOfSet(fCalibData.Data(), fCalibration.Data(), fSet[i], &nRun[i]);
+        if (!runs[i]) nRun[i] = 0;
+        n += nRun[i];
 
         // user information
-        Info("BuildFileList", "Trying to add %d runs of set %d", nRun, fSet[i]);
+        Info("BuildFileList", "Trying to add %d runs of set %d", nRun[i], fSet[i]);
+    }
 
-        // loop over runs
-        for (Int_t j = 0; j < nRun; j++)
+    // construct the file names and keep the indices of the runs in their sets
+    TString* filenames = new TString[n];
+    Int_t* runIndex = new Int_t[n];
+    TFile** files = new TFile*[n];
+    Int_t k = 0;
+    for (Int_t i = 0; i < fNset; i++)
+    {
+        for (Int_t j = 0; j < nRun[i]; j++)
         {
-            // construct file name
-            TString filename(fInputFilePatt);
-            filename.ReplaceAll("RUN", TString::Format("%d", runs[j]));
+            filenames[k] = fInputFilePatt;
+            filenames[k].ReplaceAll("RUN", TString::Format("%d", runs[i][j]));
+            runIndex[k] = j;
+            files[k] = 0;
+            k++;
+        }
+        if (runs[i]) delete [] runs[i];
+    }
+    delete [] runs;
+    delete [] nRun;
 
-            // open the file
-            TFile* f = TFile::Open(filename.Data());
+    // open a limited number of files at once
+    Int_t window = fNThreads > 1 ? 4*fNThreads : 1;
 
-            // check nonexisting file
-            if (!f)
-            {
-                Warning("BuildFileList", "Could not open file '%s'", filename.Data());
-                continue;
-            }
+    // add the files in the order of the runs
+    for (Int_t i = 0; i < n; i++)
+    {
+        // open the next files
+        if (i % window == 0) RunParallel(TMath::Min(window, n - i), filenames + i, files + i);
 
-            // check bad file
-            if (f->IsZombie())
-            {
-                Warning("BuildFileList", "Could not open file '%s'", filename.Data());
-                continue;
-            }
+        TFile* f = files[i];
 
-            // add good file to list
-            fFiles->Add(f);
+        // check nonexisting file
+        if (!f)
+        {
+            Warning("BuildFileList", "Could not open file '%s'", filenames[i].Data());
+            continue;
+        }
 
-            // user information
-            Info("BuildFileList", "%03d : added file '%s'", j, f->GetName());
+        // check bad file
+        if (f->IsZombie())
+        {
+            Warning("BuildFileList", "Could not open file '%s'", filenames[i].Data());
+            delete f;
+            continue;
         }
 
-        // clean-up
-        delete runs;
+        // user information
+        Info("BuildFileList", "%03d : added file '%s'", runIndex[i], f->GetName());
+
+        // add good file to list
+        fFiles->Add(filenames[i].Data(), f);
     }
+
+    // clean-up
+    delete [] filenames;
+    delete [] runIndex;
+    delete [] files;
 }
 
 //______________________________________________________________________________
-TH1* TCFileManager::GetHistogram(const Char_t* name)
+Bool_t TCFileManager::AddSparse(TH1* hOut, TCFileManagerSparse* sp)
 {
-    // Get the summed-up histogram with name 'name'.
-    // NOTE: the histogram has to be destroyed by the caller.
+    // Add the non-zero bins 'sp' to the histogram 'hOut'. The statistics are
+    // not updated.
+    // Return kFALSE if the binning or the axis ranges are not compatible,
+    // otherwise kTRUE.
+
+    // check the binning
+    Int_t nb[3] = { hOut->GetNbinsX() + 2,
+                    hOut->GetDimension() > 1 ? hOut->GetNbinsY() + 2 : 1,
+                    hOut->GetDimension() > 2 ? hOut->GetNbinsZ() + 2 : 1 };
+    if (hOut->GetDimension() != sp->fDim || nb[0]*nb[1]*nb[2] != sp->fNcells) return kFALSE;
+
+    // check the axis ranges (up to a small fraction of the bin width)
+    TAxis* axis[3] = { hOut->GetXaxis(), hOut->GetYaxis(), hOut->GetZaxis() };
+    for (Int_t i = 0; i < sp->fDim; i++)
+    {
+        Double_t tol = 1e-6 * (axis[i]->GetXmax() - axis[i]->GetXmin()) / axis[i]->GetNbins();
+        if (TMath::Abs(axis[i]->GetXmin() - sp->fMin[i]) > tol ||
+            TMath::Abs(axis[i]->GetXmax() - sp->fMax[i]) > tol) return kFALSE;
+    }
 
-    TH1* hOut = 0;
+    // create the squared errors
+    if (!hOut->GetSumw2N() && sp->fW2) hOut->Sumw2();
+    TArrayD* w2 = hOut->GetSumw2N() ? hOut->GetSumw2() : 0;
 
-    // check if there are some runs
-    if (!fFiles->GetSize())
+    // add the bins
+    for (Int_t i = 0; i < sp->fN; i++)
     {
-        Error("GetHistogram", "ROOT file list is empty!");
-        return 0;
+        hOut->AddBinContent(sp->fBin[i], sp->fW[i]);
+        if (w2) w2->fArray[sp->fBin[i]] += sp->fW2 ? sp->fW2[i] : TMath::Abs(sp->fW[i]);
     }
 
-    // do not keep histograms in memory
-    TH1::AddDirectory(kFALSE);
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+TH1* TCFileManager::SumHistograms(const Char_t* name, Int_t n, const Int_t* index, TH1* hOut)
+{
+    // Sum up the histograms with name 'name' of the 'n' files with the pool
+    // indices 'index' and add them to 'hOut' if it is non-zero.
+    // The histograms are read from the files using 'fNThreads' threads. They
+    // are always added in the order of the files so that the sum is identical
+    // to the serial sum.
+    // Only the non-zero bins of mostly empty TH2/TH3 are kept after reading
+    // and added to the dense sum. THnSparse with up to three dimensions are
+    // summed up the same way into a TH1D/TH2D/TH3D.
+    // Return the summed-up histogram.
+
+    // read a limited number of histograms at once
+    Int_t window = fNThreads > 1 ? 4*fNThreads : 1;
+    TH1* histos[window];
+    TCFileManagerSparse* sparse[window];
+
+    // statistics of the sum while adding non-zero bins
+    Bool_t pending = kFALSE;
+    Bool_t validStats = kTRUE;
+    Double_t stats[13];
+    Double_t entries = 0;
 
     // loop over files
-    TIter next(fFiles);
-    TFile* f;
-    Bool_t first = kTRUE;
-    while ((f = (TFile*)next()))
+    Bool_t first = hOut ? kFALSE : kTRUE;
+    for (Int_t start = 0; start < n; start += window)
     {
-        // get histogram
-        TH1* h = (TH1*) f->Get(name);
+        // read the histograms
+        Int_t nRead = TMath::Min(window, n - start);
+        for (Int_t i = 0; i < nRead; i++)
+        {
+            histos[i] = 0;
+            sparse[i] = 0;
+        }
+        RunParallel(nRead, 0, 0, index + start, name, histos, sparse, first && !start);
 
-        // check if histogram is there
-        if (h)
+        // sum up the histograms in the order of the files
+        for (Int_t i = 0; i < nRead; i++)
         {
-            // correct destroying
-            h->ResetBit(kMustCleanup);
+            const Char_t* fn = fFiles->GetFileName(index[start+i]);
+            TH1* h = histos[i];
 
-            // check if object is really a histogram
-            if (h->InheritsFrom("TH1"))
+            // read the histogram again to create the sum
+            if (sparse[i] && first)
             {
-                // check if it is the first one
-                if (first)
+                delete sparse[i];
+                sparse[i] = 0;
+                if (TFile* f = fFiles->Acquire(index[start+i]))
                 {
-                    hOut = (TH1*) h->Clone();
-                    first = kFALSE;
+                    h = (TH1*) TCFileManagerDense(f->Get(name));
+                    fFiles->Release(index[start+i]);
                 }
-                else hOut->Add(h);
+            }
+
+            // add the non-zero bins
+            if (sparse[i])
+            {
+                // save the statistics of the sum
+                if (!pending)
+                {
+                    for (Int_t j = 0; j < 13; j++) stats[j] = 0;
+                    hOut->GetStats(stats);
+                    entries = hOut->GetEntries();
+                    validStats = kTRUE;
+                    pending = kTRUE;
+                }
+
+                // add the bins and the statistics
+                if (AddSparse(hOut, sparse[i]))
+                {
+                    for (Int_t j = 0; j < 13; j++) stats[j] += sparse[i]->fStats[j];
+                    if (!sparse[i]->fHasStats) validStats = kFALSE;
+                    entries += sparse[i]->fEntries;
+                }
+                else
+                {
+                    Error("GetHistogram", "Histogram '%s' found in file '%s' has a different binning "
+                                          "or axis range!", name, fn);
+                }
+
+                // clean-up
+                delete sparse[i];
+            }
+            else if (h)
+            {
+                // check if object is really a histogram
+                if (h->InheritsFrom("TH1"))
+                {
+                    // check if it is the first one
+                    if (first)
+                    {
+                        hOut = h;
+                        h = 0;
+                        first = kFALSE;
+                    }
+                    else
+                    {
+                        // set the statistics of the added non-zero bins
+                        if (pending)
+                        {
+                            if (validStats) hOut->PutStats(stats);
+                            else hOut->ResetStats();
+                            hOut->SetEntries(entries);
+                            pending = kFALSE;
+                        }
+                        hOut->Add(h);
+                    }
+                }
+                else
+                {
+                    Error("GetHistogram", "Object '%s' found in file '%s' is not a histogram!",
+                                          name, fn);
+                }
+
+                // clean-up
+                if (h) delete h;
             }
             else
             {
-                Error("GetHistogram", "Object '%s' found in file '%s' is not a histogram!",
-                                      name, f->GetName());
+                Warning("GetHistogram", "Histogram '%s' was not found in file '%s'",
+                                        name, fn);
             }
+        }
+    } // loop over files
+
+    // set the statistics of the added non-zero bins
+    if (pending)
+    {
+        if (validStats) hOut->PutStats(stats);
+        else hOut->ResetStats();
+        hOut->SetEntries(entries);
+    }
+
+    return hOut;
+}
+
+//______________________________________________________________________________
+TString TCFileManager::GetCacheKey(const Char_t* filePat, const Char_t* data, const Char_t* calibration,
+                                   Int_t nSet, const Int_t* set, const Char_t* name)
+{
+    // Return the key of the cached sum of the histogram 'name' of the files
+    // with the pattern 'filePat' belonging to the 'nSet' sets 'set' of the
+    // calibration data 'data' and the calibration identifier 'calibration'.
+
+    TString key = TString::Format("%s|%s|%s|%s", filePat, data, calibration, name);
+    for (Int_t i = 0; i < nSet; i++) key.Append(TString::Format("|%d", set[i]));
+
+    return key;
+}
+
+//______________________________________________________________________________
+TString TCFileManager::GetCacheFileName(const Char_t* dir, const Char_t* name, const Char_t* key)
+{
+    // Return the name of the cache file in the directory 'dir' of the summed
+    // histogram 'name' with the cache key 'key'.
+
+    TString base(name);
+    base.ReplaceAll("/", "_");
+
+    return TString::Format("%s/%s_%08lx.root", dir, base.Data(), (ULong_t) TString(key).Hash());
+}
+
+//______________________________________________________________________________
+TNamed* TCFileManager::CreateManifestEntry(const Char_t* fileName)
+{
+    // Return the manifest entry of the file 'fileName' containing its size and
+    // modification time, or 0 if the file could not be accessed.
+    // NOTE: The entry must be destroyed by the caller.
+
+    // get file information
+    FileStat_t st;
+    if (gSystem->GetPathInfo(fileName, st)) return 0;
+
+    return new TNamed(fileName, TString::Format("%lld %ld", st.fSize, st.fMtime).Data());
+}
 
-            // clean-up
-            delete h;
+//______________________________________________________________________________
+TH1* TCFileManager::ReadCacheFile(const Char_t* fileName, const Char_t* key, THashList** outManifest)
+{
+    // Read the summed histogram from the cache file 'fileName' if it was
+    // written with the cache key 'key'. The manifest of the files the histogram
+    // was summed from is returned via 'outManifest'.
+    // Return 0 if there is no valid cache file.
+    // NOTE: The histogram and the manifest must be destroyed by the caller.
+
+    // init manifest
+    *outManifest = 0;
+
+    // check cache file
+    if (gSystem->AccessPathName(fileName)) return 0;
+
+    // open the cache file
+    TFile* f = TFile::Open(fileName);
+    if (!f || f->IsZombie())
+    {
+        if (f) delete f;
+        return 0;
+    }
+
+    // read the cache
+    Bool_t status = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(kFALSE);
+    TNamed* k = (TNamed*) f->Get("key");
+    THashList* manifest = (THashList*) f->Get("manifest");
+    TH1* h = (TH1*) f->Get("histogram");
+    TH1::AddDirectory(status);
+    delete f;
+
+    // check the cache
+    Bool_t valid = k && manifest && h && !strcmp(k->GetTitle(), key);
+
+    // clean-up
+    if (k) delete k;
+    if (!valid)
+    {
+        if (h) delete h;
+        if (manifest)
+        {
+            manifest->Delete();
+            delete manifest;
         }
-        else
+        return 0;
+    }
+
+    manifest->SetOwner(kTRUE);
+    *outManifest = manifest;
+
+    return h;
+}
+
+//______________________________________________________________________________
+Bool_t TCFileManager::WriteCacheFile(const Char_t* fileName, const Char_t* key, TH1* h,
+                                     THashList* manifest)
+{
+    // Write the summed histogram 'h' together with the manifest 'manifest' of
+    // the files it was summed from and the cache key 'key' to the cache file
+    // 'fileName'. The cache file is replaced atomically.
+    // Return kTRUE on success, otherwise kFALSE.
+
+    // create the cache directory
+    gSystem->mkdir(gSystem->DirName(fileName), kTRUE);
+
+    // write to a temporary file first
+    TString tmp = TString::Format("%s.%d.tmp", fileName, gSystem->GetPid());
+    TFile* f = new TFile(tmp.Data(), "RECREATE");
+    if (f->IsZombie())
+    {
+        Warning("WriteCacheFile", "Could not write the histogram cache file '%s'", fileName);
+        delete f;
+        return kFALSE;
+    }
+
+    // write histogram, manifest and key
+    f->cd();
+    h->Write("histogram");
+    manifest->Write("manifest", TObject::kSingleKey);
+    TNamed k("key", key);
+    k.Write();
+    f->Close();
+    delete f;
+
+    // replace the cache file
+    if (gSystem->Rename(tmp.Data(), fileName))
+    {
+        Warning("WriteCacheFile", "Could not write the histogram cache file '%s'", fileName);
+        gSystem->Unlink(tmp.Data());
+        return kFALSE;
+    }
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+THashList* TCFileManager::BuildManifest() const
+{
+    // Return the manifest of the input files containing the size and the
+    // modification time of each file, or 0 if a file could not be accessed.
+    // NOTE: The list must be destroyed by the caller.
+
+    THashList* manifest = new THashList();
+    manifest->SetOwner(kTRUE);
+
+    // loop over files
+    for (Int_t i = 0; i < fFiles->GetN(); i++)
+    {
+        // add the file
+        TNamed* entry = CreateManifestEntry(fFiles->GetFileName(i));
+        if (!entry)
         {
-            Warning("GetHistogram", "Histogram '%s' was not found in file '%s'",
-                                    name, f->GetName());
+            delete manifest;
+            return 0;
         }
-    } // loop over files
+        manifest->Add(entry);
+    }
 
-    return hOut;
+    return manifest;
+}
+
+//______________________________________________________________________________
+TH1* TCFileManager::ReadCache(const Char_t* name, THashList* manifest, Int_t* outNew, Int_t& outNNew)
+{
+    // Read the cached sum of the histogram 'name' if all files it was summed
+    // from are input files unchanged according to the manifest 'manifest'.
+    // The 'outNNew' pool indices of the input files not contained in the cached
+    // sum are written to 'outNew'.
+    // Return the cached sum or 0 if there is no valid cached sum.
+    // NOTE: The histogram must be destroyed by the caller.
+
+    // read the cache file
+    TString key = GetCacheKey(fInputFilePatt.Data(), fCalibData.Data(), fCalibration.Data(),
+                              fNset, fSet, name);
+    THashList* cached;
+    TH1* h = ReadCacheFile(GetCacheFileName(fCacheDir.Data(), name, key.Data()).Data(),
+                           key.Data(), &cached);
+    if (!h) return 0;
+
+    // check if the cached files are unchanged input files
+    Bool_t valid = kTRUE;
+    TIter next(cached);
+    TNamed* entry;
+    while ((entry = (TNamed*)next()))
+    {
+        TNamed* input = (TNamed*) manifest->FindObject(entry->GetName());
+        if (!input || strcmp(input->GetTitle(), entry->GetTitle()))
+        {
+            valid = kFALSE;
+            break;
+        }
+    }
+
+    // collect the new files
+    if (valid)
+    {
+        outNNew = 0;
+        for (Int_t i = 0; i < fFiles->GetN(); i++)
+            if (!cached->FindObject(fFiles->GetFileName(i))) outNew[outNNew++] = i;
+    }
+    else
+    {
+        delete h;
+        h = 0;
+    }
+
+    // clean-up
+    delete cached;
+
+    return h;
 }
 
+//______________________________________________________________________________
+void TCFileManager::WriteCache(const Char_t* name, TH1* h, THashList* manifest)
+{
+    // Write the summed histogram 'h' with name 'name' summed from the input files
+    // described by the manifest 'manifest' to the cache.
+
+    TString key = GetCacheKey(fInputFilePatt.Data(), fCalibData.Data(), fCalibration.Data(),
+                              fNset, fSet, name);
+    WriteCacheFile(GetCacheFileName(fCacheDir.Data(), name, key.Data()).Data(), key.Data(),
+                   h, manifest);
+}
+
+//______________________________________________________________________________
+TH1* TCFileManager::GetHistogram(const Char_t* name)
+{
+    // Get the summed-up histogram with name 'name'.
+    // If a cache directory is configured the sum is cached and reused as long
+    // as the input files are unchanged. Sums of a subset of the input files
+    // are extended by the histograms of the remaining files.
+    // NOTE: the histogram has to be destroyed by the caller.
+
+    // check if there are some runs
+    if (!fFiles->GetN())
+    {
+        Error("GetHistogram", "ROOT file list is empty!");
+        return 0;
+    }
+
+    // do not keep histograms in memory
+    TH1::AddDirectory(kFALSE);
+
+    // get the files
+    Int_t n = fFiles->GetN();
+    Int_t files[n];
+    for (Int_t i = 0; i < n; i++) files[i] = i;
+
+    // sum up all files without cache
+    if (fCacheDir == "") return SumHistograms(name, n, files);
+
+    // build the manifest of the input files
+    THashList* manifest = BuildManifest();
+    if (!manifest) return SumHistograms(name, n, files);
+
+    // read the cached sum
+    Int_t newFiles[n];
+    Int_t nNew = 0;
+    TH1* hOut = ReadCache(name, manifest, newFiles, nNew);
+
+    // sum up all files or only the new ones
+    if (!hOut)
+    {
+        hOut = SumHistograms(name, n, files);
+    }
+    else if (nNew)
+    {
+        Info("GetHistogram", "Adding %d new files to the cached histogram '%s'",
+             nNew, name);
+        hOut = SumHistograms(name, nNew, newFiles, hOut);
+    }
+    else
+    {
+        Info("GetHistogram", "Using the cached histogram '%s'", name);
+        delete manifest;
+        return hOut;
+    }
+
+    // update the cache
+    if (hOut) WriteCache(name, hOut, manifest);
+
+    // clean-up
+    delete manifest;
+
+    return hOut;
+}
@@ -0,0 +1,322 @@
+/*************************************************************************
+ * Author: Dominik Werthmueller, Irakli Keshelashvili, Thomas Strub
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TCFilePool                                                           //
+//                                                                      //
+// Pool of lazily opened ROOT files.                                    //
+//                                                                      //
+// Files are opened on demand and the least recently used files are     //
+// closed if more than the maximum number of files are open. Files in   //
+// use (see Acquire() and Release()) are never closed.                  //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include "TFile.h"
+#include "TError.h"
+#include "TMutex.h"
+#include "TVirtualMutex.h"
+
+#include "TCFilePool.h"
+
+ClassImp(TCFilePool)
+
+//______________________________________________________________________________
+TCFilePool::TCFilePool(Int_t maxOpen)
+{
+    // Constructor keeping at most 'maxOpen' files open (0: unlimited).
+
+    // init members
+    fN = 0;
+    fSize = 0;
+    fNames = 0;
+    fFiles = 0;
+    fPinned = 0;
+    fPrev = 0;
+    fNext = 0;
+    fHead = -1;
+    fTail = -1;
+    fMaxOpen = maxOpen > 0 ? maxOpen : 0;
+    fNOpen = 0;
+    fNOpened = 0;
+    fNClosed = 0;
+    fMutex = new TMutex(kTRUE);
+}
+
+//______________________________________________________________________________
+TCFilePool::~TCFilePool()
+{
+    // Destructor.
+
+    Clear();
+    if (fNames) delete [] fNames;
+    if (fFiles) delete [] fFiles;
+    if (fPinned) delete [] fPinned;
+    if (fPrev) delete [] fPrev;
+    if (fNext) delete [] fNext;
+    if (fMutex) delete fMutex;
+}
+
+//______________________________________________________________________________
+void TCFilePool::Expand(Int_t size)
+{
+    // Expand the arrays to the size 'size'.
+
+    TString* names = new TString[size];
+    TFile** files = new TFile*[size];
+    Int_t* pinned = new Int_t[size];
+    Int_t* prev = new Int_t[size];
+    Int_t* next = new Int_t[size];
+
+    // copy the old entries
+    for (Int_t i = 0; i < fN; i++)
+    {
+        names[i] = fNames[i];
+        files[i] = fFiles[i];
+        pinned[i] = fPinned[i];
+        prev[i] = fPrev[i];
+        next[i] = fNext[i];
+    }
+
+    // replace the arrays
+    if (fNames) delete [] fNames;
+    if (fFiles) delete [] fFiles;
+    if (fPinned) delete [] fPinned;
+    if (fPrev) delete [] fPrev;
+    if (fNext) delete [] fNext;
+    fNames = names;
+    fFiles = files;
+    fPinned = pinned;
+    fPrev = prev;
+    fNext = next;
+    fSize = size;
+}
+
+//______________________________________________________________________________
+void TCFilePool::Link(Int_t i)
+{
+    // Insert the open file 'i' as most recently used file.
+
+    fPrev[i] = -1;
+    fNext[i] = fHead;
+    if (fHead != -1) fPrev[fHead] = i;
+    fHead = i;
+    if (fTail == -1) fTail = i;
+}
+
+//______________________________________________________________________________
+void TCFilePool::Unlink(Int_t i)
+{
+    // Remove the open file 'i' from the list of used files.
+
+    if (fPrev[i] != -1) fNext[fPrev[i]] = fNext[i];
+    else fHead = fNext[i];
+    if (fNext[i] != -1) fPrev[fNext[i]] = fPrev[i];
+    else fTail = fPrev[i];
+}
+
+//______________________________________________________________________________
+void TCFilePool::CloseUnused()
+{
+    // Close the least recently used files that are not in use until the
+    // maximum number of open files is respected.
+    // NOTE: the mutex has to be locked by the caller.
+
+    while (fMaxOpen && fNOpen > fMaxOpen)
+    {
+        // find the least recently used file not in use
+        Int_t i = fTail;
+        while (i != -1 && fPinned[i]) i = fPrev[i];
+        if (i == -1) break;
+
+        // close the file
+        Unlink(i);
+        delete fFiles[i];
+        fFiles[i] = 0;
+        fNOpen--;
+        fNClosed++;
+    }
+}
+
+//______________________________________________________________________________
+void TCFilePool::SetMaxOpen(Int_t n)
+{
+    // Set the maximum number of open files to 'n' (0: unlimited).
+
+    TLockGuard lock(fMutex);
+
+    fMaxOpen = n > 0 ? n : 0;
+    CloseUnused();
+}
+
+//______________________________________________________________________________
+Int_t TCFilePool::Add(const Char_t* name, TFile* f)
+{
+    // Add the file 'name' to the pool and return its index. If 'f' is non-zero
+    // it is taken as the already opened file 'name' and is owned by the pool.
+    // If 'name' is zero an empty entry is added that never holds a file.
+
+    TLockGuard lock(fMutex);
+
+    // expand the arrays
+    if (fN == fSize) Expand(fSize ? 2*fSize : 64);
+
+    // add the file
+    Int_t i = fN++;
+    fNames[i] = name ? name : "";
+    fFiles[i] = 0;
+    fPinned[i] = 0;
+    fPrev[i] = -1;
+    fNext[i] = -1;
+
+    // add the open file
+    if (f)
+    {
+        fFiles[i] = f;
+        Link(i);
+        fNOpen++;
+        fNOpened++;
+        CloseUnused();
+    }
+
+    return i;
+}
+
+//______________________________________________________________________________
+TFile* TCFilePool::Acquire(Int_t i)
+{
+    // Return the file with index 'i' and open it if necessary. The file is not
+    // closed until Release() was called for it.
+    // Return 0 if the file could not be opened.
+
+    // use an open file
+    TString name;
+    {
+        TLockGuard lock(fMutex);
+
+        // check the file
+        if (i < 0 || i >= fN || !fNames[i].Length()) return 0;
+
+        fPinned[i]++;
+        if (fFiles[i])
+        {
+            Unlink(i);
+            Link(i);
+            return fFiles[i];
+        }
+        name = fNames[i];
+    }
+
+    // open the file
+    TDirectory* dir = gDirectory;
+    TFile* f = TFile::Open(name.Data());
+    if (dir) dir->cd();
+
+    // check bad file
+    if (f && f->IsZombie())
+    {
+        delete f;
+        f = 0;
+    }
+
+    TLockGuard lock(fMutex);
+
+    // check the file
+    if (!f)
+    {
+        fPinned[i]--;
+        Error("Acquire", "Could not open file '%s'", name.Data());
+        return 0;
+    }
+
+    // add the file if no other thread opened it in the meantime
+    if (fFiles[i]) delete f;
+    else
+    {
+        fFiles[i] = f;
+        Link(i);
+        fNOpen++;
+        fNOpened++;
+        CloseUnused();
+    }
+
+    return fFiles[i];
+}
+
+//______________________________________________________________________________
+const Char_t* TCFilePool::GetFileName(Int_t i) const
+{
+    // Return the name of the file with index 'i'.
+    // NOTE: the name may be moved by the next call to Add().
+
+    TLockGuard lock(fMutex);
+
+    return i >= 0 && i < fN ? fNames[i].Data() : "";
+}
+
+//______________________________________________________________________________
+Bool_t TCFilePool::HasFile(Int_t i) const
+{
+    // Check if the entry with index 'i' holds a file.
+
+    TLockGuard lock(fMutex);
+
+    return i >= 0 && i < fN && fNames[i].Length() > 0;
+}
+
+//______________________________________________________________________________
+void TCFilePool::Release(Int_t i)
+{
+    // Release the file with index 'i' acquired via Acquire().
+
+    TLockGuard lock(fMutex);
+
+    if (i < 0 || i >= fN || !fPinned[i]) return;
+    fPinned[i]--;
+    CloseUnused();
+}
+
+//______________________________________________________________________________
+TFile* TCFilePool::Get(Int_t i)
+{
+    // Return the file with index 'i' and open it if necessary.
+    // NOTE: the file may be closed by the next call to Add(), Acquire() or
+    //       Get(). Use Acquire() and Release() to keep it open.
+
+    TFile* f = Acquire(i);
+    if (f)
+    {
+        TLockGuard lock(fMutex);
+        fPinned[i]--;
+    }
+
+    return f;
+}
+
+//______________________________________________________________________________
+void TCFilePool::Clear()
+{
+    // Close and remove all files. The counters are kept.
+
+    TLockGuard lock(fMutex);
+
+    // close the files
+    for (Int_t i = 0; i < fN; i++)
+    {
+        if (fFiles[i])
+        {
+            delete fFiles[i];
+            fNClosed++;
+        }
+    }
+
+    // reset the list
+    fN = 0;
+    fHead = -1;
+    fTail = -1;
+    fNOpen = 0;
+}
+
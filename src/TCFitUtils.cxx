@@ -15,40 +15,367 @@
 #include "TH1.h"
 #include "TF1.h"
 #include "TRandom.h"
+#include "TMath.h"
+#include "TString.h"
+#include "TRandom3.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TVirtualMutex.h"
+#include "TROOT.h"
+#include "RVersion.h"
+#include "Math/IFunction.h"
+#include "Math/Minimizer.h"
+#include "Math/MinimizerOptions.h"
+#include "Math/Factory.h"
 
 #include "TCFitUtils.h"
+#include "TCUtils.h"
 
 
+// job of the concurrent tries of ReFit()
+struct TCFitUtilsReFitJob
+{
+    TH1* fHisto;                            // histogram to fit
+    TF1** fFunc;                            // fit functions of the tries
+    Int_t* fStatus;                         // fit status of the tries
+    Option_t* fOption;                      // fit options
+    Bool_t fGausPol;                        // use FitGausPol()
+    const Char_t* fMinimizer;               // minimizer of FitGausPol() (0: default)
+    Int_t fN;                               // number of tries
+    Int_t fNext;                            // next try to perform
+    TMutex* fMutex;                         // mutex for the try index
+};
+
+// chi square returned for invalid parameters (zero sigma)
+static const Double_t kTCFitUtilsMaxChi2 = 1e30;
+
+// chi square of a gaus(0)+polN(3) function on binned data
+class TCFitUtilsGausPolChi2 : public ROOT::Math::IMultiGradFunction
+{
+
+private:
+    Int_t fN;                   // number of bins
+    Int_t fNpar;                // number of parameters
+    Double_t* fX;               //[fN] bin centers
+    Double_t* fY;               //[fN] bin contents
+    Double_t* fW;               //[fN] bin weights (inverse squared errors)
+
+    TCFitUtilsGausPolChi2(const TCFitUtilsGausPolChi2&);
+    TCFitUtilsGausPolChi2& operator=(const TCFitUtilsGausPolChi2&);
+
+    virtual Double_t DoEval(const Double_t* par) const;
+    virtual Double_t DoDerivative(const Double_t* par, UInt_t i) const;
+
+public:
+    TCFitUtilsGausPolChi2(TH1* h, Int_t first, Int_t last, Int_t npar);
+    virtual ~TCFitUtilsGausPolChi2();
+
+    virtual ROOT::Math::IMultiGenFunction* Clone() const;
+    virtual UInt_t NDim() const { return fNpar; }
+    virtual void Gradient(const Double_t* par, Double_t* grad) const;
+    virtual void FdF(const Double_t* par, Double_t& chi2, Double_t* grad) const;
+
+    Int_t GetN() const { return fN; }
+};
+
 //______________________________________________________________________________
-Bool_t TCFitUtils::ReFit(TH1* h, TF1* f, Option_t* option /*= ""*/, Int_t n /*= 10*/)
+TCFitUtilsGausPolChi2::TCFitUtilsGausPolChi2(TH1* h, Int_t first, Int_t last, Int_t npar)
 {
-    // Returns the best fit out of 'n' tries. Between the tries the parameter
-    // are randomized.
+    // Constructor using the bins 'first' to 'last' of the histogram 'h' and
+    // the 'npar' parameters of gaus(0)+polN(3). Empty bins are skipped.
 
-    // check input
-    if (!h || !f) return kFALSE;
+    // init members
+    fN = 0;
+    fNpar = npar;
+    Int_t n = last - first + 1 > 0 ? last - first + 1 : 0;
+    fX = new Double_t[n];
+    fY = new Double_t[n];
+    fW = new Double_t[n];
 
-    // local fit function
-    TF1 func(*f);
+    // copy the bins to contiguous arrays
+    for (Int_t i = first; i <= last; i++)
+    {
+        Double_t err = h->GetBinError(i);
+        if (err <= 0) continue;
+        fX[fN] = h->GetBinCenter(i);
+        fY[fN] = h->GetBinContent(i);
+        fW[fN] = 1. / (err*err);
+        fN++;
+    }
+}
 
-    // init return value
-    Bool_t success = kFALSE;
+//______________________________________________________________________________
+TCFitUtilsGausPolChi2::~TCFitUtilsGausPolChi2()
+{
+    // Destructor.
 
-    // try n times
-    for (Int_t i = 0; i < n; i++)
+    delete [] fX;
+    delete [] fY;
+    delete [] fW;
+}
+
+//______________________________________________________________________________
+ROOT::Math::IMultiGenFunction* TCFitUtilsGausPolChi2::Clone() const
+{
+    // Return a copy of this function.
+
+    TCFitUtilsGausPolChi2* f = new TCFitUtilsGausPolChi2(0, 0, -1, fNpar);
+    delete [] f->fX;
+    delete [] f->fY;
+    delete [] f->fW;
+    f->fN = fN;
+    f->fX = new Double_t[fN];
+    f->fY = new Double_t[fN];
+    f->fW = new Double_t[fN];
+    for (Int_t i = 0; i < fN; i++)
+    {
+        f->fX[i] = fX[i];
+        f->fY[i] = fY[i];
+        f->fW[i] = fW[i];
+    }
+
+    return f;
+}
+
+//______________________________________________________________________________
+Double_t TCFitUtilsGausPolChi2::DoEval(const Double_t* par) const
+{
+    // Return the chi square for the parameters 'par'.
+
+    // check the sigma
+    if (par[2] == 0) return kTCFitUtilsMaxChi2;
+
+    Double_t norm = par[0];
+    Double_t mean = par[1];
+    Double_t isig = 1. / par[2];
+    Int_t npol = fNpar - 4;
+    const Double_t* pol = par + 3;
+
+    // loop over bins
+    Double_t chi2 = 0;
+    for (Int_t i = 0; i < fN; i++)
+    {
+        // polynomial (Horner scheme)
+        Double_t p = pol[npol];
+        for (Int_t k = npol - 1; k >= 0; k--) p = p*fX[i] + pol[k];
+
+        // residual
+        Double_t t = (fX[i] - mean) * isig;
+        Double_t r = fY[i] - norm*TMath::Exp(-0.5*t*t) - p;
+        chi2 += fW[i]*r*r;
+    }
+
+    return chi2;
+}
+
+//______________________________________________________________________________
+void TCFitUtilsGausPolChi2::FdF(const Double_t* par, Double_t& chi2, Double_t* grad) const
+{
+    // Calculate the chi square 'chi2' and its gradient 'grad' for the
+    // parameters 'par' in one pass.
+
+    // reset sums
+    chi2 = 0;
+    for (Int_t k = 0; k < fNpar; k++) grad[k] = 0;
+
+    // check the sigma
+    if (par[2] == 0)
+    {
+        chi2 = kTCFitUtilsMaxChi2;
+        return;
+    }
+
+    Double_t norm = par[0];
+    Double_t mean = par[1];
+    Double_t isig = 1. / par[2];
+    Int_t npol = fNpar - 4;
+    const Double_t* pol = par + 3;
+
+    // loop over bins
+    for (Int_t i = 0; i < fN; i++)
+    {
+        Double_t x = fX[i];
+
+        // polynomial (Horner scheme)
+        Double_t p = pol[npol];
+        for (Int_t k = npol - 1; k >= 0; k--) p = p*x + pol[k];
+
+        // residual
+        Double_t t = (x - mean) * isig;
+        Double_t g = TMath::Exp(-0.5*t*t);
+        Double_t r = fY[i] - norm*g - p;
+        Double_t wr = fW[i]*r;
+        chi2 += wr*r;
+
+        // gradient of the gaussian
+        Double_t d = -2.*wr;
+        Double_t dg = d*norm*g*t*isig;
+        grad[0] += d*g;
+        grad[1] += dg;
+        grad[2] += dg*t;
+
+        // gradient of the polynomial
+        Double_t xk = 1;
+        for (Int_t k = 0; k <= npol; k++)
+        {
+            grad[3+k] += d*xk;
+            xk *= x;
+        }
+    }
+}
+
+//______________________________________________________________________________
+void TCFitUtilsGausPolChi2::Gradient(const Double_t* par, Double_t* grad) const
+{
+    // Calculate the gradient 'grad' of the chi square for the parameters 'par'.
+
+    Double_t chi2;
+    FdF(par, chi2, grad);
+}
+
+//______________________________________________________________________________
+Double_t TCFitUtilsGausPolChi2::DoDerivative(const Double_t* par, UInt_t i) const
+{
+    // Return the derivative of the chi square with respect to the parameter
+    // 'i' for the parameters 'par'.
+
+    Double_t grad[fNpar];
+    Gradient(par, grad);
+
+    return grad[i];
+}
+
+
+//______________________________________________________________________________
+static void* TCFitUtilsReFitThread(void* arg)
+{
+    // Perform the tries of a ReFit() job until all tries are done.
+
+    TCFitUtilsReFitJob* job = (TCFitUtilsReFitJob*) arg;
+
+    while (kTRUE)
     {
+        // get the next try
+        Int_t i;
+        {
+            TLockGuard lock(job->fMutex);
+            i = job->fNext++;
+        }
+        if (i >= job->fN) break;
+
         // try a fit
-        if (h->Fit(&func, option)) continue;
-        success = kTRUE;
+        job->fStatus[i] = job->fGausPol ? TCFitUtils::FitGausPol(job->fHisto, job->fFunc[i], job->fOption,
+                                                                 job->fMinimizer) :
+                                          (Int_t) job->fHisto->Fit(job->fFunc[i], job->fOption);
+    }
+
+    return 0;
+}
+
+//______________________________________________________________________________
+Bool_t TCFitUtils::ReFit(TH1* h, TF1* f, Option_t* option /*= ""*/, Int_t n /*= 10*/,
+                         TRandom* rnd /*= 0*/, Bool_t gausPol /*= kFALSE*/,
+                         Int_t nThreads /*= 1*/, const Char_t* minimizer /*= 0*/)
+{
+    // Returns the best fit out of 'n' tries. The first try starts at the
+    // parameters of 'f', the parameters of the other tries are randomized
+    // using random generators seeded by 'rnd' (gRandom if 0), one per try.
+    // If 'gausPol' is kTRUE 'f' has to be a gaus(0)+polN(3) function and is
+    // fitted using FitGausPol() with the minimizer 'minimizer' (0: default).
+    // In this case the tries are performed by 'nThreads' threads (ROOT 6
+    // only), which use the thread-safe Minuit2 if no minimizer is given.
+    // The result does not depend on the order in which the tries finish.
+
+    // check input
+    if (!h || !f || n <= 0) return kFALSE;
+
+    // local fit functions with per-try random parameters
+    if (!rnd) rnd = gRandom;
+    TF1** func = new TF1*[n];
+    Int_t* status = new Int_t[n];
+    for (Int_t i = 0; i < n; i++)
+    {
+        func[i] = new TF1(*f);
+        status[i] = -1;
+        if (i)
+        {
+            TRandom3 r(rnd->Integer(2147483646) + 1);
+            RandomizeParameters(func[i], 0, &r);
+        }
+    }
+
+    // create the job
+    TCFitUtilsReFitJob job;
+    job.fHisto = h;
+    job.fFunc = func;
+    job.fStatus = status;
+    job.fOption = option;
+    job.fGausPol = gausPol;
+    job.fMinimizer = minimizer;
+    job.fN = n;
+    job.fNext = 0;
+    job.fMutex = new TMutex();
+
+    // TH1::Fit() modifies the histogram
+    if (!gausPol) nThreads = 1;
+#if ROOT_VERSION_CODE < ROOT_VERSION(6,0,0)
+    // fits are not thread-safe before ROOT 6
+    nThreads = 1;
+#endif
+    nThreads = TMath::Min(nThreads, n);
+
+    // start the threads
+    TThread* threads[nThreads > 1 ? nThreads : 1];
+    if (nThreads > 1)
+    {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+        // enable ROOT's thread safety and use a thread-safe minimizer
+        ROOT::EnableThreadSafety();
+        if (!job.fMinimizer) job.fMinimizer = "Minuit2";
+#endif
+
+        for (Int_t i = 0; i < nThreads; i++)
+        {
+            threads[i] = new TThread(TCFitUtilsReFitThread, (void*) &job);
+            if (threads[i]->Run())
+            {
+                delete threads[i];
+                threads[i] = 0;
+            }
+        }
+    }
+
+    // perform the remaining tries in this thread
+    TCFitUtilsReFitThread((void*) &job);
+
+    // wait for the threads
+    for (Int_t i = 0; nThreads > 1 && i < nThreads; i++)
+    {
+        if (!threads[i]) continue;
+        threads[i]->Join();
+        delete threads[i];
+    }
 
-        // get better fit
-        TF1* g = GetBestChi2Func(&func, f);
-        if (g) *f = *g;
+    // select the best fit in the order of the tries
+    Bool_t success = kFALSE;
+    for (Int_t i = 0; i < n; i++)
+    {
+        if (!status[i])
+        {
+            success = kTRUE;
 
-        // randomize parameters
-        RandomizeParameters(&func);
+            // get better fit
+            TF1* g = GetBestChi2Func(func[i], f);
+            if (g) *f = *g;
+        }
+        delete func[i];
     }
 
+    // clean up
+    delete [] func;
+    delete [] status;
+    delete job.fMutex;
+
     // return
     return success;
 }
@@ -76,10 +403,10 @@ TF1* TCFitUtils::GetBestChi2Func(TF1* f1, TF1* f2)
 }
 
 //______________________________________________________________________________
-void TCFitUtils::RandomizeParameter(TF1* f, Int_t i)
+void TCFitUtils::RandomizeParameter(TF1* f, Int_t i, TRandom* rnd /*= 0*/)
 {
     // Sets the i-th parameter of function 'f' to a random value within the
-    // parameter limits.
+    // parameter limits using 'rnd' (gRandom if 0).
 
     // get par limits
     Double_t lo, hi;
@@ -89,13 +416,14 @@ void TCFitUtils::RandomizeParameter(TF1* f, Int_t i)
     if (lo >= hi) return;
 
     // randomize parameter
-    f->SetParameter(i, lo + (hi-lo)*gRandom->Rndm());
+    if (!rnd) rnd = gRandom;
+    f->SetParameter(i, lo + (hi-lo)*rnd->Rndm());
 }
 
 //______________________________________________________________________________
-void TCFitUtils::RandomizeParameters(TF1* f, Bool_t* isrand /*= 0*/)
+void TCFitUtils::RandomizeParameters(TF1* f, Bool_t* isrand /*= 0*/, TRandom* rnd /*= 0*/)
 {
-    // Randomizes the parameters of function 'f'
+    // Randomizes the parameters of function 'f' using 'rnd' (gRandom if 0).
 
     // loop over parameters
     for (Int_t i = 0; i < f->GetNpar(); i++)
@@ -104,7 +432,269 @@ void TCFitUtils::RandomizeParameters(TF1* f, Bool_t* isrand /*= 0*/)
         if (isrand && !isrand[i]) continue;
 
         // randomize
-        RandomizeParameter(f, i);
+        RandomizeParameter(f, i, rnd);
+    }
+}
+
+
+//______________________________________________________________________________
+Double_t TCFitUtils::EstimatePeak(TH1* h, Double_t xmin, Double_t xmax, Double_t* outPar, Int_t* outNDF /*= 0*/)
+{
+    // Estimate the gaussian peak on a linear background of the histogram 'h'
+    // in the range ['xmin', 'xmax'] without fitting. The parameters are stored
+    // to 'outPar' in the order of "gaus(0)+pol1(3)", i.e. height, mean, sigma,
+    // background offset and background slope.
+    // The mean and sigma are obtained from the logarithms of the background
+    // subtracted maximum bin and its neighbours (three-point gaussian). The
+    // moments of the background subtracted histogram are used as fallback.
+    // The number of degrees of freedom is stored to 'outNDF' if given.
+    // Return the chi square per degree of freedom of the estimated function
+    // as quality measure or -1 if no estimate could be made.
+
+    // check input
+    if (!h || xmin >= xmax) return -1;
+
+    // get the bin range
+    Int_t first = h->GetXaxis()->FindFixBin(xmin);
+    Int_t last = h->GetXaxis()->FindFixBin(xmax);
+    if (first < 1) first = 1;
+    if (last > h->GetNbinsX()) last = h->GetNbinsX();
+    if (last - first < 5) return -1;
+
+    // find the maximum bin
+    Int_t bmax = first;
+    for (Int_t i = first; i <= last; i++)
+        if (h->GetBinContent(i) > h->GetBinContent(bmax)) bmax = i;
+    Double_t peak = h->GetBinCenter(bmax);
+    Double_t width = h->GetBinWidth(bmax);
+
+    // estimate the background (FindBackground() includes the bin width)
+    Double_t bgSlope, bgOffset;
+    TCUtils::FindBackground(h, peak, peak - xmin, xmax - peak, &bgSlope, &bgOffset);
+    bgSlope /= width;
+    bgOffset /= width;
+
+    // three-point gaussian estimate
+    Double_t height = 0, mean = 0, sigma = 0;
+    if (bmax > first && bmax < last)
+    {
+        Double_t yl = h->GetBinContent(bmax-1) - bgOffset - bgSlope*h->GetBinCenter(bmax-1);
+        Double_t y0 = h->GetBinContent(bmax) - bgOffset - bgSlope*peak;
+        Double_t yr = h->GetBinContent(bmax+1) - bgOffset - bgSlope*h->GetBinCenter(bmax+1);
+        if (yl > 0 && y0 > 0 && yr > 0)
+        {
+            Double_t ll = TMath::Log(yl);
+            Double_t l0 = TMath::Log(y0);
+            Double_t lr = TMath::Log(yr);
+            Double_t curv = ll - 2*l0 + lr;
+            if (curv < 0)
+            {
+                Double_t delta = 0.5 * (ll - lr) / curv;
+                mean = peak + delta*width;
+                sigma = width * TMath::Sqrt(-1. / curv);
+                height = TMath::Exp(l0 - 0.25*(ll - lr)*delta);
+            }
+        }
+    }
+
+    // moment estimate as fallback
+    if (sigma <= 0)
+    {
+        Double_t sum = 0, sumX = 0, sumX2 = 0;
+        for (Int_t i = first; i <= last; i++)
+        {
+            Double_t x = h->GetBinCenter(i);
+            Double_t y = h->GetBinContent(i) - bgOffset - bgSlope*x;
+            if (y <= 0) continue;
+            sum += y;
+            sumX += y*x;
+            sumX2 += y*x*x;
+        }
+        if (sum <= 0) return -1;
+        mean = sumX / sum;
+        sigma = sumX2 / sum - mean*mean;
+        if (sigma <= 0) return -1;
+        sigma = TMath::Sqrt(sigma);
+        height = sum * width / (TMath::Sqrt(2*TMath::Pi()) * sigma);
+    }
+
+    // check the estimate
+    if (mean < xmin || mean > xmax) return -1;
+
+    // set the parameters
+    outPar[0] = height;
+    outPar[1] = mean;
+    outPar[2] = sigma;
+    outPar[3] = bgOffset;
+    outPar[4] = bgSlope;
+
+    // calculate the chi square of the estimate
+    Double_t chi2 = 0;
+    Int_t n = 0;
+    for (Int_t i = first; i <= last; i++)
+    {
+        // skip empty bins like the fit does
+        Double_t err = h->GetBinError(i);
+        if (err <= 0) continue;
+
+        Double_t x = h->GetBinCenter(i);
+        Double_t t = (x - mean) / sigma;
+        Double_t diff = h->GetBinContent(i) - height*TMath::Exp(-0.5*t*t) - bgOffset - bgSlope*x;
+        chi2 += diff*diff / (err*err);
+        n++;
+    }
+
+    // check the degrees of freedom
+    if (n <= 5) return -1;
+    if (outNDF) *outNDF = n - 5;
+
+    return chi2 / (Double_t)(n - 5);
+}
+
+//______________________________________________________________________________
+Bool_t TCFitUtils::EstimateFit(TH1* h, TF1* f, Double_t maxChi2)
+{
+    // Estimate the peak of the histogram 'h' in the range of the function 'f'
+    // using EstimatePeak(). 'f' has to be of the type "gaus(0)+polN(3)".
+    // If the chi square per degree of freedom of the estimate does not exceed
+    // 'maxChi2' and the mean and sigma are within the parameter limits of 'f',
+    // the estimate is set as parameters of 'f' and kTRUE is returned, i.e.
+    // the full fit can be skipped. The chi square and the degrees of freedom
+    // of 'f' are set to the ones of the estimate and the parameter errors are
+    // cleared. Otherwise 'f' is not modified.
+
+    // check input
+    if (!h || !f || maxChi2 <= 0 || f->GetNpar() < 5) return kFALSE;
+
+    // estimate the peak
+    Double_t xmin, xmax;
+    Double_t par[5];
+    Int_t ndf = 0;
+    f->GetRange(xmin, xmax);
+    Double_t chi2 = EstimatePeak(h, xmin, xmax, par, &ndf);
+    if (chi2 < 0 || chi2 > maxChi2) return kFALSE;
+
+    // check the limits of the mean and the sigma
+    for (Int_t i = 1; i <= 2; i++)
+    {
+        Double_t lo, hi;
+        f->GetParLimits(i, lo, hi);
+        if (lo < hi && (par[i] < lo || par[i] > hi)) return kFALSE;
+    }
+
+    // set the parameters (the estimate has no errors)
+    for (Int_t i = 0; i < f->GetNpar(); i++)
+    {
+        f->SetParameter(i, i < 5 ? par[i] : 0);
+        f->SetParError(i, 0);
     }
+
+    // set the fit quality of the estimate
+    f->SetChisquare(chi2 * ndf);
+    f->SetNDF(ndf);
+    f->SetNumberFitPoints(ndf + 5);
+
+    return kTRUE;
 }
 
+//______________________________________________________________________________
+Int_t TCFitUtils::FitGausPol(TH1* h, TF1* f, Option_t* option /*= ""*/,
+                             const Char_t* minimizer /*= 0*/)
+{
+    // Fit the histogram 'h' with the function 'f', which has to be of the type
+    // "gaus(0)+polN(3)", using a compiled chi square with analytic gradient
+    // instead of evaluating the formula of 'f'. The fit results are stored to
+    // 'f' as done by TH1::Fit(), but 'f' is not added to 'h'. If the
+    // minimization fails 'f' is not modified.
+    // The options "R", "B", "Q", "N" and "0" are supported. For other options
+    // TH1::Fit() is used.
+    // The minimizer 'minimizer' is used with its default algorithm. If it is 0
+    // the default minimizer of ROOT is used.
+    // Return the fit status (0 on success).
+
+    // check input
+    if (!h || !f) return -1;
+
+    // use the standard fit for unsupported options and functions
+    TString opt(option);
+    opt.ToUpper();
+    Bool_t useRange = opt.Contains("R");
+    for (Int_t i = 0; i < opt.Length(); i++)
+        if (!strchr("RBQN0", opt[i])) return h->Fit(f, option);
+    Int_t npar = f->GetNpar();
+    if (npar < 4) return h->Fit(f, option);
+
+    // get the bin range
+    Int_t first = h->GetXaxis()->GetFirst();
+    Int_t last = h->GetXaxis()->GetLast();
+    if (useRange)
+    {
+        Double_t xmin, xmax;
+        f->GetRange(xmin, xmax);
+        first = TMath::Max(first, h->GetXaxis()->FindFixBin(xmin));
+        last = TMath::Min(last, h->GetXaxis()->FindFixBin(xmax));
+    }
+
+    // create the chi square
+    TCFitUtilsGausPolChi2 chi2(h, first, last, npar);
+    if (!chi2.GetN()) return -1;
+
+    // create the minimizer
+    ROOT::Math::Minimizer* min = minimizer ?
+        ROOT::Math::Factory::CreateMinimizer(minimizer) :
+        ROOT::Math::Factory::CreateMinimizer(ROOT::Math::MinimizerOptions::DefaultMinimizerType(),
+                                             ROOT::Math::MinimizerOptions::DefaultMinimizerAlgo());
+    if (!min) return h->Fit(f, option);
+    min->SetFunction(chi2);
+    min->SetErrorDef(1);
+    min->SetPrintLevel(-1);
+
+    // set the parameters respecting the limits of 'f' (fixed parameters have
+    // lower limits not below the upper ones, see TF1::FixParameter())
+    Int_t nFree = 0;
+    for (Int_t i = 0; i < npar; i++)
+    {
+        Double_t par = f->GetParameter(i);
+        Double_t step = f->GetParError(i);
+        if (step <= 0) step = par ? 0.1*TMath::Abs(par) : 0.1;
+        Double_t lo, hi;
+        f->GetParLimits(i, lo, hi);
+        if (lo >= hi && (lo != 0 || hi != 0))
+        {
+            min->SetFixedVariable(i, f->GetParName(i), par);
+        }
+        else if (lo < hi)
+        {
+            min->SetLimitedVariable(i, f->GetParName(i), par, step, lo, hi);
+            nFree++;
+        }
+        else
+        {
+            min->SetVariable(i, f->GetParName(i), par, step);
+            nFree++;
+        }
+    }
+
+    // minimize
+    Bool_t ok = min->Minimize();
+    Int_t status = min->Status();
+
+    // keep the parameters of 'f' if the minimization failed
+    if (!ok)
+    {
+        delete min;
+        return status ? status : -1;
+    }
+
+    // store the results
+    f->SetParameters(min->X());
+    if (min->Errors()) f->SetParErrors(min->Errors());
+    f->SetChisquare(min->MinValue());
+    f->SetNumberFitPoints(chi2.GetN());
+    f->SetNDF(chi2.GetN() - nFree);
+
+    // clean-up
+    delete min;
+
+    return status;
+}
@@ -0,0 +1,418 @@
+/*************************************************************************
+ * Author: Dominik Werthmueller, Irakli Keshelashvili, Thomas Strub
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TCHistoAccumulator                                                   //
+//                                                                      //
+// Run-by-run histogram accumulation class.                             //
+//                                                                      //
+// The histograms of the files of the runs belonging to the runsets     //
+// are summed up run by run. Files of new runs are added as soon as     //
+// they appear in the input directory. The sums are checkpointed to     //
+// the histogram cache of TCFileManager (File.Cache.Dir), so that the   //
+// calibrations start from the accumulated sums instead of reading all  //
+// files again.                                                         //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include "TList.h"
+#include "TObjArray.h"
+#include "THashList.h"
+#include "TObjString.h"
+#include "TNamed.h"
+#include "TSystem.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TError.h"
+#include "TTimer.h"
+#include "TTimeStamp.h"
+
+#include "TCHistoAccumulator.h"
+#include "TCFileManager.h"
+#include "TCReadConfig.h"
+#include "TCMySQLManager.h"
+
+ClassImp(TCHistoAccumulator)
+
+//______________________________________________________________________________
+TCHistoAccumulator::TCHistoAccumulator(const Char_t* data, const Char_t* calibration,
+                                       Int_t nSet, Int_t* set, const Char_t* filePat)
+    : TObject()
+{
+    // Constructor using the calibration data 'data', the calibration identifier
+    // 'calibration' and the 'nSet' sets in the array 'set'.
+    // If filePat is non-zero use this file pattern instead of the one written
+    // in the configuration file.
+
+    // init members
+    fCalibData = data;
+    fCalibration = calibration;
+    fNset = nSet;
+    fSet = new Int_t[fNset];
+    for (Int_t i = 0; i < fNset; i++) fSet[i] = set[i];
+    fMinAge = 60;
+    fNames = new TList();
+    fNames->SetOwner(kTRUE);
+    fSums = new TObjArray();
+    fSums->SetOwner(kTRUE);
+    fManifests = new TObjArray();
+    fManifests->SetOwner(kTRUE);
+    fTimer = 0;
+
+    // read the checkpoint directory
+    if (TString* dir = TCReadConfig::GetReader()->GetConfig("File.Cache.Dir"))
+    {
+        Char_t* exp = gSystem->ExpandPathName(dir->Data());
+        fCheckpointDir = exp;
+        delete [] exp;
+    }
+    else
+    {
+        Warning("TCHistoAccumulator", "No histogram cache directory configured, sums will not be checkpointed!");
+    }
+
+    // read input file pattern
+    if (filePat) fInputFilePatt = filePat;
+    else
+    {
+        if (TString* f = TCReadConfig::GetReader()->GetConfig("File.Input.Rootfiles"))
+        {
+            fInputFilePatt = *f;
+
+            // check file pattern
+            if (!fInputFilePatt.Contains("RUN"))
+            {
+                Error("TCHistoAccumulator", "Error in file pattern configuration!");
+                return;
+            }
+        }
+        else
+        {
+            Error("TCHistoAccumulator", "Could not load input file pattern from configuration!");
+            return;
+        }
+    }
+}
+
+//______________________________________________________________________________
+TCHistoAccumulator::~TCHistoAccumulator()
+{
+    // Destructor.
+
+    if (fTimer) delete fTimer;
+    if (fNames) delete fNames;
+    if (fSums) delete fSums;
+    if (fManifests) delete fManifests;
+    if (fSet) delete [] fSet;
+}
+
+//______________________________________________________________________________
+TString TCHistoAccumulator::GetCacheKey(const Char_t* name) const
+{
+    // Return the histogram cache key of the histogram 'name'.
+
+    return TCFileManager::GetCacheKey(fInputFilePatt.Data(), fCalibData.Data(), fCalibration.Data(),
+                                      fNset, fSet, name);
+}
+
+//______________________________________________________________________________
+void TCHistoAccumulator::ResetHistogram(Int_t i)
+{
+    // Reset the sum of the 'i'-th histogram.
+
+    delete fSums->RemoveAt(i);
+    ((THashList*) fManifests->At(i))->Delete();
+}
+
+//______________________________________________________________________________
+void TCHistoAccumulator::ReadCheckpoint(Int_t i)
+{
+    // Start the sum of the 'i'-th histogram from its checkpoint if the files
+    // it was summed from did not change.
+
+    // check checkpoint directory
+    if (fCheckpointDir == "") return;
+
+    // read the checkpoint
+    const Char_t* name = ((TObjString*) fNames->At(i))->GetString().Data();
+    TString key = GetCacheKey(name);
+    THashList* manifest;
+    TH1* h = TCFileManager::ReadCacheFile(TCFileManager::GetCacheFileName(fCheckpointDir.Data(),
+                                                                          name, key.Data()).Data(),
+                                          key.Data(), &manifest);
+    if (!h) return;
+
+    // check if the files are unchanged
+    TIter next(manifest);
+    TNamed* entry;
+    while ((entry = (TNamed*)next()))
+    {
+        TNamed* current = TCFileManager::CreateManifestEntry(entry->GetName());
+        Bool_t changed = !current || strcmp(current->GetTitle(), entry->GetTitle());
+        if (current) delete current;
+        if (changed)
+        {
+            Warning("ReadCheckpoint", "File '%s' changed, summing up histogram '%s' again",
+                    entry->GetName(), name);
+            delete h;
+            delete manifest;
+            return;
+        }
+    }
+
+    // use the checkpoint
+    Info("ReadCheckpoint", "Starting histogram '%s' from %d files", name, manifest->GetSize());
+    delete fSums->RemoveAt(i);
+    delete fManifests->RemoveAt(i);
+    fSums->AddAt(h, i);
+    fManifests->AddAt(manifest, i);
+}
+
+//______________________________________________________________________________
+void TCHistoAccumulator::AddHistogram(const Char_t* name)
+{
+    // Add the histogram 'name' to the accumulated histograms. The sum is
+    // started from the checkpoint if it is still valid.
+
+    // check if histogram was already added
+    if (fNames->FindObject(name)) return;
+
+    // add the histogram
+    Int_t i = fNames->GetSize();
+    fNames->Add(new TObjString(name));
+    THashList* manifest = new THashList();
+    manifest->SetOwner(kTRUE);
+    fSums->AddAtAndExpand(0, i);
+    fManifests->AddAtAndExpand(manifest, i);
+
+    // read the checkpoint
+    ReadCheckpoint(i);
+}
+
+//______________________________________________________________________________
+TH1* TCHistoAccumulator::GetHistogram(const Char_t* name) const
+{
+    // Return the current sum of the histogram 'name' or 0 if no file was
+    // summed up yet.
+    // NOTE: the histogram is owned by this class and changes with Update().
+
+    TObject* o = fNames->FindObject(name);
+    if (!o) return 0;
+
+    return (TH1*) fSums->At(fNames->IndexOf(o));
+}
+
+//______________________________________________________________________________
+Int_t TCHistoAccumulator::GetNFiles(const Char_t* name) const
+{
+    // Return the number of files summed up for the histogram 'name'.
+
+    TObject* o = fNames->FindObject(name);
+    if (!o) return 0;
+
+    return ((THashList*) fManifests->At(fNames->IndexOf(o)))->GetSize();
+}
+
+//______________________________________________________________________________
+Int_t TCHistoAccumulator::Update()
+{
+    // Add the histograms of the files of new runs of the runsets. Files younger
+    // than 'fMinAge' seconds are skipped as they might still be written.
+    // Sums of files that changed since they were summed up are rebuilt.
+    // The sums are checkpointed if files were added.
+    // Return the number of files added.
+
+    Int_t nHisto = fNames->GetSize();
+    if (!nHisto) return 0;
+
+    // rebuild the sums of changed files
+    for (Int_t i = 0; i < nHisto; i++)
+    {
+        THashList* manifest = (THashList*) fManifests->At(i);
+        TIter next(manifest);
+        TNamed* entry;
+        while ((entry = (TNamed*)next()))
+        {
+            TNamed* current = TCFileManager::CreateManifestEntry(entry->GetName());
+            Bool_t changed = !current || strcmp(current->GetTitle(), entry->GetTitle());
+            if (current) delete current;
+            if (changed)
+            {
+                Warning("Update", "File '%s' changed, summing up histogram '%s' again",
+                        entry->GetName(), ((TObjString*) fNames->At(i))->GetString().Data());
+                ResetHistogram(i);
+                break;
+            }
+        }
+    }
+
+    // do not keep histograms in memory
+    Bool_t status = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(kFALSE);
+
+    // current time
+    TTimeStamp now;
+
+    // loop over sets
+    Int_t nAdded = 0;
+    for (Int_t i = 0; i < fNset; i++)
+    {
+        // get the list of runs for this set (the database may have new runs)
+        Int_t nRun;
+        Int_t* runs = TCMySQLManager::GetManager()->GetRunsOfSet(fCalibData.Data(), fCalibration.Data(), fSet[i], &nRun);
+        if (!runs) continue;
+
+        // loop over runs
+        for (Int_t j = 0; j < nRun; j++)
+        {
+            // construct file name
+            TString filename(fInputFilePatt);
+            filename.ReplaceAll("RUN", TString::Format("%d", runs[j]));
+
+            // check if the file is needed
+            Bool_t needed = kFALSE;
+            for (Int_t k = 0; k < nHisto; k++)
+                if (!((THashList*) fManifests->At(k))->FindObject(filename.Data())) needed = kTRUE;
+            if (!needed) continue;
+
+            // check if the file is there and complete
+            TNamed* entry = TCFileManager::CreateManifestEntry(filename.Data());
+            if (!entry) continue;
+            FileStat_t st;
+            gSystem->GetPathInfo(filename.Data(), st);
+            if (now.GetSec() - st.fMtime < fMinAge)
+            {
+                delete entry;
+                continue;
+            }
+
+            // open the file
+            TFile* f = TFile::Open(filename.Data());
+            if (!f || f->IsZombie())
+            {
+                Warning("Update", "Could not open file '%s'", filename.Data());
+                if (f) delete f;
+                delete entry;
+                continue;
+            }
+
+            // loop over histograms
+            for (Int_t k = 0; k < nHisto; k++)
+            {
+                // check if the file was already added
+                THashList* manifest = (THashList*) fManifests->At(k);
+                if (manifest->FindObject(filename.Data())) continue;
+
+                // read the histogram
+                const Char_t* name = ((TObjString*) fNames->At(k))->GetString().Data();
+                TH1* h = (TH1*) f->Get(name);
+                if (!h)
+                {
+                    Warning("Update", "Histogram '%s' was not found in file '%s'",
+                            name, filename.Data());
+                }
+                else if (!h->InheritsFrom("TH1"))
+                {
+                    Error("Update", "Object '%s' found in file '%s' is not a histogram!",
+                          name, filename.Data());
+                    delete h;
+                }
+                else
+                {
+                    // add the histogram
+                    if (TH1* sum = (TH1*) fSums->At(k))
+                    {
+                        sum->Add(h);
+                        delete h;
+                    }
+                    else fSums->AddAt(h, k);
+                }
+
+                // mark the file as added
+                manifest->Add(new TNamed(*entry));
+            }
+
+            // clean-up
+            delete f;
+            delete entry;
+
+            // user information
+            Info("Update", "%03d : added file '%s'", j, filename.Data());
+            nAdded++;
+        }
+
+        // clean-up
+        delete [] runs;
+    }
+
+    TH1::AddDirectory(status);
+
+    // write the checkpoint
+    if (nAdded) Checkpoint();
+
+    return nAdded;
+}
+
+//______________________________________________________________________________
+Bool_t TCHistoAccumulator::Checkpoint()
+{
+    // Write the sums to the histogram cache.
+    // Return kTRUE on success, otherwise kFALSE.
+
+    // check checkpoint directory
+    if (fCheckpointDir == "") return kFALSE;
+
+    // loop over histograms
+    Bool_t ok = kTRUE;
+    for (Int_t i = 0; i < fNames->GetSize(); i++)
+    {
+        TH1* h = (TH1*) fSums->At(i);
+        if (!h) continue;
+
+        // write the sum
+        const Char_t* name = ((TObjString*) fNames->At(i))->GetString().Data();
+        TString key = GetCacheKey(name);
+        if (!TCFileManager::WriteCacheFile(TCFileManager::GetCacheFileName(fCheckpointDir.Data(),
+                                                                           name, key.Data()).Data(),
+                                           key.Data(), h, (THashList*) fManifests->At(i)))
+            ok = kFALSE;
+    }
+
+    return ok;
+}
+
+//______________________________________________________________________________
+void TCHistoAccumulator::Watch(Long_t interval)
+{
+    // Watch the input directory for new files every 'interval' milliseconds.
+    // Stop watching if 'interval' is 0.
+
+    // stop the timer
+    if (fTimer)
+    {
+        delete fTimer;
+        fTimer = 0;
+    }
+
+    // start the timer
+    if (interval > 0)
+    {
+        Update();
+        fTimer = new TTimer(this, interval);
+        fTimer->TurnOn();
+    }
+}
+
+//______________________________________________________________________________
+Bool_t TCHistoAccumulator::HandleTimer(TTimer* /*timer*/)
+{
+    // Add new files when the watch timer expired.
+
+    Update();
+
+    return kTRUE;
+}
+
@@ -13,6 +13,7 @@
 
 #include <fstream>
 #include <vector>
+#include <algorithm>
 
 #include "THashList.h"
 #include "TError.h"
@@ -20,9 +21,17 @@
 #include "TSQLServer.h"
 #include "TSQLRow.h"
 #include "TSQLResult.h"
+#include "TSQLStatement.h"
 #include "TObjArray.h"
 #include "TObjString.h"
+#include "TNamed.h"
+#include "TParameter.h"
 #include "TFile.h"
+#include "TMath.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TVirtualMutex.h"
+#include "TDatime.h"
 
 #include "TCMySQLManager.h"
 #include "TCReadConfig.h"
@@ -33,6 +42,7 @@
 #include "TCCalibType.h"
 #include "TCBadScRElement.h"
 #include "TCContainer.h"
+#include "TCParCache.h"
 
 ClassImp(TCMySQLManager)
 
@@ -45,12 +55,43 @@ TCMySQLManager::TCMySQLManager()
     // Constructor.
 
     fDB = 0;
+    fMainThread = TThread::SelfId();
+    fConnBusy = new TList();
+    fConnIdle = new TList();
+    fPoolSize = 4;
+    fRetries = 3;
+    fRetryDelay = 500;
+    fMutex = new TMutex(kTRUE);
     fDBType = kNoType;
+    fParStorage = kParColumns;
+    fTableStorage = new THashList();
+    fTableStorage->SetOwner(kTRUE);
+    fBadScRTable = kFALSE;
     fSilence = kFALSE;
     fData = new THashList();
     fData->SetOwner(kTRUE);
     fTypes = new THashList();
     fTypes->SetOwner(kTRUE);
+    fSetIndex = new THashList();
+    fSetIndex->SetOwner(kTRUE);
+    fSetIndexGen = 0;
+    fStmtCache = new THashList();
+    fStmtCache->SetOwner(kTRUE);
+    fTransDepth = 0;
+    fBatchSize = 250;
+    fParCache = 0;
+
+    // get the bulk write batch size
+    Int_t batchSize = TCReadConfig::GetReader()->GetConfigInt("DB.BulkBatchSize");
+    if (batchSize > 0) fBatchSize = batchSize;
+
+    // get the connection pool and reconnection settings
+    Int_t poolSize = TCReadConfig::GetReader()->GetConfigInt("DB.Pool.Size");
+    if (poolSize > 0) fPoolSize = poolSize;
+    Int_t retries = TCReadConfig::GetReader()->GetConfigInt("DB.Reconnect.Retries");
+    if (retries > 0) fRetries = retries;
+    Int_t retryDelay = TCReadConfig::GetReader()->GetConfigInt("DB.Reconnect.Delay");
+    if (retryDelay > 0) fRetryDelay = retryDelay;
 
     // read CaLib data
     if (!ReadCaLibData())
@@ -79,7 +120,8 @@ TCMySQLManager::TCMySQLManager()
         Char_t szMySQL[200];
         Char_t* exp = gSystem->ExpandPathName(strDBFile->Data());
         sprintf(szMySQL, "sqlite://%s", exp);
-        fDB = TSQLServer::Connect(szMySQL, "", "");
+        fDBUrl = szMySQL;
+        fDB = TSQLServer::Connect(fDBUrl.Data(), "", "");
 
         // check DB connection
         if (!fDB)
@@ -102,6 +144,12 @@ TCMySQLManager::TCMySQLManager()
                                 strDBFile->Data(), TCConfig::kCaLibVersion);
             fDBType = kSQLite;
             delete exp;
+
+            // wait for the locks of other connections (e.g. the background writer)
+            fDB->Exec("PRAGMA busy_timeout = 10000");
+
+            DetectParStorage();
+            DetectBadScRStorage();
         }
     }
     else
@@ -142,7 +190,10 @@ TCMySQLManager::TCMySQLManager()
         // open connection to MySQL server on localhost
         Char_t szMySQL[200];
         sprintf(szMySQL, "mysql://%s/%s", strDBHost->Data(), strDBName->Data());
-        fDB = TSQLServer::Connect(szMySQL, strDBUser->Data(), strDBPass->Data());
+        fDBUrl = szMySQL;
+        fDBUser = *strDBUser;
+        fDBPass = *strDBPass;
+        fDB = TSQLServer::Connect(fDBUrl.Data(), fDBUser.Data(), fDBPass.Data());
 
         // check DB connection
         if (!fDB)
@@ -162,8 +213,15 @@ TCMySQLManager::TCMySQLManager()
             if (!fSilence) Info("TCMySQLManager", "Connected to the database '%s' on '%s@%s' using CaLib %s",
                                 strDBName->Data(), strDBUser->Data(), strDBHost->Data(), TCConfig::kCaLibVersion);
             fDBType = kMySQL;
+            DetectParStorage();
+            DetectBadScRStorage();
         }
     }
+
+    // open the local parameter cache file
+    TString* strCacheFile;
+    if ((strCacheFile = TCReadConfig::GetReader()->GetConfig("DB.Cache.File")))
+        OpenParCache(strCacheFile->Data());
 }
 
 //______________________________________________________________________________
@@ -171,10 +229,26 @@ TCMySQLManager::~TCMySQLManager()
 {
     // Destructor.
 
-    // close DB
+    // close parameter cache and DB
+    CloseParCache();
     if (fDB) delete fDB;
+
+    // close pooled connections
+    TList* pool[2] = { fConnBusy, fConnIdle };
+    for (Int_t i = 0; i < 2; i++)
+    {
+        TIter next(pool[i]);
+        TCDBConnection* c;
+        while ((c = (TCDBConnection*)next())) delete c->GetServer();
+        pool[i]->Delete();
+        delete pool[i];
+    }
+    if (fMutex) delete fMutex;
     if (fData) delete fData;
     if (fTypes) delete fTypes;
+    if (fSetIndex) delete fSetIndex;
+    if (fStmtCache) delete fStmtCache;
+    if (fTableStorage) delete fTableStorage;
 }
 
 //______________________________________________________________________________
@@ -404,7 +478,13 @@ TSQLResult* TCMySQLManager::SendQuery(const Char_t* query)
     }
 
     // execute query
-    return fDB->Query(query);
+    TSQLServer* db = GetConnection();
+    TSQLResult* res = db->Query(query);
+
+    // reconnect and retry if the connection was lost
+    if (!res && IsConnectionLost(db) && Reconnect()) res = GetConnection()->Query(query);
+
+    return res;
 }
 
 //______________________________________________________________________________
@@ -486,226 +566,453 @@ Bool_t TCMySQLManager::SendExec(const Char_t* sql)
     }
 
     // execute command
-    return fDB->Exec(sql);
+    TSQLServer* db = GetConnection();
+    Bool_t res = db->Exec(sql);
+
+    // reconnect and retry if the connection was lost
+    if (!res && IsConnectionLost(db) && Reconnect()) res = GetConnection()->Exec(sql);
+
+    return res;
 }
 
 //______________________________________________________________________________
-Bool_t TCMySQLManager::IsConnected()
+TSQLStatement* TCMySQLManager::PrepareStatement(const Char_t* sql)
 {
-    // Check if the connection to the database is open.
+    // Prepare the SQL statement 'sql' containing '?' parameter placeholders.
+    // Return the statement or 0 if an error occurred.
+    // NOTE: The statement must be destroyed by the caller.
 
-    if (!fDB)
+    // check server connection
+    if (!IsConnected())
     {
-        if (!fSilence) Error("IsConnected", "Cannot access database!");
-        return kFALSE;
+        if (!fSilence) Error("PrepareStatement", "No connection to the database!");
+        return 0;
     }
-    else
-        return kTRUE;
+
+    // check statement support
+    TSQLServer* db = GetConnection();
+    if (!db->HasStatement())
+    {
+        if (!fSilence) Error("PrepareStatement", "The database does not support statements!");
+        return 0;
+    }
+
+    // prepare statement (reconnect and retry if the connection was lost)
+    TSQLStatement* stmt = db->Statement(sql);
+    if (!stmt && IsConnectionLost(db) && Reconnect()) stmt = GetConnection()->Statement(sql);
+    if (!stmt)
+    {
+        if (!fSilence) Error("PrepareStatement", "Could not prepare the statement '%s'!", sql);
+        return 0;
+    }
+
+    return stmt;
 }
 
 //______________________________________________________________________________
-Bool_t TCMySQLManager::SearchTable(const Char_t* data, Char_t* outTableName)
+TSQLStatement* TCMySQLManager::PrepareBindStatement(const Char_t* sql)
 {
-    // Search the table name of the calibration quantity 'data' and write it
-    // to 'outTableName'.
-    // Return kTRUE when a true table was found, otherwise kFALSE.
+    // Prepare the SQL statement 'sql' ready to bind the parameters of the first
+    // row, i.e. NextIteration() was already called. Further rows of a batch are
+    // bound after calling NextIteration() again and all rows are executed by
+    // one call of Process().
+    // Return 0 if an error occurred.
+    // NOTE: The statement must be destroyed by the caller.
+
+    // prepare the statement
+    TSQLStatement* stmt = PrepareStatement(sql);
+    if (!stmt) return 0;
+    if (!stmt->NextIteration())
+    {
+        if (!fSilence) Error("PrepareBindStatement", "Could not bind the statement '%s'!", sql);
+        delete stmt;
+        return 0;
+    }
 
-    // get CaLib data
-    TCCalibData* d = GetCalibData(data);
+    return stmt;
+}
 
-    // check data
-    if (d)
-    {
-        // copy table name
-        strcpy(outTableName, d->GetTableName());
-        return kTRUE;
+//______________________________________________________________________________
+const Char_t* TCMySQLManager::GetParameterSQL(EParStatement type, const Char_t* table, Int_t length)
+{
+    // Return the SQL of the statement 'type' accessing 'length' parameters of a
+    // set in the data table 'table'. The SQL is created only once and cached.
+    // kParSelect: parameters 0 - 'length'-1 are selected, bind calibration and first run
+    // kParSelectSet: description, first run, last run, change time and parameters
+    //                0 - 'length'-1 are selected, bind calibration and first run
+    // kParSelectAll: same as kParSelectSet for all sets ordered by their first run,
+    //                bind calibration
+    // kParUpdate: bind parameters 0 - 'length'-1, calibration and first run
+    // kParInsert: bind calibration, description, first run, last run and parameters
+    //             0 - 'length'-1
+    // If the table uses packed storage all parameters are accessed via the BLOB
+    // column 'par_blob' instead of the parameter columns.
+
+    // packed storage does not depend on the number of parameters
+    Bool_t packed = GetTableStorage(table) == kParBlob;
+    if (packed) length = 0;
+
+    // lock the cache
+    TLockGuard lock(fMutex);
+
+    // search the SQL in the cache
+    TString key = TString::Format("%d|%d|%s|%d", packed, type, table, length);
+    TNamed* cached = (TNamed*) fStmtCache->FindObject(key.Data());
+    if (cached) return cached->GetTitle();
+
+    // create the SQL
+    TString sql;
+    switch (type)
+    {
+        case kParSelect:
+        {
+            if (packed)
+            {
+                sql = TString::Format("SELECT par_blob FROM %s WHERE calibration = ? AND first_run = ?", table);
+                break;
+            }
+            sql = "SELECT ";
+            for (Int_t i = 0; i < length; i++)
+            {
+                if (i) sql.Append(", ");
+                sql.Append(TString::Format("par_%03d", i));
+            }
+            sql.Append(TString::Format(" FROM %s WHERE calibration = ? AND first_run = ?", table));
+            break;
+        }
+        case kParSelectSet:
+        case kParSelectAll:
+        {
+            sql = "SELECT description, first_run, last_run, changed";
+            if (packed) sql.Append(", par_blob");
+            for (Int_t i = 0; i < length; i++) sql.Append(TString::Format(", par_%03d", i));
+            if (type == kParSelectSet)
+                sql.Append(TString::Format(" FROM %s WHERE calibration = ? AND first_run = ?", table));
+            else
+                sql.Append(TString::Format(" FROM %s WHERE calibration = ? ORDER BY first_run ASC", table));
+            break;
+        }
+        case kParUpdate:
+        {
+            if (packed)
+            {
+                sql = TString::Format("UPDATE %s SET par_blob = ? WHERE calibration = ? AND first_run = ?", table);
+                break;
+            }
+            sql = TString::Format("UPDATE %s SET ", table);
+            for (Int_t i = 0; i < length; i++)
+            {
+                if (i) sql.Append(", ");
+                sql.Append(TString::Format("par_%03d = ?", i));
+            }
+            sql.Append(" WHERE calibration = ? AND first_run = ?");
+            break;
+        }
+        case kParInsert:
+        {
+            if (packed)
+            {
+                sql = TString::Format("INSERT INTO %s (calibration, description, first_run, last_run, par_blob) "
+                                      "VALUES (?, ?, ?, ?, ?)", table);
+                break;
+            }
+            TString values = "?, ?, ?, ?";
+            sql = TString::Format("INSERT INTO %s (calibration, description, first_run, last_run", table);
+            for (Int_t i = 0; i < length; i++)
+            {
+                sql.Append(TString::Format(", par_%03d", i));
+                values.Append(", ?");
+            }
+            sql.Append(TString::Format(") VALUES (%s)", values.Data()));
+            break;
+        }
     }
-    else return kFALSE;
+
+    // cache the SQL
+    cached = new TNamed(key.Data(), sql.Data());
+    fStmtCache->Add(cached);
+
+    return cached->GetTitle();
 }
 
 //______________________________________________________________________________
-Bool_t TCMySQLManager::SearchRunEntry(Int_t run, const Char_t* name, TString& outInfo)
+TString TCMySQLManager::QuoteString(const Char_t* str) const
 {
-    // Search the information 'name' for the run 'run' and write it to 'outInfo'.
-    // Return kTRUE when the information was found, otherwise kFALSE.
+    // Return the string 'str' as escaped and quoted SQL string literal.
 
-    TString query;
+    TString out(str ? str : "");
 
-    // create the query
-    query.Form("SELECT %s FROM %s "
-               "WHERE run = %d",
-               name, TCConfig::kCalibMainTableName, run);
+    // escape backslashes (MySQL only) and quotes
+    if (fDBType == kMySQL) out.ReplaceAll("\\", "\\\\");
+    out.ReplaceAll("'", "''");
 
-    // read from database
-    TSQLResult* res = SendQuery(query.Data());
+    return TString::Format("'%s'", out.Data());
+}
 
-    // check result
-    if (!res)
+//______________________________________________________________________________
+void TCMySQLManager::DetectParStorage()
+{
+    // Detect the parameter storage mode of each data table of the database.
+    // New data tables use the mode of the existing tables. If no data tables
+    // exist or if the modes are mixed (e.g. after an interrupted upgrade) the
+    // mode for new tables is read from the configuration.
+
+    // check server connection
+    if (!IsConnected()) return;
+
+    // reset the modes
+    fTableStorage->Delete();
+
+    // suppress error output of the probe queries
+    TSQLServer* db = GetConnection();
+    Bool_t errOut = db->IsErrorOutputEnabled();
+    db->EnableErrorOutput(kFALSE);
+
+    // loop over data tables
+    Int_t nBlob = 0;
+    Int_t nCol = 0;
+    TIter next(fData);
+    TCCalibData* d;
+    while ((d = (TCCalibData*)next()))
     {
-        if (!fSilence) Error("SearchRunEntry", "Could not find the information '%s' for run %d!",
-                                               name, run);
-        return kFALSE;
+        // probe the data table columns
+        TSQLResult* res = SendQuery(TString::Format("SELECT par_blob FROM %s LIMIT 1",
+                                                    d->GetTableName()).Data());
+        if (res)
+        {
+            SetTableStorage(d->GetTableName(), kParBlob);
+            nBlob++;
+            delete res;
+            continue;
+        }
+        res = SendQuery(TString::Format("SELECT par_000 FROM %s LIMIT 1",
+                                        d->GetTableName()).Data());
+        if (res)
+        {
+            SetTableStorage(d->GetTableName(), kParColumns);
+            nCol++;
+            delete res;
+        }
     }
 
-    // get row
-    TSQLRow* row = res->Next();
+    // restore error output
+    db->EnableErrorOutput(errOut);
 
-    // check row
-    if (!row)
+    // set the storage mode for new tables
+    if (nBlob && !nCol) fParStorage = kParBlob;
+    else if (nCol && !nBlob) fParStorage = kParColumns;
+    else ReadParStorageConfig();
+
+    // user information
+    if (!fSilence && nBlob && nCol)
+        Warning("DetectParStorage", "%d data tables use packed and %d column parameter storage - "
+                "repeat the database upgrade to version 6", nBlob, nCol);
+    else if (!fSilence && fParStorage == kParBlob)
+        Info("DetectParStorage", "Using packed parameter storage");
+}
+
+//______________________________________________________________________________
+ParStorage_t TCMySQLManager::GetTableStorage(const Char_t* table) const
+{
+    // Return the parameter storage mode of the data table 'table'. Tables that
+    // were not found when connecting use the mode for new tables.
+
+    TLockGuard lock(fMutex);
+    TParameter<Int_t>* p = (TParameter<Int_t>*) fTableStorage->FindObject(table);
+
+    return p ? (ParStorage_t) p->GetVal() : fParStorage;
+}
+
+//______________________________________________________________________________
+void TCMySQLManager::SetTableStorage(const Char_t* table, ParStorage_t storage)
+{
+    // Set the parameter storage mode of the data table 'table' to 'storage'.
+
+    TLockGuard lock(fMutex);
+    TParameter<Int_t>* p = (TParameter<Int_t>*) fTableStorage->FindObject(table);
+    if (p) p->SetVal(storage);
+    else fTableStorage->Add(new TParameter<Int_t>(table, storage));
+}
+
+//______________________________________________________________________________
+void TCMySQLManager::ReadParStorageConfig()
+{
+    // Set the parameter storage mode for new data tables using the configuration
+    // key 'DB.ParStorage' ('columns' or 'blob'). The mode is not changed if the
+    // key is not found.
+
+    // get configuration
+    TString* storage = TCReadConfig::GetReader()->GetConfig("DB.ParStorage");
+    if (!storage) return;
+
+    // set storage mode
+    if (!storage->CompareTo("blob", TString::kIgnoreCase)) fParStorage = kParBlob;
+    else if (!storage->CompareTo("columns", TString::kIgnoreCase)) fParStorage = kParColumns;
+    else
     {
-        if (!fSilence) Error("SearchRunEntry", "Could not find the information '%s' for run %d!",
-                                               name, run);
-        delete res;
-        return kFALSE;
+        if (!fSilence) Warning("ReadParStorageConfig", "Unknown parameter storage mode '%s'!",
+                               storage->Data());
     }
+}
 
-    // write the information
-    const Char_t* field = row->GetField(0);
-    if (!field) outInfo = "";
-    outInfo = field;
+//______________________________________________________________________________
+void TCMySQLManager::PackParameters(const Double_t* par, Int_t n, Char_t* outBuffer)
+{
+    // Pack the 'n' parameters 'par' as little-endian doubles into the buffer
+    // 'outBuffer' of at least 'n'*8 bytes.
 
-    // clean-up
-    delete row;
-    delete res;
+    memcpy(outBuffer, par, n*sizeof(Double_t));
 
-    return kTRUE;
+#ifndef R__BYTESWAP
+    // swap bytes on big-endian hosts
+    for (Int_t i = 0; i < n; i++)
+    {
+        Char_t* b = outBuffer + i*sizeof(Double_t);
+        for (Int_t j = 0; j < 4; j++)
+        {
+            Char_t t = b[j];
+            b[j] = b[7-j];
+            b[7-j] = t;
+        }
+    }
+#endif
 }
 
 //______________________________________________________________________________
-Bool_t TCMySQLManager::SearchSetEntry(const Char_t* data, const Char_t* calibration, Int_t set,
-                                      const Char_t* name, Char_t* outInfo)
+void TCMySQLManager::UnpackParameters(const Char_t* buffer, Int_t n, Double_t* outPar)
 {
-    // Search the information 'name' for the calibration identifier 'calibration' and
-    // the calibration data 'data' for the set number 'set' and write it to 'outInfo'.
-    // Return kTRUE when the information was found, otherwise kFALSE.
-
-    TString query;
-    Char_t table[256];
+    // Unpack 'n' parameters stored as little-endian doubles in the buffer
+    // 'buffer' to 'outPar'.
 
-    // check for data
-    if (!GetCalibData(data)) return kFALSE;
+    memcpy(outPar, buffer, n*sizeof(Double_t));
 
-    // get the data table
-    if (!SearchTable(data, table))
+#ifndef R__BYTESWAP
+    // swap bytes on big-endian hosts
+    for (Int_t i = 0; i < n; i++)
     {
-        if (!fSilence) Error("SearchSetEntry", "No data table for '%s' in calibration '%s' found!",
-                                               data, calibration);
-        return kFALSE;
+        Char_t* b = (Char_t*) (outPar + i);
+        for (Int_t j = 0; j < 4; j++)
+        {
+            Char_t t = b[j];
+            b[j] = b[7-j];
+            b[7-j] = t;
+        }
     }
+#endif
+}
 
-    // create the query
-    query.Form("SELECT %s FROM %s WHERE "
-               "calibration = '%s' "
-               "ORDER BY first_run ASC LIMIT 1 OFFSET %d",
-               name, table, calibration, set);
+//______________________________________________________________________________
+Bool_t TCMySQLManager::BeginTransaction()
+{
+    // Begin a transaction. Nested transactions are mapped to savepoints.
+    // Return kTRUE on success, otherwise kFALSE.
 
-    // read from database
-    TSQLResult* res = SendQuery(query.Data());
+    // check server connection
+    if (!IsConnected())
+    {
+        if (!fSilence) Error("BeginTransaction", "No connection to the database!");
+        return kFALSE;
+    }
 
-    // check result
-    if (!res)
+    // check thread
+    if (!IsMainThread())
     {
-        if (!fSilence) Error("SearchSetEntry", "No runset %d found in table '%s' of '%s' in calibration '%s'!",
-                                               set, table, data, calibration);
+        if (!fSilence) Error("BeginTransaction", "Transactions are supported only in the main thread!");
         return kFALSE;
     }
 
-    // get data
-    TSQLRow* row = res->Next();
+    // start transaction or set savepoint
+    Bool_t res;
+    if (fTransDepth == 0) res = fDB->StartTransaction();
+    else res = fDB->Exec(TString::Format("SAVEPOINT calib_sp_%d", fTransDepth).Data());
 
-    // check row
-    if (!row)
+    // check result
+    if (!res)
     {
-        if (!fSilence) Error("SearchSetEntry", "No runset %d found in table '%s' of '%s' in calibration '%s'!",
-                                               set, table, data, calibration);
+        if (!fSilence) Error("BeginTransaction", "Could not begin transaction (level %d)!", fTransDepth);
         return kFALSE;
     }
 
-    // extract data
-    const Char_t* d = row->GetField(0);
-    if (!d) strcpy(outInfo, "");
-    else strcpy(outInfo, d);
-
-    // clean-up
-    delete row;
-    delete res;
+    fTransDepth++;
 
     return kTRUE;
 }
 
 //______________________________________________________________________________
-Bool_t TCMySQLManager::ChangeRunEntries(Int_t first_run, Int_t last_run,
-                                        const Char_t* name, const Char_t* value)
+Bool_t TCMySQLManager::CommitTransaction()
 {
-    // Change the run entry 'name' for the runs 'first_run' to 'last_run' to 'value'.
-
-    TString query;
+    // Commit the current transaction or release the current savepoint.
+    // The transaction is rolled back if the commit fails.
+    // Return kTRUE on success, otherwise kFALSE.
 
-    // check if first run is smaller than last run
-    if (first_run > last_run)
+    // check transaction
+    if (fTransDepth == 0)
     {
-        if (!fSilence) Error("ChangeRunEntries", "First run of has to be smaller than last run!");
+        if (!fSilence) Error("CommitTransaction", "No open transaction!");
         return kFALSE;
     }
 
-    // create the query
-    query.Form("UPDATE %s SET %s = '%s' "
-               "WHERE run >= %d AND"
-               "      run <= %d",
-               TCConfig::kCalibMainTableName, name, value, first_run, last_run);
+    // check server connection
+    if (!IsConnected())
+    {
+        if (!fSilence) Error("CommitTransaction", "No connection to the database!");
+        return kFALSE;
+    }
 
-    // read from database
-    Bool_t res = SendExec(query.Data());
+    // commit transaction or release savepoint
+    Bool_t res;
+    if (fTransDepth == 1) res = fDB->Commit();
+    else res = fDB->Exec(TString::Format("RELEASE SAVEPOINT calib_sp_%d", fTransDepth-1).Data());
 
-    // check result
+    // roll back on failure
     if (!res)
     {
-        if (!fSilence) Error("ChangeRunEntries", "Could not set the information '%s' for runs %d to %d to '%s'!",
-                                                 name, first_run, last_run, value);
+        if (!fSilence) Error("CommitTransaction", "Could not commit transaction (level %d)!", fTransDepth-1);
+        RollbackTransaction();
         return kFALSE;
     }
 
+    fTransDepth--;
+
     return kTRUE;
 }
 
 //______________________________________________________________________________
-Bool_t TCMySQLManager::ChangeSetEntry(const Char_t* data, const Char_t* calibration, Int_t set,
-                                      const Char_t* name, const Char_t* value)
+Bool_t TCMySQLManager::RollbackTransaction()
 {
-    // Change the information 'name' of the 'set'-th set of the calibration 'calibration'
-    // for the calibration data 'data' to 'value'.
-
-    TString query;
-    Char_t table[256];
-
-    // get data
-    TCCalibData* d = GetCalibData(data);
-    if (!d) return kFALSE;
+    // Roll back the current transaction or roll back to the current savepoint.
+    // Return kTRUE on success, otherwise kFALSE.
 
-    // get the data table
-    if (!SearchTable(data, table))
+    // check transaction
+    if (fTransDepth == 0)
     {
-        if (!fSilence) Error("ChangeSetEntry", "No data table found!");
-        return 0;
+        if (!fSilence) Error("RollbackTransaction", "No open transaction!");
+        return kFALSE;
     }
 
-    // get the first run of the set
-    Int_t first_run = GetFirstRunOfSet(data, calibration, set);
+    // check server connection
+    if (!IsConnected())
+    {
+        if (!fSilence) Error("RollbackTransaction", "No connection to the database!");
+        return kFALSE;
+    }
 
-    // create the query
-    query.Form("UPDATE %s SET %s = '%s' "
-               "WHERE calibration = '%s' AND "
-               "first_run = %d",
-               table, name, value, calibration, first_run);
+    // close transaction level
+    fTransDepth--;
 
-    // read from database
-    Bool_t res = SendExec(query.Data());
+    // roll back transaction or roll back to savepoint
+    Bool_t res;
+    if (fTransDepth == 0) res = fDB->Rollback();
+    else
+    {
+        res = fDB->Exec(TString::Format("ROLLBACK TO SAVEPOINT calib_sp_%d", fTransDepth).Data());
+        if (res) res = fDB->Exec(TString::Format("RELEASE SAVEPOINT calib_sp_%d", fTransDepth).Data());
+    }
 
     // check result
     if (!res)
     {
-        if (!fSilence) Error("ChangeSetEntry", "Could not set the information '%s' for set %d of '%s' to '%s'!",
-                             name, set, d->GetTitle(), value);
+        if (!fSilence) Error("RollbackTransaction", "Could not roll back transaction (level %d)!", fTransDepth);
         return kFALSE;
     }
 
@@ -713,333 +1020,1190 @@ Bool_t TCMySQLManager::ChangeSetEntry(const Char_t* data, const Char_t* calibrat
 }
 
 //______________________________________________________________________________
-Int_t TCMySQLManager::GetNsets(const Char_t* data, const Char_t* calibration)
+Int_t TCMySQLManager::BulkInsert(const Char_t* table, const Char_t* columns, TList* rows,
+                                 Bool_t* outAdded)
 {
-    // Get the number of runsets for the calibration identifier 'calibration'
-    // and the calibration data 'data'.
+    // Insert the rows in the list 'rows' (TObjStrings containing the value lists
+    // '(...)' of the columns 'columns') into the table 'table'.
+    // The rows are written in batches of multi-row inserts, each batch in its own
+    // transaction. If a batch fails it is rolled back and its rows are inserted
+    // one by one. If 'outAdded' is non-zero, the success of every row is written
+    // to this array.
+    // Return the number of inserted rows.
+
+    // get number of rows
+    Int_t nRow = rows->GetSize();
+    Int_t nRowAdded = 0;
+
+    // loop over batches
+    for (Int_t first = 0; first < nRow; first += fBatchSize)
+    {
+        Int_t last = TMath::Min(first + fBatchSize, nRow);
+
+        // prepare the multi-row insert query
+        TString ins_query = TString::Format("INSERT INTO %s (%s) VALUES ", table, columns);
+        for (Int_t i = first; i < last; i++)
+        {
+            if (i != first) ins_query.Append(", ");
+            ins_query.Append(((TObjString*) rows->At(i))->GetString());
+        }
 
-    TString query;
-    Char_t table[256];
-
-    // check for data
-    if (!GetCalibData(data)) return 0;
-
-    // get the data table
-    if (!SearchTable(data, table))
-    {
-        if (!fSilence) Error("GetNsets", "No data table found!");
-        return 0;
-    }
+        // try to write the batch to the database
+        Bool_t res = BeginTransaction();
+        if (res)
+        {
+            if (SendExec(ins_query.Data())) res = CommitTransaction();
+            else
+            {
+                RollbackTransaction();
+                res = kFALSE;
+            }
+        }
 
-    // create the query
-    query.Form("SELECT first_run FROM %s WHERE "
-               "calibration = '%s' "
-               "ORDER BY first_run ASC",
-               table, calibration);
+        // check result
+        if (res)
+        {
+            if (outAdded) for (Int_t i = first; i < last; i++) outAdded[i] = kTRUE;
+            nRowAdded += last - first;
+            continue;
+        }
 
-    // read from database
-    TSQLResult* res = SendQuery(query.Data());
+        // insert the rows of the failed batch one by one
+        Bool_t trans = BeginTransaction();
+        Int_t nBatchAdded = 0;
+        for (Int_t i = first; i < last; i++)
+        {
+            ins_query = TString::Format("INSERT INTO %s (%s) VALUES %s", table, columns,
+                                        ((TObjString*) rows->At(i))->GetString().Data());
+            Bool_t added = SendExec(ins_query.Data());
+            if (outAdded) outAdded[i] = added;
+            if (added) nBatchAdded++;
+        }
 
-    // check result
-    if (!res)
-    {
-        if (!fSilence) Error("GetNsets", "No runsets found in table '%s'!", table);
-        return 0;
-    }
+        // commit the rows
+        if (trans && !CommitTransaction())
+        {
+            if (outAdded) for (Int_t i = first; i < last; i++) outAdded[i] = kFALSE;
+            nBatchAdded = 0;
+        }
 
-    // count rows
-    Int_t rows = 0;
-    TSQLRow* r = res->Next();
-    while (r)
-    {
-        rows++;
-        delete r;
-        r = res->Next();
+        nRowAdded += nBatchAdded;
     }
-    delete res;
 
-    return rows;
+    return nRowAdded;
 }
 
 //______________________________________________________________________________
-Int_t TCMySQLManager::GetFirstRunOfSet(const Char_t* data, const Char_t* calibration, Int_t set)
+Bool_t TCMySQLManager::IsConnected()
 {
-    // Get the first run of the runsets 'set' for the calibration identifier
-    // 'calibration' and the calibration data 'data'.
+    // Check if the connection to the database of the calling thread is open.
+    // Try to reconnect if the connection was closed.
 
-    Char_t tmp[256];
-
-    // check for data
-    if (!GetCalibData(data)) return 0;
+    TSQLServer* db = GetConnection();
 
-    // get the data
-    if (SearchSetEntry(data, calibration, set, "first_run", tmp)) return atoi(tmp);
-    else
+    if (!db)
     {
-        if (!fSilence) Error("GetFirstRunOfSet", "Could not find first run of set!");
-        return 0;
+        if (!fSilence) Error("IsConnected", "Cannot access database!");
+        return kFALSE;
+    }
+    else if (!db->IsConnected() && !Reconnect())
+    {
+        if (!fSilence) Error("IsConnected", "Lost connection to the database!");
+        return kFALSE;
     }
+    else
+        return kTRUE;
 }
 
 //______________________________________________________________________________
-Int_t TCMySQLManager::GetLastRunOfSet(const Char_t* data, const Char_t* calibration, Int_t set)
+TSQLServer* TCMySQLManager::Connect(Bool_t readOnly)
 {
-    // Get the last run of the runsets 'set' for the calibration identifier
-    // 'calibration' and the calibration data 'data'.
+    // Open a new connection to the database. SQLite connections are opened
+    // in query-only mode if 'readOnly' is kTRUE.
+    // Return the connection or 0 if an error occurred.
 
-    Char_t tmp[256];
+    // check connection URL
+    if (fDBUrl == "") return 0;
 
-    // check for data
-    if (!GetCalibData(data)) return 0;
+    // open connection
+    TSQLServer* db = TSQLServer::Connect(fDBUrl.Data(), fDBUser.Data(), fDBPass.Data());
 
-    // get the data
-    if (SearchSetEntry(data, calibration, set, "last_run", tmp)) return atoi(tmp);
-    else
+    // check connection
+    if (!db) return 0;
+    else if (db->IsZombie())
     {
-        if (!fSilence) Error("GetLastRunOfSet", "Could not find last run of set!");
+        delete db;
         return 0;
     }
-}
-
-//______________________________________________________________________________
-void TCMySQLManager::GetDescriptionOfSet(const Char_t* data, const Char_t* calibration,
-                                         Int_t set, Char_t* outDesc)
-{
-    // Get the description of the runsets 'set' for the calibration identifier
-    // 'calibration' and the calibration data 'data'.
-
-    Char_t tmp[256];
-
-    // check for data
-    if (!GetCalibData(data)) return;
 
-    // get the data
-    if (SearchSetEntry(data, calibration, set, "description", tmp)) strcpy(outDesc, tmp);
-    else
+    // configure SQLite connections (wait for the locks of other connections)
+    if (fDBType == kSQLite)
     {
-        if (!fSilence) Error("GetDescriptionOfSet", "Could not find description of set!");
+        if (readOnly) db->Exec("PRAGMA query_only = ON");
+        db->Exec("PRAGMA busy_timeout = 10000");
     }
+
+    return db;
 }
 
 //______________________________________________________________________________
-void TCMySQLManager::GetChangeTimeOfSet(const Char_t* data, const Char_t* calibration,
-                                        Int_t set, Char_t* outTime)
+Bool_t TCMySQLManager::IsMainThread() const
 {
-    // Get the change time of the runsets 'set' for the calibration identifier
-    // 'calibration' and the calibration data 'data'.
-
-    Char_t tmp[256];
-
-    // check for data
-    if (!GetCalibData(data)) return;
+    // Check if the calling thread is the thread owning the main connection.
 
-    // get the data
-    if (SearchSetEntry(data, calibration, set, "changed", tmp)) strcpy(outTime, tmp);
-    else
-    {
-        if (!fSilence) Error("GetChangeTimeOfSet", "Could not find change time of set!");
-    }
+    return TThread::SelfId() == fMainThread;
 }
 
 //______________________________________________________________________________
-Int_t* TCMySQLManager::GetRunsOfCalibration(const Char_t* calibration, Int_t* outNruns)
+TSQLServer* TCMySQLManager::GetConnection()
 {
-    // Returns a list of all runs of the calibration identifier 'calibration'.
-    // If 'outNruns' is not zero the number of runs will be written to this variable.
-    // NOTE: the run array must be destroyed by the caller.
-
-    // default data
-    const Char_t* default_data = "Data.Tagger.T0";
+    // Return the database connection of the calling thread. Other threads than
+    // the main thread get an own connection from the pool of idle connections
+    // or a new one. For SQLite these connections are read-only.
+    // Return 0 if no connection could be opened.
 
-    // init result variables
-    Int_t nruns = 0;
-    Int_t* runs = 0;
+    // main connection
+    if (IsMainThread()) return fDB;
 
-    // get no. of sets
-    Int_t nsets = GetNsets(default_data, calibration);
+    // lock the pool
+    TLockGuard lock(fMutex);
 
-    // init helpers for sets
-    Int_t* nruns_set = new Int_t[nsets];
-    Int_t** runs_set = new Int_t*[nsets];
+    // search the connection of this thread
+    Long_t thread = TThread::SelfId();
+    TIter next(fConnBusy);
+    TCDBConnection* c;
+    while ((c = (TCDBConnection*)next()))
+        if (c->GetThread() == thread) return c->GetServer();
 
-    // loop over sets
-    for (Int_t i = 0; i < nsets; i++)
+    // take an idle connection
+    while ((c = (TCDBConnection*)fConnIdle->First()))
     {
-        // get list of runs for set
-        runs_set[i] = GetRunsOfSet(default_data, calibration, i, &nruns_set[i]);
-
-        // update total number of runs
-        nruns += nruns_set[i];
-    }
-
-    // create array of run numbers
-    runs = new Int_t[nruns];
+        fConnIdle->Remove(c);
 
-    // loop over sets
-    Int_t index = 0;
-    for (Int_t i = 0; i < nsets; i++)
-    {
-        // loop over runs of this set and fill runs
-        for (Int_t j = 0; j < nruns_set[i]; j++)
-            runs[index + j] = runs_set[i][j];
+        // check connection
+        if (CheckConnection(c->GetServer()))
+        {
+            c->SetThread(thread);
+            fConnBusy->Add(c);
+            return c->GetServer();
+        }
 
-        // set new index
-        index += nruns_set[i];
+        // discard broken connection
+        delete c->GetServer();
+        delete c;
     }
 
-    // clean up
-    if (nruns_set) delete [] nruns_set;
-    if (runs_set)
+    // open a new connection
+    TSQLServer* db = Connect(kTRUE);
+    if (!db)
     {
-        for (Int_t i = 0; i < nsets; i++)
-            if (runs_set[i]) delete [] runs_set[i];
-        delete [] runs_set;
+        if (!fSilence) Error("GetConnection", "Could not open a database connection for thread %ld!", thread);
+        return 0;
     }
+    fConnBusy->Add(new TCDBConnection(db, thread));
 
-    // return number of runs
-    if (outNruns) *outNruns = nruns;
-
-    return runs;
+    return db;
 }
 
 //______________________________________________________________________________
-Int_t* TCMySQLManager::GetRunsOfSet(const Char_t* data, const Char_t* calibration,
-                                    Int_t set, Int_t* outNruns = 0)
+void TCMySQLManager::ReleaseConnection()
 {
-    // Return the list of runs that are in the set 'set' of the calibration data 'data'
-    // for the calibration identifier 'calibration'.
-    // If 'outNruns' is not zero the number of runs will be written to this variable.
-    // NOTE: the run array must be destroyed by the caller.
+    // Return the database connection of the calling thread to the pool.
+    // Should be called by threads other than the main thread when they
+    // do not need database access anymore.
 
-    TString query;
-    // check for data
-    if (!GetCalibData(data)) return 0;
+    // main connection is never released
+    if (IsMainThread()) return;
 
-    // get first and last run
-    Int_t first_run = GetFirstRunOfSet(data, calibration, set);
-    Int_t last_run = GetLastRunOfSet(data, calibration, set);
+    // lock the pool
+    TLockGuard lock(fMutex);
 
-    // check first run
-    if (!first_run)
+    // search the connection of this thread
+    Long_t thread = TThread::SelfId();
+    TIter next(fConnBusy);
+    TCDBConnection* c;
+    while ((c = (TCDBConnection*)next()))
     {
-        if (!fSilence) Error("GetRunsOfSet", "Could not find runs of set %d!", set);
-        return 0;
-    }
+        if (c->GetThread() == thread)
+        {
+            fConnBusy->Remove(c);
 
-    //
-    // get all the runs that lie between first and last run
-    //
+            // keep or close the connection
+            if (fConnIdle->GetSize() < fPoolSize)
+            {
+                c->SetThread(0);
+                fConnIdle->Add(c);
+            }
+            else
+            {
+                delete c->GetServer();
+                delete c;
+            }
+            return;
+        }
+    }
+}
 
-    // create the query
-    query.Form("SELECT run FROM %s "
-               "WHERE run >= %d "
-               "AND run <= %d "
-               "ORDER by run,time",
-               TCConfig::kCalibMainTableName, first_run, last_run);
+//______________________________________________________________________________
+Bool_t TCMySQLManager::SetMainThread()
+{
+    // Make the calling thread the owner of the main connection, e.g. the thread
+    // driving the GUI if the manager was created by another thread. The former
+    // main thread gets a pooled connection on its next database access.
+    // Return kFALSE if a transaction is open on the main connection.
 
-    // read from database
-    TSQLResult* res = SendQuery(query.Data());
+    // lock the pool
+    TLockGuard lock(fMutex);
 
-    // create list for run numbers
-    TList run_numbers;
-    run_numbers.SetOwner(kTRUE);
+    // check thread
+    if (IsMainThread()) return kTRUE;
 
-    // read all rows/runs
-    TSQLRow* r = res->Next();
-    while (r)
+    // the main connection cannot change during a transaction
+    if (fTransDepth)
     {
-        run_numbers.Add(new TObjString(r->GetField(0)));
-        delete r;
-        r = res->Next();
+        if (!fSilence) Error("SetMainThread", "Cannot change the main thread during a transaction!");
+        return kFALSE;
     }
 
-    // get number of runs
-    Int_t nruns = run_numbers.GetSize();
-
-    // create run array
-    Int_t* runs = new Int_t[nruns];
-
-    // read all runs
-    for (Int_t i = 0; i < nruns; i++)
-    {
-        // get next run
-        TObjString* rn = (TObjString*) run_numbers.At(i);
+    // return the pooled connection of the calling thread
+    ReleaseConnection();
 
-        // save run number
-        runs[i] = atoi(rn->GetString().Data());
-    }
+    // set the thread
+    fMainThread = TThread::SelfId();
 
-    // clean-up
-    delete res;
+    return kTRUE;
+}
 
-    // write number of runs
-    if (outNruns) *outNruns = nruns;
+//______________________________________________________________________________
+Bool_t TCMySQLManager::CheckConnection(TSQLServer* server) const
+{
+    // Check if the connection 'server' is alive.
 
-    return runs;
+    if (!server || !server->IsConnected()) return kFALSE;
+    if (fDBType == kMySQL) return server->PingVerify();
+    return kTRUE;
 }
 
 //______________________________________________________________________________
-Int_t TCMySQLManager::GetSetForRun(const Char_t* data, const Char_t* calibration, Int_t run)
+Bool_t TCMySQLManager::IsConnectionLost(TSQLServer* server) const
 {
-    // Return the number of the set of the calibration data 'data' for the calibration
-    // identifier 'calibration' the run 'run' belongs to.
-    // Return -1 if there is no such set.
+    // Check if the last error of the connection 'server' was caused by
+    // a lost connection to the MySQL server.
 
-    // check for data
-    if (!GetCalibData(data)) return -1;
+    if (!server || fDBType != kMySQL) return kFALSE;
 
-    // get number of sets
-    Int_t nSet = GetNsets(data, calibration);
-    if (!nSet) return -1;
+    // server has gone away (2006) or lost connection during query (2013)
+    Int_t code = server->GetErrorCode();
+    return code == 2006 || code == 2013;
+}
 
-    // check if run exists
-    TString tmp;
-    if (!SearchRunEntry(run, "run", tmp))
+//______________________________________________________________________________
+Bool_t TCMySQLManager::Reconnect()
+{
+    // Reconnect the database connection of the calling thread. The connection
+    // attempt is repeated up to 'fRetries' times, doubling the initial delay of
+    // 'fRetryDelay' ms after each failed attempt.
+    // Return kTRUE on success, otherwise kFALSE.
+
+    // check open transaction
+    if (IsMainThread() && fTransDepth)
     {
-        if (!fSilence) Error("GetSetForRun", "Run has no valid run number!");
-        return -1;
+        if (!fSilence) Error("Reconnect", "Cannot reconnect within a transaction!");
+        return kFALSE;
     }
 
-    // loop over sets
-    for (Int_t i = 0; i < nSet; i++)
+    // try to connect
+    TSQLServer* db = 0;
+    Int_t delay = fRetryDelay;
+    for (Int_t i = 0; i <= fRetries; i++)
     {
-        // get first and last run
-        Int_t first_run = GetFirstRunOfSet(data, calibration, i);
-        Int_t last_run = GetLastRunOfSet(data, calibration, i);
+        // wait before retrying
+        if (i)
+        {
+            if (!fSilence) Warning("Reconnect", "Reconnection attempt %d failed - retrying in %d ms", i, delay);
+            gSystem->Sleep(delay);
+            delay *= 2;
+        }
 
-        // check if run is in this set
-        if (run >= first_run && run <= last_run) return i;
+        // connect
+        if ((db = Connect(!IsMainThread()))) break;
     }
 
-    // no set found here
-    return -1;
-}
-
-//______________________________________________________________________________
-Bool_t TCMySQLManager::ReadParametersRun(const Char_t* data, const Char_t* calibration, Int_t run,
-                                         Double_t* par, Int_t length)
-{
-    // Read 'length' parameters of the calibration data 'data' for the calibration identifier
-    // 'calibration' valid for the run 'run' from the database to the value array 'par'.
-    // Return kFALSE if an error occurred, otherwise kTRUE.
+    // check connection
+    if (!db)
+    {
+        if (!fSilence) Error("Reconnect", "Could not reconnect to the database!");
+        return kFALSE;
+    }
 
-    // get data
+    // replace the connection
+    if (IsMainThread())
+    {
+        if (fDB)
+        {
+            delete fDB;
+        }
+        fDB = db;
+    }
+    else
+    {
+        // lock the pool
+        TLockGuard lock(fMutex);
+
+        // remove the old connection of this thread
+        Long_t thread = TThread::SelfId();
+        TIter next(fConnBusy);
+        TCDBConnection* c;
+        while ((c = (TCDBConnection*)next()))
+        {
+            if (c->GetThread() == thread)
+            {
+                fConnBusy->Remove(c);
+                delete c->GetServer();
+                delete c;
+                break;
+            }
+        }
+
+        // add the new connection
+        fConnBusy->Add(new TCDBConnection(db, thread));
+    }
+
+    // user information
+    if (!fSilence) Info("Reconnect", "Reconnected to the database");
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::SearchTable(const Char_t* data, Char_t* outTableName)
+{
+    // Search the table name of the calibration quantity 'data' and write it
+    // to 'outTableName'.
+    // Return kTRUE when a true table was found, otherwise kFALSE.
+
+    // get CaLib data
+    TCCalibData* d = GetCalibData(data);
+
+    // check data
+    if (d)
+    {
+        // copy table name
+        strcpy(outTableName, d->GetTableName());
+        return kTRUE;
+    }
+    else return kFALSE;
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::SearchRunEntry(Int_t run, const Char_t* name, TString& outInfo)
+{
+    // Search the information 'name' for the run 'run' and write it to 'outInfo'.
+    // Return kTRUE when the information was found, otherwise kFALSE.
+
+    // prepare the statement
+    TSQLStatement* stmt = PrepareBindStatement(TString::Format("SELECT %s FROM %s "
+                                                       "WHERE run = ?",
+                                                       name, TCConfig::kCalibMainTableName).Data());
+    if (!stmt) return kFALSE;
+
+    // bind the run and read from database
+    Bool_t res = kFALSE;
+    if (stmt->SetInt(0, run) &&
+        stmt->Process() && stmt->StoreResult() && stmt->NextResultRow())
+    {
+        // write the information
+        if (stmt->IsNull(0)) outInfo = "";
+        else outInfo = stmt->GetString(0);
+        res = kTRUE;
+    }
+    delete stmt;
+
+    // check result
+    if (!res)
+    {
+        if (!fSilence) Error("SearchRunEntry", "Could not find the information '%s' for run %d!",
+                                               name, run);
+        return kFALSE;
+    }
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::SearchSetEntry(const Char_t* data, const Char_t* calibration, Int_t set,
+                                      const Char_t* name, Char_t* outInfo)
+{
+    // Search the information 'name' for the calibration identifier 'calibration' and
+    // the calibration data 'data' for the set number 'set' and write it to 'outInfo'.
+    // Return kTRUE when the information was found, otherwise kFALSE.
+
+    TString query;
+    Char_t table[256];
+
+    // check for data
+    if (!GetCalibData(data)) return kFALSE;
+
+    // get the data table
+    if (!SearchTable(data, table))
+    {
+        if (!fSilence) Error("SearchSetEntry", "No data table for '%s' in calibration '%s' found!",
+                                               data, calibration);
+        return kFALSE;
+    }
+
+    // get the first run of the set from the set index
+    Int_t first_run = GetFirstRunOfSet(data, calibration, set);
+    if (!first_run)
+    {
+        if (!fSilence) Error("SearchSetEntry", "No runset %d found in table '%s' of '%s' in calibration '%s'!",
+                                               set, table, data, calibration);
+        return kFALSE;
+    }
+
+    // create the query
+    query.Form("SELECT %s FROM %s WHERE "
+               "calibration = '%s' AND "
+               "first_run = %d",
+               name, table, calibration, first_run);
+
+    // read from database
+    TSQLResult* res = SendQuery(query.Data());
+
+    // check result
+    if (!res)
+    {
+        if (!fSilence) Error("SearchSetEntry", "No runset %d found in table '%s' of '%s' in calibration '%s'!",
+                                               set, table, data, calibration);
+        return kFALSE;
+    }
+
+    // get data
+    TSQLRow* row = res->Next();
+
+    // check row
+    if (!row)
+    {
+        if (!fSilence) Error("SearchSetEntry", "No runset %d found in table '%s' of '%s' in calibration '%s'!",
+                                               set, table, data, calibration);
+        return kFALSE;
+    }
+
+    // extract data
+    const Char_t* d = row->GetField(0);
+    if (!d) strcpy(outInfo, "");
+    else strcpy(outInfo, d);
+
+    // clean-up
+    delete row;
+    delete res;
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::ChangeRunEntries(Int_t first_run, Int_t last_run,
+                                        const Char_t* name, const Char_t* value)
+{
+    // Change the run entry 'name' for the runs 'first_run' to 'last_run' to 'value'.
+
+    // check if first run is smaller than last run
+    if (first_run > last_run)
+    {
+        if (!fSilence) Error("ChangeRunEntries", "First run of has to be smaller than last run!");
+        return kFALSE;
+    }
+
+    // prepare the statement
+    TSQLStatement* stmt = PrepareStatement(TString::Format("UPDATE %s SET %s = ? "
+                                                           "WHERE run >= ? AND"
+                                                           "      run <= ?",
+                                                           TCConfig::kCalibMainTableName, name).Data());
+
+    // bind the values and write to database
+    Bool_t res = kFALSE;
+    if (stmt)
+    {
+        res = stmt->NextIteration() &&
+              stmt->SetString(0, value, TMath::Max(256, Int_t(strlen(value)) + 1)) &&
+              stmt->SetInt(1, first_run) &&
+              stmt->SetInt(2, last_run) &&
+              stmt->Process();
+        delete stmt;
+    }
+
+    // check result
+    if (!res)
+    {
+        if (!fSilence) Error("ChangeRunEntries", "Could not set the information '%s' for runs %d to %d to '%s'!",
+                                                 name, first_run, last_run, value);
+        return kFALSE;
+    }
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::ChangeSetEntry(const Char_t* data, const Char_t* calibration, Int_t set,
+                                      const Char_t* name, const Char_t* value)
+{
+    // Change the information 'name' of the 'set'-th set of the calibration 'calibration'
+    // for the calibration data 'data' to 'value'.
+
+    Char_t table[256];
+
+    // get data
+    TCCalibData* d = GetCalibData(data);
+    if (!d) return kFALSE;
+
+    // get the data table
+    if (!SearchTable(data, table))
+    {
+        if (!fSilence) Error("ChangeSetEntry", "No data table found!");
+        return 0;
+    }
+
+    // get the first run of the set
+    Int_t first_run = GetFirstRunOfSet(data, calibration, set);
+
+    // prepare the statement
+    TSQLStatement* stmt = PrepareStatement(TString::Format("UPDATE %s SET %s = ? "
+                                                           "WHERE calibration = ? AND "
+                                                           "first_run = ?",
+                                                           table, name).Data());
+
+    // bind the values and write to database
+    Bool_t res = kFALSE;
+    if (stmt)
+    {
+        res = stmt->NextIteration() &&
+              stmt->SetString(0, value, TMath::Max(256, Int_t(strlen(value)) + 1)) &&
+              stmt->SetString(1, calibration) &&
+              stmt->SetInt(2, first_run) &&
+              stmt->Process();
+        delete stmt;
+    }
+
+    // invalidate the set index and the set
+    ClearSetIndex(data, calibration, 1, &first_run);
+
+    // check result
+    if (!res)
+    {
+        if (!fSilence) Error("ChangeSetEntry", "Could not set the information '%s' for set %d of '%s' to '%s'!",
+                             name, set, d->GetTitle(), value);
+        return kFALSE;
+    }
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::LoadSetIndex(const Char_t* data, const Char_t* calibration)
+{
+    // Read the run interval index of the sets of the calibration data 'data'
+    // for the calibration identifier 'calibration' from the database with a
+    // single query and cache it if it is not cached yet. The cache is locked
+    // only to search and add the index, not while reading from the database.
+    // Return kFALSE if an error occurred, otherwise kTRUE.
+
+    TString query;
+    Char_t table[256];
+
+    // check for cached index
+    TString key = TCSetIndex::BuildKey(data, calibration);
+    UInt_t gen;
+    {
+        TLockGuard lock(fMutex);
+        if (fSetIndex->FindObject(key.Data())) return kTRUE;
+        gen = fSetIndexGen;
+    }
+
+    // check for data
+    if (!GetCalibData(data)) return kFALSE;
+
+    // get the data table
+    if (!SearchTable(data, table))
+    {
+        if (!fSilence) Error("LoadSetIndex", "No data table found!");
+        return kFALSE;
+    }
+
+    // create the query
+    query.Form("SELECT first_run, last_run, changed FROM %s WHERE "
+               "calibration = '%s' "
+               "ORDER BY first_run ASC",
+               table, calibration);
+
+    // read from database
+    TSQLResult* res = SendQuery(query.Data());
+
+    // check result
+    if (!res)
+    {
+        if (!fSilence) Error("LoadSetIndex", "No runsets found in table '%s'!", table);
+        return kFALSE;
+    }
+
+    // create the index from all rows
+    TCSetIndex* index = new TCSetIndex(data, calibration);
+    TSQLRow* r = res->Next();
+    while (r)
+    {
+        UInt_t changed = r->GetField(2) ? TDatime(r->GetField(2)).Convert() : 0;
+        index->AddSet(atoi(r->GetField(0)), atoi(r->GetField(1)), changed);
+        delete r;
+        r = res->Next();
+    }
+    delete res;
+
+    // cache the index unless another thread cached it or indices were
+    // removed in the meantime (the index might be outdated then)
+    TLockGuard lock(fMutex);
+    if (gen != fSetIndexGen || fSetIndex->FindObject(key.Data())) delete index;
+    else fSetIndex->Add(index);
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+TCSetIndex* TCMySQLManager::GetSetIndex(const Char_t* data, const Char_t* calibration)
+{
+    // Return the cached run interval index of the sets of the calibration data
+    // 'data' for the calibration identifier 'calibration'. The caller has to
+    // lock fMutex while using the index and should call LoadSetIndex() before
+    // to avoid reading the index from the database while holding the lock.
+    // Return 0 if an error occurred.
+
+    // lock the cache
+    TLockGuard lock(fMutex);
+
+    // check for cached index
+    TString key = TCSetIndex::BuildKey(data, calibration);
+    TCSetIndex* index = (TCSetIndex*) fSetIndex->FindObject(key.Data());
+    if (index) return index;
+
+    // read the index (e.g. if it was removed after LoadSetIndex())
+    if (!LoadSetIndex(data, calibration)) return 0;
+
+    return (TCSetIndex*) fSetIndex->FindObject(key.Data());
+}
+
+//______________________________________________________________________________
+void TCMySQLManager::ClearSetIndex(const Char_t* data, const Char_t* calibration,
+                                   Int_t nSet, const Int_t* firstRun)
+{
+    // Remove the cached run interval indices of the calibration data 'data' and
+    // the calibration identifier 'calibration' after the sets were modified.
+    // If 'data' or 'calibration' is zero the indices of all calibration data or
+    // of all calibrations are removed, respectively.
+    // The 'nSet' modified sets starting at the runs 'firstRun' (all sets if 'nSet'
+    // is 0) of 'data' and 'calibration' are invalidated in the parameter cache file.
+
+    // lock the cache
+    TLockGuard lock(fMutex);
+
+    // invalidate the cached parameters
+    if (fParCache && data && calibration) fParCache->Invalidate(data, calibration, nSet, firstRun);
+
+    // indices read concurrently might be outdated
+    fSetIndexGen++;
+
+    // remove all indices
+    if (!data && !calibration)
+    {
+        fSetIndex->Delete();
+        return;
+    }
+
+    // collect matching indices
+    TList remove;
+    TIter next(fSetIndex);
+    TCSetIndex* index;
+    while ((index = (TCSetIndex*)next()))
+    {
+        // check data and calibration
+        if (data && strcmp(index->GetCalibData(), data)) continue;
+        if (calibration && strcmp(index->GetCalibration(), calibration)) continue;
+
+        // mark index for removal
+        remove.Add(index);
+    }
+
+    // remove indices
+    TIter nextRem(&remove);
+    while ((index = (TCSetIndex*)nextRem()))
+    {
+        fSetIndex->Remove(index);
+        delete index;
+    }
+}
+
+//______________________________________________________________________________
+Int_t TCMySQLManager::GetNsets(const Char_t* data, const Char_t* calibration)
+{
+    // Get the number of runsets for the calibration identifier 'calibration'
+    // and the calibration data 'data'.
+
+    // get the set index
+    LoadSetIndex(data, calibration);
+    TLockGuard lock(fMutex);
+    TCSetIndex* index = GetSetIndex(data, calibration);
+
+    return index ? index->GetNsets() : 0;
+}
+
+//______________________________________________________________________________
+Int_t TCMySQLManager::GetFirstRunOfSet(const Char_t* data, const Char_t* calibration, Int_t set)
+{
+    // Get the first run of the runsets 'set' for the calibration identifier
+    // 'calibration' and the calibration data 'data'.
+
+    // get the set index
+    LoadSetIndex(data, calibration);
+    TLockGuard lock(fMutex);
+    TCSetIndex* index = GetSetIndex(data, calibration);
+    if (!index) return 0;
+
+    // get the data
+    if (index->HasSet(set)) return index->GetFirstRun(set);
+    else
+    {
+        if (!fSilence) Error("GetFirstRunOfSet", "Could not find first run of set!");
+        return 0;
+    }
+}
+
+//______________________________________________________________________________
+Int_t TCMySQLManager::GetLastRunOfSet(const Char_t* data, const Char_t* calibration, Int_t set)
+{
+    // Get the last run of the runsets 'set' for the calibration identifier
+    // 'calibration' and the calibration data 'data'.
+
+    // get the set index
+    LoadSetIndex(data, calibration);
+    TLockGuard lock(fMutex);
+    TCSetIndex* index = GetSetIndex(data, calibration);
+    if (!index) return 0;
+
+    // get the data
+    if (index->HasSet(set)) return index->GetLastRun(set);
+    else
+    {
+        if (!fSilence) Error("GetLastRunOfSet", "Could not find last run of set!");
+        return 0;
+    }
+}
+
+//______________________________________________________________________________
+void TCMySQLManager::GetDescriptionOfSet(const Char_t* data, const Char_t* calibration,
+                                         Int_t set, Char_t* outDesc)
+{
+    // Get the description of the runsets 'set' for the calibration identifier
+    // 'calibration' and the calibration data 'data'.
+
+    Char_t tmp[256];
+
+    // check for data
+    if (!GetCalibData(data)) return;
+
+    // get the data
+    if (SearchSetEntry(data, calibration, set, "description", tmp)) strcpy(outDesc, tmp);
+    else
+    {
+        if (!fSilence) Error("GetDescriptionOfSet", "Could not find description of set!");
+    }
+}
+
+//______________________________________________________________________________
+void TCMySQLManager::GetChangeTimeOfSet(const Char_t* data, const Char_t* calibration,
+                                        Int_t set, Char_t* outTime)
+{
+    // Get the change time of the runsets 'set' for the calibration identifier
+    // 'calibration' and the calibration data 'data'.
+
+    Char_t tmp[256];
+
+    // check for data
+    if (!GetCalibData(data)) return;
+
+    // get the data
+    if (SearchSetEntry(data, calibration, set, "changed", tmp)) strcpy(outTime, tmp);
+    else
+    {
+        if (!fSilence) Error("GetChangeTimeOfSet", "Could not find change time of set!");
+    }
+}
+
+//______________________________________________________________________________
+Int_t* TCMySQLManager::GetRunsOfCalibration(const Char_t* calibration, Int_t* outNruns)
+{
+    // Returns a list of all runs of the calibration identifier 'calibration'.
+    // If 'outNruns' is not zero the number of runs will be written to this variable.
+    // NOTE: the run array must be destroyed by the caller.
+
+    // default data
+    const Char_t* default_data = "Data.Tagger.T0";
+
+    // init result variables
+    Int_t nruns = 0;
+    Int_t* runs = 0;
+
+    // get no. of sets
+    Int_t nsets = GetNsets(default_data, calibration);
+
+    // init helpers for sets
+    Int_t* nruns_set = new Int_t[nsets];
+    Int_t** runs_set = new Int_t*[nsets];
+
+    // loop over sets
+    for (Int_t i = 0; i < nsets; i++)
+    {
+        // get list of runs for set
+        runs_set[i] = GetRunsOfSet(default_data, calibration, i, &nruns_set[i]);
+
+        // update total number of runs
+        nruns += nruns_set[i];
+    }
+
+    // create array of run numbers
+    runs = new Int_t[nruns];
+
+    // loop over sets
+    Int_t index = 0;
+    for (Int_t i = 0; i < nsets; i++)
+    {
+        // loop over runs of this set and fill runs
+        for (Int_t j = 0; j < nruns_set[i]; j++)
+            runs[index + j] = runs_set[i][j];
+
+        // set new index
+        index += nruns_set[i];
+    }
+
+    // clean up
+    if (nruns_set) delete [] nruns_set;
+    if (runs_set)
+    {
+        for (Int_t i = 0; i < nsets; i++)
+            if (runs_set[i]) delete [] runs_set[i];
+        delete [] runs_set;
+    }
+
+    // return number of runs
+    if (outNruns) *outNruns = nruns;
+
+    return runs;
+}
+
+//______________________________________________________________________________
+Int_t* TCMySQLManager::GetRunsOfSet(const Char_t* data, const Char_t* calibration,
+                                    Int_t set, Int_t* outNruns = 0)
+{
+    // Return the list of runs that are in the set 'set' of the calibration data 'data'
+    // for the calibration identifier 'calibration'.
+    // If 'outNruns' is not zero the number of runs will be written to this variable.
+    // NOTE: the run array must be destroyed by the caller.
+
+    TString query;
+    // check for data
+    if (!GetCalibData(data)) return 0;
+
+    // get first and last run
+    Int_t first_run = GetFirstRunOfSet(data, calibration, set);
+    Int_t last_run = GetLastRunOfSet(data, calibration, set);
+
+    // check first run
+    if (!first_run)
+    {
+        if (!fSilence) Error("GetRunsOfSet", "Could not find runs of set %d!", set);
+        return 0;
+    }
+
+    //
+    // get all the runs that lie between first and last run
+    //
+
+    // create the query
+    query.Form("SELECT run FROM %s "
+               "WHERE run >= %d "
+               "AND run <= %d "
+               "ORDER by run,time",
+               TCConfig::kCalibMainTableName, first_run, last_run);
+
+    // read from database
+    TSQLResult* res = SendQuery(query.Data());
+
+    // create list for run numbers
+    TList run_numbers;
+    run_numbers.SetOwner(kTRUE);
+
+    // read all rows/runs
+    TSQLRow* r = res->Next();
+    while (r)
+    {
+        run_numbers.Add(new TObjString(r->GetField(0)));
+        delete r;
+        r = res->Next();
+    }
+
+    // get number of runs
+    Int_t nruns = run_numbers.GetSize();
+
+    // create run array
+    Int_t* runs = new Int_t[nruns];
+
+    // read all runs
+    for (Int_t i = 0; i < nruns; i++)
+    {
+        // get next run
+        TObjString* rn = (TObjString*) run_numbers.At(i);
+
+        // save run number
+        runs[i] = atoi(rn->GetString().Data());
+    }
+
+    // clean-up
+    delete res;
+
+    // write number of runs
+    if (outNruns) *outNruns = nruns;
+
+    return runs;
+}
+
+//______________________________________________________________________________
+Int_t TCMySQLManager::GetSetForRun(const Char_t* data, const Char_t* calibration, Int_t run)
+{
+    // Return the number of the set of the calibration data 'data' for the calibration
+    // identifier 'calibration' the run 'run' belongs to.
+    // Return -1 if there is no such set.
+
+    // check if run exists
+    TString tmp;
+    if (!SearchRunEntry(run, "run", tmp))
+    {
+        if (!fSilence) Error("GetSetForRun", "Run has no valid run number!");
+        return -1;
+    }
+
+    // search the set containing the run in the set index
+    LoadSetIndex(data, calibration);
+    TLockGuard lock(fMutex);
+    TCSetIndex* index = GetSetIndex(data, calibration);
+
+    return index ? index->FindSet(run) : -1;
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::ReadParametersRun(const Char_t* data, const Char_t* calibration, Int_t run,
+                                         Double_t* par, Int_t length)
+{
+    // Read 'length' parameters of the calibration data 'data' for the calibration identifier
+    // 'calibration' valid for the run 'run' from the database to the value array 'par'.
+    // Return kFALSE if an error occurred, otherwise kTRUE.
+
+    // get data
     TCCalibData* d = GetCalibData(data);
     if (!d) return kFALSE;
 
-    // get set
-    Int_t set = GetSetForRun(data, calibration, run);
+    // get set
+    Int_t set = GetSetForRun(data, calibration, run);
+
+    // check set
+    if (set == -1)
+    {
+        if (!fSilence) Error("ReadParametersRun", "No set of '%s' found for run %d",
+                             d->GetTitle(), run);
+        return kFALSE;
+    }
+
+    // call main parameter reading method
+    return ReadParameters(data, calibration, set, par, length);
+}
+
+//______________________________________________________________________________
+THashList* TCMySQLManager::ReadParametersRunMulti(const Char_t* calibration, Int_t run,
+                                                  TCollection* dataList)
+{
+    // Read the parameters of all calibration data named in the collection
+    // 'dataList' (e.g. TObjStrings or TCCalibData) for the calibration identifier
+    // 'calibration' valid for the run 'run' from the database.
+    // The sets are resolved using the cached set indices. Sets that are up to
+    // date in the parameter cache file are taken from there, the parameters of
+    // all other data tables are fetched using a single query and cached.
+    // Return a list of calibrations that can be accessed via the names of the
+    // calibration data, or 0 if an error occurred.
+    // NOTE: The list must be destroyed by the caller.
+
+    TString tmp;
+
+    // check if run exists
+    if (!SearchRunEntry(run, "run", tmp))
+    {
+        if (!fSilence) Error("ReadParametersRunMulti", "Run %d has no valid run number!", run);
+        return 0;
+    }
+
+    // get maximum number of parameters and of parameter columns
+    Int_t nParMax = 0;
+    Int_t nColMax = 0;
+    TIter next(dataList);
+    TObject* o;
+    while ((o = next()))
+    {
+        TCCalibData* d = GetCalibData(o->GetName());
+        if (!d) continue;
+        if (d->GetSize() > nParMax) nParMax = d->GetSize();
+        if (GetTableStorage(d->GetTableName()) == kParColumns && d->GetSize() > nColMax)
+            nColMax = d->GetSize();
+    }
+
+    // create the list
+    THashList* list = new THashList();
+    list->SetOwner(kTRUE);
+
+    // build one sub-query per calibration data
+    TString query;
+    TList read;
+    next.Reset();
+    while ((o = next()))
+    {
+        // get data
+        TCCalibData* d = GetCalibData(o->GetName());
+        if (!d) continue;
+
+        // skip duplicates
+        if (read.FindObject(d) || list->FindObject(d->GetName())) continue;
+
+        // get the set containing the run
+        LoadSetIndex(d->GetName(), calibration);
+        TLockGuard lock(fMutex);
+        TCSetIndex* index = GetSetIndex(d->GetName(), calibration);
+        Int_t set = index ? index->FindSet(run) : -1;
+
+        // check set
+        if (set == -1)
+        {
+            if (!fSilence) Error("ReadParametersRunMulti", "No set of '%s' found for run %d",
+                                 d->GetTitle(), run);
+            continue;
+        }
+
+        // take the set from the parameter cache file if it is up to date
+        if (fParCache)
+        {
+            TCCalibration* c = fParCache->Read(d->GetName(), calibration, index->GetFirstRun(set),
+                                               index->GetChanged(set));
+            if (c)
+            {
+                list->Add(c);
+                continue;
+            }
+        }
 
-    // check set
-    if (set == -1)
+        // build sub-query (pad with NULL columns to the BLOB and the maximum number
+        // of parameter columns as the tables may use different storage modes)
+        TString sub = TString::Format("SELECT '%s', description, first_run, last_run, changed",
+                                      d->GetName());
+        Bool_t packed = GetTableStorage(d->GetTableName()) == kParBlob;
+        sub.Append(packed ? ", par_blob" : ", NULL");
+        for (Int_t i = 0; i < nColMax; i++)
+        {
+            if (!packed && i < d->GetSize()) sub.Append(TString::Format(", par_%03d", i));
+            else sub.Append(", NULL");
+        }
+        sub.Append(TString::Format(" FROM %s WHERE calibration = '%s' AND first_run = %d",
+                                   d->GetTableName(), calibration, index->GetFirstRun(set)));
+
+        // append sub-query
+        if (read.GetSize()) query.Append(" UNION ALL ");
+        query.Append(sub);
+        read.Add(d);
+    }
+
+    // check if anything was found
+    Int_t nCached = list->GetSize();
+    if (!read.GetSize() && !nCached)
     {
-        if (!fSilence) Error("ReadParametersRun", "No set of '%s' found for run %d",
-                             d->GetTitle(), run);
-        return kFALSE;
+        if (!fSilence) Error("ReadParametersRunMulti", "No calibration found for run %d!", run);
+        delete list;
+        return 0;
     }
 
-    // call main parameter reading method
-    return ReadParameters(data, calibration, set, par, length);
+    // check if everything was cached
+    if (!read.GetSize())
+    {
+        if (!fSilence) Info("ReadParametersRunMulti", "Read parameters of %d calibration data for run %d from the parameter cache",
+                            nCached, run);
+        return list;
+    }
+
+    // read from database
+    TSQLResult* res = SendQuery(query.Data());
+
+    // check result
+    if (!res)
+    {
+        if (!fSilence) Error("ReadParametersRunMulti", "Could not read the calibrations for run %d!", run);
+        delete list;
+        return 0;
+    }
+
+    // read all rows
+    Double_t par[nParMax];
+    TSQLRow* row = res->Next();
+    while (row)
+    {
+        // get data
+        TCCalibData* d = (TCCalibData*) read.FindObject(row->GetField(0));
+
+        if (d)
+        {
+            // create the calibration
+            TCCalibration* c = new TCCalibration();
+            c->SetCalibData(d->GetName());
+            c->SetCalibration(calibration);
+            c->SetDescription(row->GetField(1) ? row->GetField(1) : "");
+            c->SetFirstRun(atoi(row->GetField(2)));
+            c->SetLastRun(atoi(row->GetField(3)));
+            c->SetChangeTime(row->GetField(4) ? row->GetField(4) : "");
+
+            // read the parameters (BLOB in field 5, parameter columns start at field 6)
+            if (GetTableStorage(d->GetTableName()) == kParBlob)
+            {
+                Int_t n = row->GetField(5) ? TMath::Min(d->GetSize(), Int_t(row->GetFieldLength(5) / sizeof(Double_t))) : 0;
+                if (n) UnpackParameters(row->GetField(5), n, par);
+                for (Int_t i = n; i < d->GetSize(); i++) par[i] = 0;
+            }
+            else
+            {
+                for (Int_t i = 0; i < d->GetSize(); i++) par[i] = atof(row->GetField(i+6));
+            }
+            c->SetParameters(d->GetSize(), par);
+
+            // cache the set
+            {
+                TLockGuard lock(fMutex);
+                if (fParCache) fParCache->Write(c, TDatime(c->GetChangeTime()).Convert());
+            }
+
+            // add the calibration
+            list->Add(c);
+        }
+
+        delete row;
+        row = res->Next();
+    }
+
+    // clean-up
+    delete res;
+
+    // user information
+    if (!fSilence) Info("ReadParametersRunMulti", "Read parameters of %d calibration data for run %d from the database "
+                        "(%d from the parameter cache)", list->GetSize(), run, nCached);
+
+    return list;
 }
 
 //______________________________________________________________________________
@@ -1050,7 +2214,6 @@ Bool_t TCMySQLManager::ReadParameters(const Char_t* data, const Char_t* calibrat
     // for the calibration identifier 'calibration' from the database to the value array 'par'.
     // Return kFALSE if an error occurred, otherwise kTRUE.
 
-    TString query;
     Char_t table[256];
 
     // get data
@@ -1067,119 +2230,491 @@ Bool_t TCMySQLManager::ReadParameters(const Char_t* data, const Char_t* calibrat
     // get the first run of the set
     Int_t first_run = GetFirstRunOfSet(data, calibration, set);
 
-    // check first run
-    if (!first_run)
+    // check first run
+    if (!first_run)
+    {
+        if (!fSilence) Error("ReadParameters", "No calibration found for set %d of '%s'!",
+                             set, d->GetTitle());
+        return kFALSE;
+    }
+
+    // try the parameter cache file first
+    if (fParCache && ReadParametersCached(d, calibration, set, par, length)) return kTRUE;
+
+    // prepare the statement
+    TSQLStatement* stmt = PrepareBindStatement(GetParameterSQL(kParSelect, table, length));
+    if (!stmt) return kFALSE;
+
+    // bind the set and read from database
+    Bool_t res = kFALSE;
+    if (stmt->SetString(0, calibration) && stmt->SetInt(1, first_run) &&
+        stmt->Process() && stmt->StoreResult() && stmt->NextResultRow())
+    {
+        if (GetTableStorage(table) == kParBlob)
+        {
+            // unpack the parameters (missing parameters are set to 0)
+            void* buffer = 0;
+            Long_t size = 0;
+            if (stmt->GetBinary(0, buffer, size))
+            {
+                Int_t n = TMath::Min(length, Int_t(size / sizeof(Double_t)));
+                UnpackParameters((const Char_t*) buffer, n, par);
+                for (Int_t i = n; i < length; i++) par[i] = 0;
+                res = kTRUE;
+            }
+        }
+        else
+        {
+            for (Int_t i = 0; i < length; i++) par[i] = stmt->GetDouble(i);
+            res = kTRUE;
+        }
+    }
+    delete stmt;
+
+    // check result
+    if (!res)
+    {
+        if (!fSilence) Error("ReadParameters", "No calibration found for set %d of '%s'!",
+                             set, d->GetTitle());
+        return kFALSE;
+    }
+
+    // user information
+    if (!fSilence) Info("ReadParameters", "Read %d parameters of '%s' from the database",
+                        length, d->GetTitle());
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::WriteParameters(const Char_t* data, const Char_t* calibration, Int_t set,
+                                       Double_t* par, Int_t length)
+{
+    // Write 'length' parameters of the 'set'-th set of the calibration data 'data'
+    // for the calibration identifier 'calibration' from the value array 'par' to the database.
+    // Return kFALSE if an error occurred, otherwise kTRUE.
+
+    Char_t table[256];
+
+    // get data
+    TCCalibData* d = GetCalibData(data);
+    if (!d) return kFALSE;
+
+    // get the data table
+    if (!SearchTable(data, table))
+    {
+        if (!fSilence) Error("WriteParameters", "No data table found!");
+        return kFALSE;
+    }
+
+    // get the first run of the set
+    Int_t first_run = GetFirstRunOfSet(data, calibration, set);
+
+    // check first run
+    if (!first_run)
+    {
+        if (!fSilence) Error("WriteParameters", "Could not write parameters of '%s'!",
+                             d->GetTitle());
+        return kFALSE;
+    }
+
+    // prepare the statement
+    TSQLStatement* stmt = PrepareBindStatement(GetParameterSQL(kParUpdate, table, length));
+    if (!stmt) return kFALSE;
+
+    // bind all parameters and the set
+    Bool_t res = kTRUE;
+    if (GetTableStorage(table) == kParBlob)
+    {
+        // keep the stored parameters following the first 'length' parameters
+        Int_t nPar = TMath::Max(length, d->GetSize());
+        Double_t all[nPar];
+        if (length < nPar) res = ReadParameters(data, calibration, set, all, nPar);
+        for (Int_t j = 0; j < length; j++) all[j] = par[j];
+
+        // pack and bind the parameters
+        Char_t buffer[nPar*sizeof(Double_t)];
+        PackParameters(all, nPar, buffer);
+        if (res) res = stmt->SetBinary(0, buffer, sizeof(buffer), sizeof(buffer)) &&
+                       stmt->SetString(1, calibration) &&
+                       stmt->SetInt(2, first_run);
+    }
+    else
+    {
+        for (Int_t j = 0; res && j < length; j++) res = stmt->SetDouble(j, par[j]);
+        if (res) res = stmt->SetString(length, calibration) && stmt->SetInt(length+1, first_run);
+    }
+
+    // write data to database
+    if (res) res = stmt->Process();
+    delete stmt;
+
+    // check result
+    if (!res)
+    {
+        if (!fSilence) Error("WriteParameters", "Could not write parameters of '%s'!",
+                             d->GetTitle());
+        return kFALSE;
+    }
+    else
+    {
+        // the change time of the set was updated
+        ClearSetIndex(data, calibration, 1, &first_run);
+
+        if (!fSilence) Info("WriteParameters", "Wrote %d parameters of '%s' to the database",
+                            length, d->GetTitle());
+        return kTRUE;
+    }
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::WriteParametersSets(const Char_t* data, const Char_t* calibration,
+                                           Int_t nSet, const Int_t* set, Double_t* par, Int_t length)
+{
+    // Write 'length' parameters of the 'nSet' sets in 'set' of the calibration data 'data'
+    // for the calibration identifier 'calibration' from the value array 'par' to the database.
+    // All sets are written using one statement in one transaction.
+    // This method can be called by other threads than the main thread, e.g. to write
+    // the parameters in the background.
+    // Return kFALSE if an error occurred, otherwise kTRUE.
+
+    Char_t table[256];
+
+    // get data
+    TCCalibData* d = GetCalibData(data);
+    if (!d) return kFALSE;
+
+    // get the data table
+    if (!SearchTable(data, table))
+    {
+        if (!fSilence) Error("WriteParametersSets", "No data table found!");
+        return kFALSE;
+    }
+
+    // get the first runs of the sets
+    Int_t first_run[nSet];
+    {
+        LoadSetIndex(data, calibration);
+        TLockGuard lock(fMutex);
+        TCSetIndex* index = GetSetIndex(data, calibration);
+        for (Int_t i = 0; i < nSet; i++)
+        {
+            if (!index || !index->HasSet(set[i]))
+            {
+                if (!fSilence) Error("WriteParametersSets", "Could not write parameters of set %d of '%s'!",
+                                     set[i], d->GetTitle());
+                return kFALSE;
+            }
+            first_run[i] = index->GetFirstRun(set[i]);
+        }
+    }
+
+    // keep the stored parameters following the first 'length' parameters (packed storage)
+    Bool_t packed = GetTableStorage(table) == kParBlob;
+    Int_t nPar = packed ? TMath::Max(length, d->GetSize()) : length;
+    Double_t* all = new Double_t[nSet*nPar];
+    Bool_t res = kTRUE;
+    for (Int_t i = 0; res && i < nSet; i++)
+    {
+        if (length < nPar) res = ReadParameters(data, calibration, set[i], all + i*nPar, nPar);
+        for (Int_t j = 0; j < length; j++) all[i*nPar+j] = par[j];
+    }
+
+    // get the connection of this thread (pooled SQLite connections are read-only,
+    // other threads than the main thread open an own writable connection then)
+    Bool_t main = IsMainThread();
+    Bool_t own = !main && fDBType == kSQLite;
+    TSQLServer* db = 0;
+    if (res) db = own ? Connect(kFALSE) : GetConnection();
+
+    // prepare the statement for all sets
+    TSQLStatement* stmt = 0;
+    if (db && own)
+    {
+        stmt = db->Statement(GetParameterSQL(kParUpdate, table, length));
+        if (stmt && !stmt->NextIteration())
+        {
+            delete stmt;
+            stmt = 0;
+        }
+    }
+    else if (db) stmt = PrepareBindStatement(GetParameterSQL(kParUpdate, table, length));
+    res = stmt != 0;
+
+    // begin the transaction
+    Bool_t trans = kFALSE;
+    if (res) trans = main ? BeginTransaction() : db->StartTransaction();
+
+    // bind all sets
+    Char_t buffer[nPar*sizeof(Double_t)];
+    for (Int_t i = 0; res && i < nSet; i++)
+    {
+        if (i) res = stmt->NextIteration();
+        if (packed)
+        {
+            PackParameters(all + i*nPar, nPar, buffer);
+            if (res) res = stmt->SetBinary(0, buffer, sizeof(buffer), sizeof(buffer)) &&
+                           stmt->SetString(1, calibration) &&
+                           stmt->SetInt(2, first_run[i]);
+        }
+        else
+        {
+            for (Int_t j = 0; res && j < length; j++) res = stmt->SetDouble(j, all[i*nPar+j]);
+            if (res) res = stmt->SetString(length, calibration) && stmt->SetInt(length+1, first_run[i]);
+        }
+    }
+
+    // write data to database
+    if (res && nSet) res = stmt->Process();
+    delete [] all;
+
+    // commit or roll back
+    if (trans)
+    {
+        if (main)
+        {
+            if (res) res = CommitTransaction();
+            else RollbackTransaction();
+        }
+        else
+        {
+            if (res) res = db->Commit();
+            if (!res) db->Rollback();
+        }
+    }
+
+    // close the statement and the own connection
+    if (stmt) delete stmt;
+    if (own && db) delete db;
+
+    // the change times of the sets were updated
+    ClearSetIndex(data, calibration, nSet, first_run);
+
+    // check result
+    if (!res)
+    {
+        if (!fSilence) Error("WriteParametersSets", "Could not write parameters of '%s'!",
+                             d->GetTitle());
+        return kFALSE;
+    }
+    else
+    {
+        if (!fSilence) Info("WriteParametersSets", "Wrote %d parameters of '%s' for %d sets to the database",
+                            length, d->GetTitle(), nSet);
+        return kTRUE;
+    }
+}
+
+//______________________________________________________________________________
+TCCalibration* TCMySQLManager::ReadSetRow(TCCalibData* data, const Char_t* calibration,
+                                          TSQLStatement* stmt)
+{
+    // Create the calibration of the calibration data 'data' for the calibration
+    // identifier 'calibration' from the current result row of the statement 'stmt'
+    // (see kParSelectSet in GetParameterSQL()).
+    // NOTE: The calibration must be destroyed by the caller.
+
+    Int_t npar = data->GetSize();
+    Double_t* par;
+
+    // read the parameters (parameters start at field 4)
+    if (GetTableStorage(data->GetTableName()) == kParBlob)
+    {
+        // unpack all stored parameters (missing parameters are set to 0)
+        void* buffer = 0;
+        Long_t size = 0;
+        if (stmt->IsNull(4) || !stmt->GetBinary(4, buffer, size)) size = 0;
+        Int_t n = Int_t(size / sizeof(Double_t));
+        npar = TMath::Max(npar, n);
+        par = new Double_t[npar];
+        if (n) UnpackParameters((const Char_t*) buffer, n, par);
+        for (Int_t i = n; i < npar; i++) par[i] = 0;
+    }
+    else
+    {
+        par = new Double_t[npar];
+        for (Int_t i = 0; i < npar; i++) par[i] = stmt->GetDouble(i+4);
+    }
+
+    // create the calibration
+    TCCalibration* c = new TCCalibration();
+    c->SetCalibData(data->GetName());
+    c->SetCalibration(calibration);
+    c->SetDescription(stmt->IsNull(0) ? "" : stmt->GetString(0));
+    c->SetFirstRun(stmt->GetInt(1));
+    c->SetLastRun(stmt->GetInt(2));
+    c->SetChangeTime(stmt->IsNull(3) ? "" : stmt->GetString(3));
+    c->SetParameters(npar, par);
+    delete [] par;
+
+    return c;
+}
+
+//______________________________________________________________________________
+TCCalibration* TCMySQLManager::ReadSet(TCCalibData* data, const Char_t* calibration, Int_t first_run)
+{
+    // Read the set starting at the run 'first_run' of the calibration data 'data'
+    // for the calibration identifier 'calibration' from the database.
+    // Return the calibration or 0 if an error occurred.
+    // NOTE: The calibration must be destroyed by the caller.
+
+    // prepare the statement
+    TSQLStatement* stmt = PrepareBindStatement(GetParameterSQL(kParSelectSet, data->GetTableName(),
+                                                       data->GetSize()));
+    if (!stmt) return 0;
+
+    // bind the set and read from database
+    TCCalibration* c = 0;
+    if (stmt->SetString(0, calibration) && stmt->SetInt(1, first_run) &&
+        stmt->Process() && stmt->StoreResult() && stmt->NextResultRow())
+        c = ReadSetRow(data, calibration, stmt);
+    delete stmt;
+
+    return c;
+}
+
+//______________________________________________________________________________
+TList* TCMySQLManager::ReadSets(TCCalibData* data, const Char_t* calibration)
+{
+    // Read all sets of the calibration data 'data' for the calibration identifier
+    // 'calibration' from the database using a single query.
+    // Return a list of the calibrations ordered by their first run or 0 if an
+    // error occurred.
+    // NOTE: The list must be destroyed by the caller.
+
+    // prepare the statement
+    TSQLStatement* stmt = PrepareBindStatement(GetParameterSQL(kParSelectAll, data->GetTableName(),
+                                                       data->GetSize()));
+    if (!stmt) return 0;
+
+    // bind the calibration and read from database
+    if (!stmt->SetString(0, calibration) || !stmt->Process() || !stmt->StoreResult())
+    {
+        if (!fSilence) Error("ReadSets", "Could not read the sets of '%s'!", data->GetTitle());
+        delete stmt;
+        return 0;
+    }
+
+    // read all sets
+    TList* list = new TList();
+    list->SetOwner(kTRUE);
+    while (stmt->NextResultRow()) list->Add(ReadSetRow(data, calibration, stmt));
+    delete stmt;
+
+    return list;
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::ReadParametersCached(TCCalibData* data, const Char_t* calibration, Int_t set,
+                                            Double_t* par, Int_t length)
+{
+    // Read 'length' parameters of the 'set'-th set of the calibration data 'data'
+    // for the calibration identifier 'calibration' via the parameter cache file to
+    // the value array 'par'. Sets that are not cached or outdated are read from
+    // the database and written to the cache file.
+    // Return kFALSE if the parameters could not be read this way, otherwise kTRUE.
+
+    // get the set and its change time
+    Int_t first_run;
+    UInt_t changed;
+    LoadSetIndex(data->GetName(), calibration);
     {
-        if (!fSilence) Error("ReadParameters", "No calibration found for set %d of '%s'!",
-                             set, d->GetTitle());
-        return kFALSE;
+        TLockGuard lock(fMutex);
+        TCSetIndex* index = GetSetIndex(data->GetName(), calibration);
+        if (!index || !index->HasSet(set) || !index->GetChanged(set)) return kFALSE;
+        first_run = index->GetFirstRun(set);
+        changed = index->GetChanged(set);
     }
 
-    // create the query
-    query.Form("SELECT * FROM %s WHERE "
-               "calibration = '%s' AND "
-               "first_run = %d",
-               table, calibration, first_run);
-
-    // read from database
-    TSQLResult* res = SendQuery(query.Data());
-
-    // check result
-    if (!res)
+    // read the set from the cache file
+    Bool_t cached = kTRUE;
+    TCCalibration* c = 0;
     {
-        if (!fSilence) Error("ReadParameters", "No calibration found for set %d of '%s'!",
-                             set, d->GetTitle());
-        return kFALSE;
+        TLockGuard lock(fMutex);
+        if (!fParCache) return kFALSE;
+        c = fParCache->Read(data->GetName(), calibration, first_run, changed);
     }
 
-    // get data (parameters start at field 5)
-    TSQLRow* row = res->Next();
+    // read the set from the database (without holding the lock) and cache it
+    if (!c)
+    {
+        cached = kFALSE;
+        c = ReadSet(data, calibration, first_run);
+        if (!c) return kFALSE;
+        TLockGuard lock(fMutex);
+        if (fParCache) fParCache->Write(c, TDatime(c->GetChangeTime()).Convert());
+    }
 
-    // check row
-    if (!row)
+    // check the number of parameters
+    if (length > c->GetNParameters())
     {
-        if (!fSilence) Error("ReadParameters", "No calibration found for set %d of '%s'!",
-                             set, d->GetTitle());
-        delete res;
+        delete c;
         return kFALSE;
     }
 
-    for (Int_t i = 0; i < length; i++) par[i] = atof(row->GetField(i+5));
-
-    // clean-up
-    delete row;
-    delete res;
+    // copy the parameters
+    for (Int_t i = 0; i < length; i++) par[i] = c->GetParameters()[i];
+    delete c;
 
     // user information
-    if (!fSilence) Info("ReadParameters", "Read %d parameters of '%s' from the database",
-                        length, d->GetTitle());
+    if (!fSilence) Info("ReadParameters", "Read %d parameters of '%s' from the %s",
+                        length, data->GetTitle(), cached ? "parameter cache" : "database");
 
     return kTRUE;
 }
 
 //______________________________________________________________________________
-Bool_t TCMySQLManager::WriteParameters(const Char_t* data, const Char_t* calibration, Int_t set,
-                                       Double_t* par, Int_t length)
+Bool_t TCMySQLManager::OpenParCache(const Char_t* fileName)
 {
-    // Write 'length' parameters of the 'set'-th set of the calibration data 'data'
-    // for the calibration identifier 'calibration' from the value array 'par' to the database.
-    // Return kFALSE if an error occurred, otherwise kTRUE.
-
-    Char_t table[256];
+    // Open the parameter cache file 'fileName'. Parameters read from the database
+    // are cached in this file and read from there as long as their sets are
+    // unchanged. The file can be shared by many processes.
+    // Return kTRUE on success, otherwise kFALSE.
 
-    // get data
-    TCCalibData* d = GetCalibData(data);
-    if (!d) return kFALSE;
+    // close the current cache file
+    CloseParCache();
 
-    // get the data table
-    if (!SearchTable(data, table))
+    // check server connection
+    if (!fDB)
     {
-        if (!fSilence) Error("WriteParameters", "No data table found!");
+        if (!fSilence) Error("OpenParCache", "No connection to the database!");
         return kFALSE;
     }
 
-    // get the first run of the set
-    Int_t first_run = GetFirstRunOfSet(data, calibration, set);
+    // open the cache file
+    Char_t* exp = gSystem->ExpandPathName(fileName);
+    TCParCache* cache = new TCParCache(exp, fDBUrl.Data(), fSilence);
+    delete exp;
 
-    // check first run
-    if (!first_run)
+    // check the cache file
+    if (!cache->IsOpen())
     {
-        if (!fSilence) Error("WriteParameters", "Could not write parameters of '%s'!",
-                             d->GetTitle());
+        if (!fSilence) Error("OpenParCache", "Could not open the parameter cache file '%s'!", fileName);
+        delete cache;
         return kFALSE;
     }
 
-    // prepare the insert query
-    TString query = TString::Format("UPDATE %s SET ", table);
+    // lock the caches
+    TLockGuard lock(fMutex);
+    fParCache = cache;
 
-    // read all parameters and write them to new query
-    for (Int_t j = 0; j < length; j++)
-    {
-        // append parameter to query
-        query.Append(TString::Format("par_%03d = %.17g", j, par[j]));
-        if (j != length - 1) query.Append(",");
-    }
+    // user information
+    if (!fSilence) Info("OpenParCache", "Using the parameter cache file '%s' (%d cached sets)",
+                        fileName, fParCache->GetNEntries());
 
-    // finish query
-    query.Append(TString::Format(" WHERE calibration = '%s' AND first_run = %d",
-                                 calibration, first_run));
+    return kTRUE;
+}
 
-    // write data to database
-    Bool_t res = SendExec(query.Data());
+//______________________________________________________________________________
+void TCMySQLManager::CloseParCache()
+{
+    // Close the parameter cache file.
 
-    // check result
-    if (!res)
-    {
-        if (!fSilence) Error("WriteParameters", "Could not write parameters of '%s'!",
-                             d->GetTitle());
-        return kFALSE;
-    }
-    else
-    {
-        if (!fSilence) Info("WriteParameters", "Wrote %d parameters of '%s' to the database",
-                            length, d->GetTitle());
-        return kTRUE;
-    }
+    // lock the caches
+    TLockGuard lock(fMutex);
+
+    if (fParCache) delete fParCache;
+    fParCache = 0;
 }
 
 //______________________________________________________________________________
@@ -1221,9 +2756,17 @@ Bool_t TCMySQLManager::InitDatabase(Bool_t interact)
         }
     }
 
+    // get the parameter storage mode
+    ReadParStorageConfig();
+    if (!fSilence) Info("InitDatabase", "Using %s parameter storage",
+                        fParStorage == kParBlob ? "packed" : "column");
+
     // create the main table
     CreateMainTable();
 
+    // create the bad scaler read table
+    CreateBadScRTable();
+
     // create the data tables
     TIter next(fData);
     TCCalibData* d;
@@ -1285,6 +2828,7 @@ Bool_t TCMySQLManager::UpgradeDatabase(Int_t version)
 
     // create queries (update only this part in the future)
     std::vector<TString> query;
+    Bool_t err = kFALSE;
     switch (version)
     {
         // version 3:
@@ -1334,6 +2878,60 @@ Bool_t TCMySQLManager::UpgradeDatabase(Int_t version)
 
             break;
         }
+        // version 6:
+        // - convert all data tables to packed parameter storage
+        case 6:
+        {
+            // use packed storage for the new tables
+            fParStorage = kParBlob;
+
+            // loop over data tables
+            Int_t nConv = 0;
+            TIter next(fData);
+            TCCalibData* d;
+            while ((d = (TCCalibData*)next()))
+            {
+                // skip tables converted already (e.g. by an interrupted upgrade)
+                // and tables not existing
+                if (GetTableStorage(d->GetTableName()) == kParBlob) continue;
+
+                // convert table
+                nConv++;
+                if (!ConvertDataTableToBlob(d))
+                {
+                    Error("UpgradeDatabase", "Some errors occurred while converting the data table for '%s'!", d->GetName());
+                    err = kTRUE;
+                }
+            }
+
+            // check if anything was converted
+            if (!nConv) Info("UpgradeDatabase", "Database uses packed parameter storage already");
+
+            break;
+        }
+        // version 7:
+        // - add the bad scaler read table and copy the bad scaler reads
+        case 7:
+        {
+            // create the table
+            CreateBadScRTable();
+            if (!fBadScRTable)
+            {
+                Error("UpgradeDatabase", "Could not create the bad scaler read table!");
+                err = kTRUE;
+                break;
+            }
+
+            // copy the bad scaler reads (replaces the rows of a previous
+            // upgrade, e.g. after older versions changed the strings)
+            if (!MigrateBadScR(0, kMaxInt))
+            {
+                Error("UpgradeDatabase", "Some errors occurred while copying the bad scaler reads!");
+                err = kTRUE;
+            }
+
+            break;
+        }
         default:
         {
             Error("UpgradeDatabase", "Database upgrade to version %d not implemented!", version);
@@ -1358,7 +2956,7 @@ Bool_t TCMySQLManager::UpgradeDatabase(Int_t version)
     }
 
     // check final result
-    if (queryOk == query.size())
+    if (!err && queryOk == query.size())
     {
         Info("UpgradeDatabase", "Performed upgrade of database");
         return kTRUE;
@@ -1370,6 +2968,130 @@ Bool_t TCMySQLManager::UpgradeDatabase(Int_t version)
     }
 }
 
+//______________________________________________________________________________
+Bool_t TCMySQLManager::ConvertDataTableToBlob(TCCalibData* data)
+{
+    // Convert the data table of the calibration data 'data' from one column per
+    // parameter to packed parameter storage keeping all sets including their
+    // change time. The original table is restored if an error occurs (or kept
+    // as '<table>_old' if it cannot be restored).
+    // Return kTRUE on success, otherwise kFALSE.
+
+    const Char_t* table = data->GetTableName();
+    Int_t nPar = data->GetSize();
+
+    // create the query
+    TString query = "SELECT calibration, description, first_run, last_run, changed";
+    for (Int_t i = 0; i < nPar; i++) query.Append(TString::Format(", par_%03d", i));
+    query.Append(TString::Format(" FROM %s", table));
+
+    // read all sets
+    TSQLStatement* stmt = PrepareStatement(query.Data());
+    if (!stmt) return kFALSE;
+    if (!stmt->Process() || !stmt->StoreResult())
+    {
+        Error("ConvertDataTableToBlob", "Could not read the sets of '%s'!", data->GetTitle());
+        delete stmt;
+        return kFALSE;
+    }
+
+    // loop over sets
+    TList sets;
+    sets.SetOwner(kTRUE);
+    Double_t par[nPar];
+    while (stmt->NextResultRow())
+    {
+        TCCalibration* c = new TCCalibration();
+        c->SetCalibration(stmt->GetString(0));
+        c->SetDescription(stmt->IsNull(1) ? "" : stmt->GetString(1));
+        c->SetFirstRun(stmt->GetInt(2));
+        c->SetLastRun(stmt->GetInt(3));
+        c->SetChangeTime(stmt->GetString(4));
+        for (Int_t i = 0; i < nPar; i++) par[i] = stmt->GetDouble(i+5);
+        c->SetParameters(nPar, par);
+        sets.Add(c);
+    }
+    delete stmt;
+
+    // rename the original table (the column storage of the table is restored
+    // if the conversion fails, a repeated upgrade converts it again)
+    if (fDBType == kSQLite) SendExec(TString::Format("DROP TRIGGER IF EXISTS after_%s_update", table).Data());
+    if (!SendExec(TString::Format("ALTER TABLE %s RENAME TO %s_old", table, table).Data()))
+    {
+        Error("ConvertDataTableToBlob", "Could not rename the data table '%s'!", table);
+        return kFALSE;
+    }
+
+    // create the new table
+    Bool_t res = CreateDataTable(data->GetName(), nPar);
+
+    // prepare the insert statement
+    stmt = 0;
+    if (res)
+    {
+        stmt = PrepareStatement(TString::Format("INSERT INTO %s (calibration, description, first_run, last_run, changed, par_blob) "
+                                                "VALUES (?, ?, ?, ?, ?, ?)", table).Data());
+        res = stmt != 0;
+    }
+
+    // write all sets in one transaction
+    Bool_t trans = res ? BeginTransaction() : kFALSE;
+    Char_t buffer[nPar*sizeof(Double_t)];
+    TIter next(&sets);
+    TCCalibration* c;
+    while (res && (c = (TCCalibration*)next()))
+    {
+        PackParameters(c->GetParameters(), nPar, buffer);
+        res = stmt->NextIteration() &&
+              stmt->SetString(0, c->GetCalibration()) &&
+              stmt->SetString(1, c->GetDescription(), 1025) &&
+              stmt->SetInt(2, c->GetFirstRun()) &&
+              stmt->SetInt(3, c->GetLastRun()) &&
+              stmt->SetString(4, c->GetChangeTime()) &&
+              stmt->SetBinary(5, buffer, sizeof(buffer), sizeof(buffer));
+    }
+    if (res && sets.GetSize()) res = stmt->Process();
+    if (stmt) delete stmt;
+
+    // commit or roll back
+    if (trans)
+    {
+        if (res) res = CommitTransaction();
+        else RollbackTransaction();
+    }
+
+    // invalidate the set indices
+    ClearSetIndex(data->GetName());
+
+    // restore the original table on errors
+    if (!res)
+    {
+        SendExec(TString::Format("DROP TABLE IF EXISTS %s", table).Data());
+        if (SendExec(TString::Format("ALTER TABLE %s_old RENAME TO %s", table, table).Data()))
+        {
+            if (fDBType == kSQLite) CreateDataTableTrigger(table);
+            SetTableStorage(table, kParColumns);
+            Error("ConvertDataTableToBlob", "Could not convert the data table of '%s' - original table restored!",
+                  data->GetTitle());
+        }
+        else
+        {
+            Error("ConvertDataTableToBlob", "Could not convert the data table of '%s' - original data kept in '%s_old'!",
+                  data->GetTitle(), table);
+        }
+        return kFALSE;
+    }
+
+    // delete the original table
+    SendExec(TString::Format("DROP TABLE %s_old", table).Data());
+
+    // user information
+    Info("ConvertDataTableToBlob", "Converted %d sets of '%s' to packed parameter storage",
+         sets.GetSize(), data->GetTitle());
+
+    return kTRUE;
+}
+
 //______________________________________________________________________________
 Bool_t TCMySQLManager::AddNewDataTable(const Char_t* data)
 {
@@ -1475,7 +3197,8 @@ void TCMySQLManager::AddRunFiles(const Char_t* path, const Char_t* target,
     }
 
     // loop over runs
-    Int_t nRunAdded = 0;
+    TList rows;
+    rows.SetOwner(kTRUE);
     for (Int_t i = 0; i < nRun; i++)
     {
         TCACQUFile* f = r.GetFile(i);
@@ -1484,38 +3207,41 @@ void TCMySQLManager::AddRunFiles(const Char_t* path, const Char_t* target,
         strptime(f->GetTime(), "%a %b %d %H:%M:%S %Y", &tm);
         strftime(time, sizeof(time), "%Y-%m-%d %H:%M:%S", &tm);
 
-        // prepare the insert query
-        TString ins_query = TString::Format("INSERT INTO %s (run, path, filename, time, description, run_note, size, target) "
-                                            "VALUES ( "
-                                            "%d, "
-                                            "\"%s\", "
-                                            "\"%s\", "
-                                            "\"%s\", "
-                                            "\"%s\", "
-                                            "\"%s\", "
-                                            "%lld, "
-                                            "\"%s\" )",
-                                            TCConfig::kCalibMainTableName,
-                                            f->GetRun(),
-                                            path,
-                                            f->GetFileName(),
-                                            time,
-                                            f->GetDescription(),
-                                            f->GetRunNote(),
-                                            f->GetSize(),
-                                            target);
-
-        // try to write data to database
-        Bool_t res = SendExec(ins_query.Data());
-        if (!res)
+        // prepare the row values
+        rows.Add(new TObjString(TString::Format("( "
+                                                "%d, "
+                                                "%s, "
+                                                "%s, "
+                                                "%s, "
+                                                "%s, "
+                                                "%s, "
+                                                "%lld, "
+                                                "%s )",
+                                                f->GetRun(),
+                                                QuoteString(path).Data(),
+                                                QuoteString(f->GetFileName()).Data(),
+                                                QuoteString(time).Data(),
+                                                QuoteString(f->GetDescription()).Data(),
+                                                QuoteString(f->GetRunNote()).Data(),
+                                                f->GetSize(),
+                                                QuoteString(target).Data())));
+    }
+
+    // try to write data to database
+    Bool_t added[nRun];
+    Int_t nRunAdded = BulkInsert(TCConfig::kCalibMainTableName,
+                                 "run, path, filename, time, description, run_note, size, target",
+                                 &rows, added);
+
+    // report runs that could not be added
+    for (Int_t i = 0; i < nRun; i++)
+    {
+        if (!added[i])
         {
+            TCACQUFile* f = r.GetFile(i);
             Warning("AddRunFiles", "Run %d of file '%s/%s' could not be added to the database!",
                     f->GetRun(), path, f->GetFileName());
         }
-        else
-        {
-            nRunAdded++;
-        }
     }
 
     // user information
@@ -1534,19 +3260,22 @@ void TCMySQLManager::AddRun(Int_t run, const Char_t* target, const Char_t* desc)
     if (target) strcpy(t, target);
     if (desc) strcpy(d, desc);
 
-    // prepare the insert query
-    TString ins_query = TString::Format("INSERT INTO %s (run, description, target) "
-                                        "VALUES ( "
-                                        "%d, "
-                                        "'%s', "
-                                        "'%s' )",
-                                        TCConfig::kCalibMainTableName,
-                                        run,
-                                        d,
-                                        t);
+    // prepare the statement
+    TSQLStatement* stmt = PrepareStatement(TString::Format("INSERT INTO %s (run, description, target) "
+                                                           "VALUES ( ?, ?, ? )",
+                                                           TCConfig::kCalibMainTableName).Data());
 
     // try to write data to database
-    Bool_t res = SendExec(ins_query.Data());
+    Bool_t res = kFALSE;
+    if (stmt)
+    {
+        res = stmt->NextIteration() &&
+              stmt->SetInt(0, run) &&
+              stmt->SetString(1, d) &&
+              stmt->SetString(2, t) &&
+              stmt->Process();
+        delete stmt;
+    }
     if (!res)
     {
         if (!fSilence) Warning("AddRun", "Run %d could not be added to the database!", run);
@@ -1798,6 +3527,10 @@ Bool_t TCMySQLManager::ChangeCalibrationName(const Char_t* calibration, const Ch
         // read from database
         Bool_t res = SendExec(query.Data());
 
+        // invalidate the set indices
+        ClearSetIndex(d->GetName(), calibration);
+        ClearSetIndex(d->GetName(), newCalibration);
+
         // check result
         if (!res)
         {
@@ -1938,6 +3671,9 @@ Bool_t TCMySQLManager::ChangeCalibrationRunRange(const Char_t* calibration, cons
                        d->GetTableName(), firstRun, calibration, oldFirstRun);
             Bool_t res = SendExec(query.Data());
 
+            // invalidate the set index
+            ClearSetIndex(d->GetName(), calibration);
+
             // check result
             if (!res)
             {
@@ -1961,6 +3697,9 @@ Bool_t TCMySQLManager::ChangeCalibrationRunRange(const Char_t* calibration, cons
                        d->GetTableName(), lastRun, calibration, oldLastRun);
             Bool_t res = SendExec(query.Data());
 
+            // invalidate the set index
+            ClearSetIndex(d->GetName(), calibration);
+
             // check result
             if (!res)
             {
@@ -2009,6 +3748,9 @@ Bool_t TCMySQLManager::RemoveCalibration(const Char_t* calibration, const Char_t
     // read from database
     Bool_t res = SendExec(query.Data());
 
+    // invalidate the set index
+    ClearSetIndex(data, calibration);
+
     // check result
     if (!res)
     {
@@ -2055,6 +3797,10 @@ Bool_t TCMySQLManager::RemoveAllRuns()
     // read from database
     Bool_t res = SendExec(query.Data());
 
+    // remove the bad scaler reads of the runs
+    if (res && fBadScRTable)
+        res = SendExec(TString::Format("DELETE FROM %s", TCConfig::kBadScRTableName).Data());
+
     // check result
     if (!res)
     {
@@ -2295,15 +4041,27 @@ Bool_t TCMySQLManager::CreateDataTable(const Char_t* data, Int_t nElem)
     // delete the old table if it exists
     SendExec(TString::Format("DROP TABLE IF EXISTS %s", table));
 
+    // invalidate the set indices
+    ClearSetIndex(data);
+
     // prepare CREATE TABLE query
     TString query;
     query.Append(TString::Format("CREATE TABLE %s ( %s ", table, TCConfig::kCalibDataTableHeader));
 
-    // loop over elements
-    for (Int_t j = 0; j < nElem; j++)
+    // add parameter columns
+    if (fParStorage == kParBlob)
+    {
+        // all parameters packed into one column
+        query.Append("par_blob BLOB");
+    }
+    else
     {
-        query.Append(TString::Format("par_%03d DOUBLE DEFAULT 0", j));
-        if (j != nElem - 1) query.Append(", ");
+        // loop over elements
+        for (Int_t j = 0; j < nElem; j++)
+        {
+            query.Append(TString::Format("par_%03d DOUBLE DEFAULT 0", j));
+            if (j != nElem - 1) query.Append(", ");
+        }
     }
 
     // finish preparing the query
@@ -2330,20 +4088,32 @@ Bool_t TCMySQLManager::CreateDataTable(const Char_t* data, Int_t nElem)
         SendExec(TString::Format("DROP TRIGGER IF EXISTS timestamp_update_%s", table).Data());
 
         // create the timestamp update trigger
-        SendExec(TString::Format("CREATE TRIGGER after_%s_update "
-                                 "AFTER UPDATE "
-                                 "ON %s "
-                                 "FOR EACH ROW "
-                                 "WHEN NEW.changed <= OLD.changed "
-                                 "BEGIN "
-                                 "UPDATE %s SET changed = CURRENT_TIMESTAMP WHERE calibration = OLD.calibration AND first_run = old.first_run ; "
-                                 "END",
-                                 table, table, table).Data());
+        CreateDataTableTrigger(table);
     }
 
+    // set the storage mode of the table
+    SetTableStorage(table, fParStorage);
+
     return kTRUE;
 }
 
+//______________________________________________________________________________
+void TCMySQLManager::CreateDataTableTrigger(const Char_t* table)
+{
+    // Create the trigger updating the change time of the sets of the data table
+    // 'table' (SQLite only).
+
+    SendExec(TString::Format("CREATE TRIGGER after_%s_update "
+                             "AFTER UPDATE "
+                             "ON %s "
+                             "FOR EACH ROW "
+                             "WHEN NEW.changed <= OLD.changed "
+                             "BEGIN "
+                             "UPDATE %s SET changed = CURRENT_TIMESTAMP WHERE calibration = OLD.calibration AND first_run = old.first_run ; "
+                             "END",
+                             table, table, table).Data());
+}
+
 //______________________________________________________________________________
 TList* TCMySQLManager::SearchDistinctEntries(const Char_t* field, const Char_t* table)
 {
@@ -2446,125 +4216,303 @@ Bool_t TCMySQLManager::AddDataSet(const Char_t* data, const Char_t* calibration,
     // Check run numbers if 'skipChecks' is kFALSE (default) and abort on errors.
     // Return kFALSE when an error occurred, otherwise kTRUE.
 
-    TString table;
-
     // get data
-    TCCalibData* d = GetCalibData(data);
-    if (!d) return kFALSE;
+    if (!GetCalibData(data)) return kFALSE;
+
+    // create the set
+    TCCalibration c;
+    c.SetCalibData(data);
+    c.SetCalibration(calibration);
+    c.SetDescription(desc ? desc : "");
+    c.SetFirstRun(first_run);
+    c.SetLastRun(last_run);
+    c.SetParameters(length, par);
+
+    // add the set
+    TList sets;
+    sets.Add(&c);
+    return AddDataSets(&sets, skipChecks);
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::CheckRunRanges(TCollection* sets)
+{
+    // Check the run ranges of the new sets given by the calibrations in the
+    // collection 'sets'. First and last runs have to exist and the run ranges
+    // must not overlap with each other or with the existing sets of their
+    // calibration data and calibration. The existing run intervals are taken
+    // from the set indices and all run ranges of a calibration are checked
+    // using a sort-and-sweep.
+    // Return kTRUE if all run ranges are valid, otherwise kFALSE.
+
+    typedef std::pair<std::pair<Int_t, Int_t>, Int_t> Range_t;
+
+    // collect the first and last runs
+    std::vector<Int_t> runs;
+    TList calibs;
+    calibs.SetOwner(kTRUE);
+    TIter next(sets);
+    TCCalibration* c;
+    while ((c = (TCCalibration*)next()))
+    {
+        // check if first run is smaller than last run
+        if (c->GetFirstRun() > c->GetLastRun())
+        {
+            if (!fSilence) Error("CheckRunRanges", "First run of set has to be smaller than last run (runs %d to %d)!",
+                                 c->GetFirstRun(), c->GetLastRun());
+            return kFALSE;
+        }
+        runs.push_back(c->GetFirstRun());
+        runs.push_back(c->GetLastRun());
+
+        // group the sets by calibration data and calibration
+        TString key = TCSetIndex::BuildKey(c->GetCalibData(), c->GetCalibration());
+        TList* g = (TList*) calibs.FindObject(key.Data());
+        if (!g)
+        {
+            g = new TList();
+            g->SetName(key.Data());
+            calibs.Add(g);
+        }
+        g->Add(c);
+    }
+
+    //
+    // check if first and last runs exist
+    //
+
+    // search the runs in chunks
+    std::sort(runs.begin(), runs.end());
+    runs.erase(std::unique(runs.begin(), runs.end()), runs.end());
+    std::vector<Int_t> found;
+    const UInt_t chunk = 500;
+    for (UInt_t i = 0; i < runs.size(); i += chunk)
+    {
+        TString query = TString::Format("SELECT run FROM %s WHERE run IN (", TCConfig::kCalibMainTableName);
+        for (UInt_t j = i; j < runs.size() && j < i + chunk; j++)
+        {
+            if (j > i) query.Append(", ");
+            query.Append(TString::Format("%d", runs[j]));
+        }
+        query.Append(")");
+
+        // read from database
+        TSQLResult* res = SendQuery(query.Data());
+        if (!res)
+        {
+            if (!fSilence) Error("CheckRunRanges", "Could not read the runs!");
+            return kFALSE;
+        }
+        TSQLRow* row;
+        while ((row = res->Next()))
+        {
+            found.push_back(atoi(row->GetField(0)));
+            delete row;
+        }
+        delete res;
+    }
+
+    // check the runs
+    std::sort(found.begin(), found.end());
+    for (UInt_t i = 0; i < runs.size(); i++)
+    {
+        if (!std::binary_search(found.begin(), found.end(), runs[i]))
+        {
+            if (!fSilence) Error("CheckRunRanges", "Run %d has no valid run number!", runs[i]);
+            return kFALSE;
+        }
+    }
+
+    //
+    // check if the run ranges are not overlapping
+    //
+
+    TIter nextCalib(&calibs);
+    TList* g;
+    while ((g = (TList*)nextCalib()))
+    {
+        TCCalibration* first = (TCCalibration*) g->First();
+        TCCalibData* d = GetCalibData(first->GetCalibData());
+
+        // collect the run ranges of the existing sets (tagged with the set number)
+        std::vector<Range_t> ranges;
+        {
+            LoadSetIndex(first->GetCalibData(), first->GetCalibration());
+            TLockGuard lock(fMutex);
+            TCSetIndex* index = GetSetIndex(first->GetCalibData(), first->GetCalibration());
+            if (!index) return kFALSE;
+            for (Int_t i = 0; i < index->GetNsets(); i++)
+                ranges.push_back(Range_t(std::make_pair(index->GetFirstRun(i), index->GetLastRun(i)), i));
+        }
+
+        // add the run ranges of the new sets (tagged with -1)
+        TIter nextSet(g);
+        while ((c = (TCCalibration*)nextSet()))
+            ranges.push_back(Range_t(std::make_pair(c->GetFirstRun(), c->GetLastRun()), -1));
+
+        // sort by first run and compare each range with the preceding one
+        // (the preceding ranges were checked to be disjoint already)
+        std::sort(ranges.begin(), ranges.end());
+        for (UInt_t i = 1; i < ranges.size(); i++)
+        {
+            const Range_t& a = ranges[i-1];
+            const Range_t& b = ranges[i];
+            if (b.first.first > a.first.second) continue;
+
+            // report the overlap
+            if (!fSilence)
+            {
+                if (a.second >= 0 || b.second >= 0)
+                {
+                    const Range_t& n = a.second >= 0 ? b : a;
+                    Error("CheckRunRanges", "Runs %d to %d of '%s' overlap with set %d",
+                          n.first.first, n.first.second, d->GetTitle(), a.second >= 0 ? a.second : b.second);
+                }
+                else
+                {
+                    Error("CheckRunRanges", "Runs %d to %d and %d to %d of '%s' overlap",
+                          a.first.first, a.first.second, b.first.first, b.first.second, d->GetTitle());
+                }
+            }
+            return kFALSE;
+        }
+    }
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::AddDataSets(TCollection* sets, Bool_t skipChecks)
+{
+    // Create the new sets given by the calibrations (TCCalibration) in the
+    // collection 'sets' using their calibration data, calibration identifier,
+    // description, run range and parameters.
+    // Check the run ranges of all sets together if 'skipChecks' is kFALSE
+    // (default, see CheckRunRanges()) and abort on errors.
+    // All sets are written in one transaction, i.e. no set is added if an
+    // error occurred.
+    // Return kFALSE when an error occurred, otherwise kTRUE.
 
-    // do some checks concerning the run numbers
-    if (!skipChecks)
+    // check sets
+    if (!sets || !sets->GetSize()) return kTRUE;
+
+    // group the sets by calibration data and number of parameters
+    TList tables;
+    tables.SetOwner(kTRUE);
+    TIter next(sets);
+    TCCalibration* c;
+    while ((c = (TCCalibration*)next()))
     {
-        //
-        // check if first and last run exist
-        //
+        // check data
+        if (!GetCalibData(c->GetCalibData())) return kFALSE;
 
-        // check first run
-        if (!SearchRunEntry(first_run, "run", table))
+        // add to the group
+        TString key = TString::Format("%s|%d", c->GetCalibData(), c->GetNParameters());
+        TList* g = (TList*) tables.FindObject(key.Data());
+        if (!g)
         {
-            if (!fSilence) Error("AddDataSet", "First run has no valid run number!");
-            return kFALSE;
+            g = new TList();
+            g->SetName(key.Data());
+            tables.Add(g);
         }
+        g->Add(c);
+    }
 
-        // check last run
-        if (!SearchRunEntry(last_run, "run", table))
-        {
-            if (!fSilence) Error("AddDataSet", "Last run has no valid run number!");
-            return kFALSE;
-        }
+    // do some checks concerning the run numbers
+    if (!skipChecks && !CheckRunRanges(sets)) return kFALSE;
 
-        //
-        // check if the run range is ok
-        //
+    //
+    // create the sets
+    //
 
-        // check if first run is smaller than last run
-        if (first_run > last_run)
+    // write all sets in one transaction
+    Bool_t trans = BeginTransaction();
+    Bool_t res = kTRUE;
+    TIter nextTable(&tables);
+    TList* g;
+    while (res && (g = (TList*)nextTable()))
+    {
+        c = (TCCalibration*) g->First();
+        TCCalibData* d = GetCalibData(c->GetCalibData());
+        Int_t length = c->GetNParameters();
+
+        // prepare the statement
+        TSQLStatement* stmt = PrepareBindStatement(GetParameterSQL(kParInsert, d->GetTableName(), length));
+        if (!stmt)
         {
-            if (!fSilence) Error("AddDataSet", "First run of set has to be smaller than last run!");
-            return kFALSE;
+            res = kFALSE;
+            break;
         }
 
-        // get number of existing sets
-        Int_t nSet = GetNsets(data, calibration);
-
-        // loop over sets
-        for (Int_t i = 0; i < nSet; i++)
+        // bind the set information and all parameters of all sets
+        Bool_t packed = GetTableStorage(d->GetTableName()) == kParBlob;
+        Int_t nPar = packed ? TMath::Max(length, d->GetSize()) : length;
+        Double_t all[nPar];
+        Char_t buffer[nPar*sizeof(Double_t)];
+        TIter nextSet(g);
+        Bool_t first = kTRUE;
+        while (res && (c = (TCCalibration*)nextSet()))
         {
-            // get first and last runs of set
-            Int_t setLow = GetFirstRunOfSet(data, calibration, i);
-            Int_t setHigh = GetLastRunOfSet(data, calibration, i);
-
-            // check if first run is member of this set
-            if (first_run >= setLow && first_run <= setHigh)
+            res = (first || stmt->NextIteration()) &&
+                  stmt->SetString(0, c->GetCalibration()) &&
+                  stmt->SetString(1, c->GetDescription()) &&
+                  stmt->SetInt(2, c->GetFirstRun()) &&
+                  stmt->SetInt(3, c->GetLastRun());
+            if (packed)
             {
-                if (!fSilence) Error("AddDataSet", "First run is already member of set %d", i);
-                return kFALSE;
-            }
-
-            // check if last run is member of this set
-            if (last_run >= setLow && last_run <= setHigh)
-            {
-                if (!fSilence) Error("AddDataSet", "Last run is already member of set %d", i);
-                return kFALSE;
+                // pack the parameters (missing parameters are set to 0)
+                for (Int_t j = 0; j < nPar; j++) all[j] = j < length ? c->GetParameters()[j] : 0;
+                PackParameters(all, nPar, buffer);
+                if (res) res = stmt->SetBinary(4, buffer, sizeof(buffer), sizeof(buffer));
             }
-
-            // check if sets are not overlapping
-            if ((setLow >= first_run && setLow <= last_run) ||
-                (setHigh >= first_run && setHigh <= last_run))
+            else
             {
-                if (!fSilence) Error("AddDataSet", "Run overlap with set %d", i);
-                return kFALSE;
+                for (Int_t j = 0; res && j < length; j++) res = stmt->SetDouble(j+4, c->GetParameters()[j]);
             }
+            first = kFALSE;
         }
-    }
 
-    //
-    // create the set
-    //
+        // write data to database
+        if (res) res = stmt->Process();
+        delete stmt;
+    }
 
-    // get the data table
-    Char_t ctable[256];
-    if (!SearchTable(data, ctable))
+    // commit or roll back
+    if (trans)
     {
-        if (!fSilence) Error("AddDataSet", "No data table found!");
-        return kFALSE;
+        if (res) res = CommitTransaction();
+        else RollbackTransaction();
     }
 
-    // prepare the insert query
-    TString ins_query_1 = TString::Format("INSERT INTO %s (calibration, description, first_run, last_run",
-                                          ctable);
-    TString ins_query_2 = TString::Format(" VALUES ( '%s', '%s', %d, %d",
-                                          calibration, desc, first_run, last_run);
-
-    // read all parameters and update the partial queries
-    for (Int_t j = 0; j < length; j++)
+    // invalidate the set indices
+    TList cleared;
+    cleared.SetOwner(kTRUE);
+    next.Reset();
+    while ((c = (TCCalibration*)next()))
     {
-        // append parameter to query
-        ins_query_1.Append(TString::Format(", par_%03d", j));
-        ins_query_2.Append(TString::Format(", %.17g", par[j]));
+        TString key = TCSetIndex::BuildKey(c->GetCalibData(), c->GetCalibration());
+        if (cleared.FindObject(key.Data())) continue;
+        ClearSetIndex(c->GetCalibData(), c->GetCalibration());
+        cleared.Add(new TObjString(key.Data()));
     }
 
-    // finalize query
-    ins_query_1.Append(")");
-    ins_query_2.Append(")");
-    ins_query_1.Append(ins_query_2.Data());
-
-    // write data to database
-    Bool_t res = SendExec(ins_query_1.Data());
-
     // check result
     if (!res)
     {
-        if (!fSilence) Error("AddDataSet", "Could not add the set of '%s' for runs %d to %d!",
-                             d->GetTitle(), first_run, last_run);
+        if (!fSilence) Error("AddDataSets", "Could not add the %d set(s)!", sets->GetSize());
         return kFALSE;
     }
-    else
+
+    // user information
+    if (!fSilence)
     {
-        if (!fSilence) Info("AddDataSet", "Added set of '%s' for runs %d to %d",
-                            d->GetTitle(), first_run, last_run);
-        return kTRUE;
+        next.Reset();
+        while ((c = (TCCalibration*)next()))
+            Info("AddDataSets", "Added set of '%s' for runs %d to %d",
+                 GetCalibData(c->GetCalibData())->GetTitle(), c->GetFirstRun(), c->GetLastRun());
     }
+
+    return kTRUE;
 }
 
 //______________________________________________________________________________
@@ -2598,10 +4546,9 @@ Bool_t TCMySQLManager::AddSet(const Char_t* type, const Char_t* calibration, con
     // Create new sets for the calibration type 'type' with the calibration identifier
     // 'calibration' for the runs 'first_run' to 'last_run'. Use 'desc' as a
     // description. Set all parameters to the value 'par'.
+    // The sets of all calibration data are added in one transaction.
     // Return kFALSE when an error occurred, otherwise kTRUE.
 
-    Bool_t ret = kTRUE;
-
     // create and fill parameter array
     Double_t par_array[TCConfig::kMaxCrystal];
     for (Int_t i = 0; i < TCConfig::kMaxCrystal; i++) par_array[i] = par;
@@ -2614,16 +4561,25 @@ Bool_t TCMySQLManager::AddSet(const Char_t* type, const Char_t* calibration, con
     TList* data = t->GetData();
 
     // loop over calibration data of this calibration type
+    TList sets;
+    sets.SetOwner(kTRUE);
     TIter next(data);
     TCCalibData* d;
     while ((d = (TCCalibData*)next()))
     {
-        // add set
-        if (AddDataSet(d->GetName(), calibration, desc, first_run, last_run, par_array,
-                       d->GetSize())) ret = kFALSE;
+        // create set
+        TCCalibration* c = new TCCalibration();
+        c->SetCalibData(d->GetName());
+        c->SetCalibration(calibration);
+        c->SetDescription(desc ? desc : "");
+        c->SetFirstRun(first_run);
+        c->SetLastRun(last_run);
+        c->SetParameters(d->GetSize(), par_array);
+        sets.Add(c);
     }
 
-    return ret;
+    // add sets
+    return AddDataSets(&sets);
 }
 
 //______________________________________________________________________________
@@ -2666,6 +4622,9 @@ Bool_t TCMySQLManager::RemoveDataSet(const Char_t* data, const Char_t* calibrati
     // read from database
     Bool_t res = SendExec(query.Data());
 
+    // invalidate the set index and the set
+    ClearSetIndex(data, calibration, 1, &first_run);
+
     // check result
     if (!res)
     {
@@ -2954,73 +4913,183 @@ Bool_t TCMySQLManager::MergeDataSets(const Char_t* data, const Char_t* calibrati
 //______________________________________________________________________________
 Bool_t TCMySQLManager::ChangeRunBadScR(Int_t run, Int_t nbadscr, const Int_t* badscr, const Char_t* data)
 {
-    // ...
+    // Change the list of bad scaler reads for 'data' of the run 'run' to the
+    // 'nbadscr' bad scaler reads 'badscr' (c.f., 'ChangeRunsBadScR()').
+    // Returns kTRUE on success, kFALSE otherwise.
 
-    // get short name (only last part of calib data, e.g. 'Data.Run.BadScR.NaI' --> 'NaI')
-    data = strrchr(data, '.') + 1;
+    TCBadScRElement elem(run, nbadscr, badscr);
+    TCBadScRElement* p = &elem;
+
+    return ChangeRunsBadScR(1, &p, data);
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::GetRunBadScR(Int_t run, Int_t& nbadscr, Int_t*& badscr, const Char_t* data)
+{
+    // Returns a list bad scaler reads for 'data' of the run 'run'. If data is
+    // ommited all bad scaler read of the run are returned. The number of bad
+    // scaler reads is stored to 'nbadscr' and the array of bad scaler reads is
+    // stored to 'badscr'.
+    // If there are no bad scaler reads the NULL pointer for 'badscr' is
+    // returned.
+    // NOTE: The array has to be destroyed by the caller.
 
-    // read old values from database -------------------------------------------
+    // init return variables
+    nbadscr = 0;
+    badscr = 0;
 
-    // init return values
-    TCBadScRElement** badscr_data = 0;
-    Int_t ndata = 0;
+    // read the bad scaler reads
+    Int_t nscr;
+    TCBadScRElement* elem;
+    if (!GetRunsBadScR(1, &run, &nscr, &elem, data)) return kFALSE;
 
-    // read all data
-    if (!ReadAllBadScR(run, badscr_data, ndata)) return kFALSE;
+    // check whether the run was found
+    if (!elem)
+    {
+        if (!fSilence) Error("GetRunBadScR", "Could not find the bad scaler reads for run %d!", run);
+        return kFALSE;
+    }
 
+    // copy the bad scaler reads
+    nbadscr = elem->GetNBad();
+    if (nbadscr) badscr = new Int_t[nbadscr];
+    for (Int_t i = 0; i < nbadscr; i++)
+        badscr[i] = elem->GetBad()[i];
 
-    // change scaler reads in list --------------------------------------------
+    // clean up
+    delete elem;
 
-    // init flag
-    Bool_t isAdded = kFALSE;
+    return kTRUE;
+}
 
-    // loop over data
-    for (Int_t d = 0; d < ndata; d++)
-    {
-        // check whether names match
-        if (strcmp(badscr_data[d]->GetCalibData(), data) == 0)
-        {
-            // remove bad scaler reads
-            badscr_data[d]->RemBad();
+//______________________________________________________________________________
+Bool_t TCMySQLManager::ReadAllBadScR(Int_t run, TCBadScRElement**& badscr_data, Int_t& ndata)
+{
+    // Reads the all bad scaler read of the run 'run'. The number of data found
+    // is stored to 'ndata'. The bad scaler reads of each data is stored to a
+    // bad scaler read element
+    // an array of pointers to bad scaler read elements
+    // If the NULL
+    // Returns kTRUE if the database readout was successful, kFALSE otherwise.
+    // NOTE: The array has to be destroyed by the caller.
 
-            // add new bad scaler reads
-            badscr_data[d]->AddBad(nbadscr, badscr);
+    // init result variables
+    ndata = 0;
+    badscr_data = 0;
 
-            // set flag
-            isAdded = kTRUE;
-        }
-    }
+    // init query return string
+    TString tmp;
+
+    // get run entry
+    if (!SearchRunEntry(run, "scr_bad", tmp)) return kFALSE;
+
+    // parse the bad scaler reads
+    ParseAllBadScR((Char_t*)tmp.Data(), badscr_data, ndata);
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+void TCMySQLManager::ParseAllBadScR(Char_t* str, TCBadScRElement**& badscr_data, Int_t& ndata)
+{
+    // Parses the bad scaler read string 'str' of a run (e.g.,
+    // "NaI:1,2,5-9;PID:3"). The number of data found is stored to 'ndata'. The
+    // bad scaler reads of each data is stored to a bad scaler read element of
+    // the array 'badscr_data'.
+    // NOTE: 'str' is modified. The array has to be destroyed by the caller.
+
+    // init result variables
+    ndata = 0;
+    badscr_data = 0;
 
-    // check whether it was added already (if not append a new element)
-    if (!isAdded)
+    // pointers to data tokens
+    Char_t** data = 0;
+
+    // get token for first data (e.g., "NaI:1,2,5-9\0")
+    Char_t* datatok = strtok(str, ";");
+
+    // loop over data tokens
+    while (datatok)
     {
-        // create new array
-        TCBadScRElement** badscr_data_tmp = new TCBadScRElement*[ndata+1];
+        // create new pointer array
+        Char_t** data_tmp = new Char_t*[ndata + 1];
 
         // copy old pointers
         for (Int_t i = 0; i < ndata; i++)
-            badscr_data_tmp[i] = badscr_data[i];
-
-        // delete old array
-        delete [] badscr_data;
+            data_tmp[i] = data[i];
 
-        // set pointer
-        badscr_data = badscr_data_tmp;
+        // delete old pointer array
+        delete [] data;
 
-        // append the new data (do not need to set totnscr)
-        badscr_data[ndata] = new TCBadScRElement(run, nbadscr, badscr);
+        // set pointer array to new pointer array
+        data = data_tmp;
 
-        // set name
-        badscr_data[ndata]->SetCalibData(data);
+        // add new pointer
+        data[ndata] = datatok;
 
-        // increment number of data
+        // increment data counter
         ndata++;
+
+        // get next data token
+        datatok = strtok(0, ";");
     }
 
+    // create bad scaler read element array
+    if (ndata) badscr_data = new TCBadScRElement*[ndata];
 
-    // create query string -------------------------------------------------------
+    // loop over data
+    for (Int_t i = 0; i < ndata; i++)
+    {
+        // create new element
+        badscr_data[i] = new TCBadScRElement();
 
-    // init query string
+        // get data name (e.g., "NaI\0")
+        Char_t* name = strtok(data[i], ":");
+
+        // set name
+        badscr_data[i]->SetCalibData(name);
+
+        // get first bad scr token (e.g., "1\0")
+        Char_t* bad = strtok(0, ",");
+
+        // loop over bad scr
+        while (bad)
+        {
+            // detect series ('-' separated, e.g. "5-9\0")
+            Char_t* loc = strchr(bad, (Int_t) '-');
+
+            // check for series
+            if (!loc)
+            {
+                // add single bad scr
+                badscr_data[i]->AddBad(atoi(bad));
+            }
+            else
+            {
+                // get start value of series
+                Int_t min = atoi(bad);
+
+                // get stop value of series
+                Int_t max = atoi(&loc[1]);
+
+                // add series of bad scr
+                for (Int_t j = min; j <= max; j++)
+                    badscr_data[i]->AddBad(j);
+            }
+
+            // get next bad scr
+            bad = strtok(0, ",");
+        }
+    }
+}
+
+//______________________________________________________________________________
+TString TCMySQLManager::FormatAllBadScR(TCBadScRElement* const* badscr_data, Int_t ndata)
+{
+    // Returns the bad scaler read string of a run (e.g., "NaI:1,2,5-9;PID:3;")
+    // of the 'ndata' bad scaler read elements 'badscr_data'.
+
+    // init string
     TString s = "";
 
     // loop over data
@@ -3037,7 +5106,7 @@ Bool_t TCMySQLManager::ChangeRunBadScR(Int_t run, Int_t nbadscr, const Int_t* ba
         // loop over input bad scaler reads list
         for (Int_t i = 0; i < nbadscr; i++)
         {
-            Char_t tmp[16];
+            Char_t tmp[32];
             Int_t j = 0;
 
             // loop over subsequent values in order to detect series, i.e., badscr[k]+1 == badscr[k+1]
@@ -3047,7 +5116,7 @@ Bool_t TCMySQLManager::ChangeRunBadScR(Int_t run, Int_t nbadscr, const Int_t* ba
             // check for series with more than 2 elements
             if (j > 1)
             {
-                // separate first and last value of series with ':'
+                // separate first and last value of series with '-'
                 sprintf(tmp, "%d-%d,", badscr[i], badscr[i+j]);
                 i += j;
             }
@@ -3057,196 +5126,501 @@ Bool_t TCMySQLManager::ChangeRunBadScR(Int_t run, Int_t nbadscr, const Int_t* ba
                 sprintf(tmp, "%d,", badscr[i]);
             }
 
-            // append to query string
+            // append to string
             s.Append(tmp);
         }
 
-        // remove tailing comma
+        // remove tailing comma (or colon)
         s.Chop();
 
         // append data delimiter
         s.Append(";");
     }
 
+    return s;
+}
 
-    // finish ------------------------------------------------------------------
+//______________________________________________________________________________
+Char_t* TCMySQLManager::PackBadScR(Int_t nbadscr, const Int_t* badscr, Int_t& outSize)
+{
+    // Returns the bitmap of the 'nbadscr' bad scaler reads 'badscr', where
+    // bit (i % 8) of byte (i / 8) is set if the scaler read i is bad. The size
+    // of the bitmap in bytes is stored to 'outSize'.
+    // NOTE: The bitmap has to be destroyed by the caller.
 
-    // clean up
-    for (Int_t i = 0; i < ndata; i++)
-        delete badscr_data[i];
-    delete [] badscr_data;
+    // get the size of the bitmap
+    Int_t max = -1;
+    for (Int_t i = 0; i < nbadscr; i++)
+        if (badscr[i] > max) max = badscr[i];
+    outSize = max / 8 + 1;
 
-    // change list of bad scaler reads
-    return ChangeRunEntries(run, run, "scr_bad", s.Data());
+    // set the bits
+    Char_t* buffer = new Char_t[outSize];
+    memset(buffer, 0, outSize);
+    for (Int_t i = 0; i < nbadscr; i++)
+        if (badscr[i] >= 0) buffer[badscr[i] / 8] |= (Char_t) (1 << (badscr[i] % 8));
+
+    return buffer;
 }
 
 //______________________________________________________________________________
-Bool_t TCMySQLManager::GetRunBadScR(Int_t run, Int_t& nbadscr, Int_t*& badscr, const Char_t* data)
+void TCMySQLManager::UnpackBadScR(const Char_t* buffer, Int_t size, TCBadScRElement* outBadScR)
 {
-    // Returns a list bad scaler reads for 'data' of the run 'run'. If data is
-    // ommited all bad scaler read of the run are returned. The number of bad
-    // scaler reads is stored to 'nbadscr' and the array of bad scaler reads is
-    // stored to 'badscr'.
-    // If there is no list of bad scaler reads for 'data' the NULL pointer for
-    // 'badscr' is returnd.
-    // NOTE: The array has to be destroyed by the caller.
+    // Adds the bad scaler reads of the bitmap 'buffer' of 'size' bytes (c.f.,
+    // 'PackBadScR()') to the element 'outBadScR'.
 
-    // get short name (only last part of calib data, e.g. 'Data.Run.BadScR.NaI' --> 'NaI')
-    data = strrchr(data, '.') + 1;
+    // collect the set bits
+    Int_t nbadscr = 0;
+    Int_t* badscr = new Int_t[size*8];
+    for (Int_t i = 0; i < size*8; i++)
+        if (buffer[i / 8] & (1 << (i % 8))) badscr[nbadscr++] = i;
 
-    // declare temporary bad scr element
-    TCBadScRElement* badscr_tmp = 0;
+    // add the bad scaler reads
+    if (nbadscr) outBadScR->AddBad(nbadscr, badscr);
 
-    // init return variables
-    nbadscr = 0;
-    badscr = 0;
+    // clean up
+    delete [] badscr;
+}
+
+//______________________________________________________________________________
+void TCMySQLManager::DetectBadScRStorage()
+{
+    // Detect whether the bad scaler reads are stored in the bad scaler read
+    // table (database version 7) or only as strings in the main table.
 
-    // init variables for database read call
-    TCBadScRElement** badscr_data = 0;
-    Int_t ndata = 0;
+    // check server connection
+    if (!IsConnected()) return;
 
-    // read bad scr for all data
-    if (!ReadAllBadScR(run, badscr_data, ndata)) return kFALSE;
+    // probe the bad scaler read table (suppress error output)
+    TSQLServer* db = GetConnection();
+    Bool_t errOut = db->IsErrorOutputEnabled();
+    db->EnableErrorOutput(kFALSE);
+    TSQLResult* res = SendQuery(TString::Format("SELECT run FROM %s LIMIT 1",
+                                                TCConfig::kBadScRTableName).Data());
+    db->EnableErrorOutput(errOut);
 
-    // loop over data
-    for (Int_t d = 0; d < ndata; d++)
+    // set the storage mode
+    fBadScRTable = res ? kTRUE : kFALSE;
+
+    // clean-up
+    if (res) delete res;
+}
+
+//______________________________________________________________________________
+void TCMySQLManager::CreateBadScRTable()
+{
+    // Create the bad scaler read table if it does not exist yet.
+
+    // user information
+    if (!fSilence) Info("CreateBadScRTable", "Creating bad scaler read table");
+
+    // create the table
+    fBadScRTable = SendExec(TString::Format("CREATE TABLE IF NOT EXISTS %s ( %s )",
+                                            TCConfig::kBadScRTableName, TCConfig::kBadScRTableFormat).Data());
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::MigrateBadScR(Int_t first_run, Int_t last_run)
+{
+    // Copy the bad scaler reads of the runs 'first_run' to 'last_run' from the
+    // strings of the main table to the bad scaler read table in one
+    // transaction. The old rows of these runs are replaced, the strings are
+    // kept. Returns kTRUE on success, kFALSE otherwise.
+
+    // read the strings of the runs
+    TSQLStatement* stmt = PrepareStatement(TString::Format("SELECT run, scr_bad FROM %s "
+                                                           "WHERE scr_bad IS NOT NULL AND run >= ? AND run <= ?",
+                                                           TCConfig::kCalibMainTableName).Data());
+    if (!stmt) return kFALSE;
+    if (!stmt->NextIteration() || !stmt->SetInt(0, first_run) || !stmt->SetInt(1, last_run) ||
+        !stmt->Process() || !stmt->StoreResult())
+    {
+        delete stmt;
+        return kFALSE;
+    }
+
+    // parse the strings
+    std::vector<TCBadScRElement*> elems;
+    while (stmt->NextResultRow())
     {
-        // check whether names match
-        if (!data || strcmp(badscr_data[d]->GetCalibData(), data) == 0)
+        Int_t run = stmt->GetInt(0);
+        TString tmp = stmt->GetString(1);
+        TCBadScRElement** badscr_data = 0;
+        Int_t ndata = 0;
+        ParseAllBadScR((Char_t*)tmp.Data(), badscr_data, ndata);
+        for (Int_t d = 0; d < ndata; d++)
         {
-            // create bad scr element
-            if (!badscr_tmp) badscr_tmp = new TCBadScRElement();
-
-            // add bad scr
-            badscr_tmp->AddBad(badscr_data[d]->GetNBad(), badscr_data[d]->GetBad());
+            badscr_data[d]->SetRunNumber(run);
+            elems.push_back(badscr_data[d]);
         }
+        if (badscr_data) delete [] badscr_data;
+    }
+    delete stmt;
 
-        // clean up
-        delete badscr_data[d];
+    // begin the transaction
+    Bool_t res = BeginTransaction();
+    Bool_t trans = res;
+
+    // delete the old rows
+    stmt = res ? PrepareStatement(TString::Format("DELETE FROM %s WHERE run >= ? AND run <= ?",
+                                                  TCConfig::kBadScRTableName).Data()) : 0;
+    res = stmt && stmt->NextIteration() && stmt->SetInt(0, first_run) && stmt->SetInt(1, last_run) &&
+          stmt->Process();
+    if (stmt) delete stmt;
+
+    // write all elements
+    stmt = res ? PrepareStatement(TString::Format("INSERT INTO %s (run, data, nbad, bitmap) VALUES (?, ?, ?, ?)",
+                                                  TCConfig::kBadScRTableName).Data()) : 0;
+    res = stmt != 0;
+    for (UInt_t i = 0; res && i < elems.size(); i++)
+    {
+        TCBadScRElement* e = elems[i];
+        Int_t size;
+        Char_t* buffer = PackBadScR(e->GetNBad(), e->GetBad(), size);
+        res = stmt->NextIteration() && stmt->SetInt(0, e->GetRunNumber()) &&
+              stmt->SetString(1, e->GetCalibData()) && stmt->SetInt(2, e->GetNBad()) &&
+              stmt->SetBinary(3, buffer, size, size);
+        delete [] buffer;
     }
+    if (res && elems.size()) res = stmt->Process();
+    if (stmt) delete stmt;
+
+    // commit or roll back
+    if (trans)
+    {
+        if (res) res = CommitTransaction();
+        else RollbackTransaction();
+    }
+
+    // user information
+    if (res && !fSilence) Info("MigrateBadScR", "Copied %d bad scaler read lists to the table '%s'",
+                               (Int_t) elems.size(), TCConfig::kBadScRTableName);
 
     // clean up
-    delete [] badscr_data;
+    for (UInt_t i = 0; i < elems.size(); i++) delete elems[i];
+
+    return res;
+}
+
+//______________________________________________________________________________
+Bool_t TCMySQLManager::ReadBadScRStrings(Int_t nRuns, const Int_t* sorted, Int_t* outNScR, TString* outStr)
+{
+    // Reads the number of scaler reads and the bad scaler read strings of the
+    // 'nRuns' runs in the sorted array 'sorted' from the main table with one
+    // query to 'outNScR' and 'outStr'. The number of scaler reads of runs that
+    // were not found is set to -2.
+    // Returns kTRUE if the database readout was successful, kFALSE otherwise.
 
-    // check whether data was found
-    if (badscr_tmp)
+    // init result variables
+    for (Int_t i = 0; i < nRuns; i++)
     {
-        // set number of bad scaler reads
-        nbadscr = badscr_tmp->GetNBad();
+        outNScR[i] = -2;
+        outStr[i] = "";
+    }
+    if (nRuns <= 0) return kTRUE;
 
-        // create array of bad scaler reads
-        if (nbadscr) badscr = new Int_t[nbadscr];
+    // prepare the statement
+    TSQLStatement* stmt = PrepareStatement(TString::Format("SELECT run, scr_n, scr_bad FROM %s "
+                                                           "WHERE run >= ? AND run <= ?",
+                                                           TCConfig::kCalibMainTableName).Data());
+    if (!stmt) return kFALSE;
 
-        // copy values
-        for (Int_t i = 0; i < nbadscr; i++)
-            badscr[i] = badscr_tmp->GetBad()[i];
+    // bind the run range and read from database
+    if (!stmt->NextIteration() || !stmt->SetInt(0, sorted[0]) || !stmt->SetInt(1, sorted[nRuns-1]) ||
+        !stmt->Process() || !stmt->StoreResult())
+    {
+        if (!fSilence) Error("ReadBadScRStrings", "Could not read the bad scaler reads of runs %d to %d!",
+                                                  sorted[0], sorted[nRuns-1]);
+        delete stmt;
+        return kFALSE;
+    }
 
-        // clean up
-        delete badscr_tmp;
+    // loop over the rows
+    while (stmt->NextResultRow())
+    {
+        // look up the run
+        Int_t run = stmt->GetInt(0);
+        Long64_t k = TMath::BinarySearch((Long64_t) nRuns, sorted, run);
+        if (k < 0 || sorted[k] != run) continue;
+
+        // set the values
+        outNScR[k] = stmt->IsNull(1) ? 0 : atoi(stmt->GetString(1));
+        if (!stmt->IsNull(2)) outStr[k] = stmt->GetString(2);
     }
 
+    // clean-up
+    delete stmt;
+
     return kTRUE;
 }
 
 //______________________________________________________________________________
-Bool_t TCMySQLManager::ReadAllBadScR(Int_t run, TCBadScRElement**& badscr_data, Int_t& ndata)
+Bool_t TCMySQLManager::GetRunsBadScR(Int_t nRuns, const Int_t* runs, Int_t* outNScR,
+                                     TCBadScRElement** outBadScR, const Char_t* data)
 {
-    // Reads the all bad scaler read of the run 'run'. The number of data found
-    // is stored to 'ndata'. The bad scaler reads of each data is stored to a
-    // bad scaler read element
-    // an array of pointers to bad scaler read elements
-    // If the NULL
+    // Reads the number of scaler reads and the bad scaler reads for 'data' of
+    // the 'nRuns' runs 'runs' with a single query per table. The number of
+    // scaler reads of the i-th run is stored to 'outNScR[i]' (-2 if the run
+    // was not found) and its bad scaler reads to the element 'outBadScR[i]'
+    // (0 if the run was not found). If data is ommited all bad scaler reads of
+    // the runs are returned (c.f., 'GetRunNScR()' and 'GetRunBadScR()').
+    // The bad scaler reads are taken from the bad scaler read table if it
+    // exists and contains them, otherwise from the strings of the main table.
     // Returns kTRUE if the database readout was successful, kFALSE otherwise.
-    // NOTE: The array has to be destroyed by the caller.
+    // NOTE: The elements have to be destroyed by the caller.
 
     // init result variables
-    ndata = 0;
-    badscr_data = 0;
+    for (Int_t i = 0; i < nRuns; i++)
+    {
+        outNScR[i] = -2;
+        outBadScR[i] = 0;
+    }
+    if (nRuns <= 0) return kTRUE;
 
-    // init query return string
-    TString tmp;
+    // get short name (only last part of calib data, e.g. 'Data.Run.BadScR.NaI' --> 'NaI')
+    if (data && strrchr(data, '.')) data = strrchr(data, '.') + 1;
+
+    // sort the runs for the look-up
+    Int_t index[nRuns];
+    Int_t sorted[nRuns];
+    TMath::Sort(nRuns, runs, index, kFALSE);
+    for (Int_t i = 0; i < nRuns; i++) sorted[i] = runs[index[i]];
+
+    // read the number of scaler reads and the strings
+    Int_t* nscr = new Int_t[nRuns];
+    TString* str = new TString[nRuns];
+    Bool_t res = ReadBadScRStrings(nRuns, sorted, nscr, str);
+
+    // read the bad scaler read table
+    Bool_t* inTable = new Bool_t[nRuns];
+    for (Int_t k = 0; k < nRuns; k++) inTable[k] = kFALSE;
+    if (res && fBadScRTable)
+    {
+        // prepare the statement
+        TString sql = TString::Format("SELECT run, bitmap FROM %s WHERE run >= ? AND run <= ?",
+                                      TCConfig::kBadScRTableName);
+        if (data) sql.Append(" AND data = ?");
+        TSQLStatement* stmt = PrepareStatement(sql.Data());
+
+        // bind the run range and read from database
+        res = stmt && stmt->NextIteration() && stmt->SetInt(0, sorted[0]) && stmt->SetInt(1, sorted[nRuns-1]) &&
+              (!data || stmt->SetString(2, data)) && stmt->Process() && stmt->StoreResult();
+
+        // loop over the rows
+        while (res && stmt->NextResultRow())
+        {
+            // look up the run
+            Int_t run = stmt->GetInt(0);
+            Long64_t k = TMath::BinarySearch((Long64_t) nRuns, sorted, run);
+            if (k < 0 || sorted[k] != run || nscr[k] == -2) continue;
+            Int_t i = index[k];
+
+            // add the bad scaler reads
+            if (!outBadScR[i]) outBadScR[i] = new TCBadScRElement(run);
+            void* buffer = 0;
+            Long_t size = 0;
+            if (!stmt->IsNull(1) && stmt->GetBinary(1, buffer, size))
+                UnpackBadScR((const Char_t*) buffer, (Int_t) size, outBadScR[i]);
+            inTable[k] = kTRUE;
+        }
 
-    // get run entry
-    if (!SearchRunEntry(run, "scr_bad", tmp)) return kFALSE;
+        // clean-up
+        if (stmt) delete stmt;
+        if (!res && !fSilence) Error("GetRunsBadScR", "Could not read the bad scaler reads of runs %d to %d!",
+                                                      sorted[0], sorted[nRuns-1]);
+    }
 
-    // pointers to data tokens
-    Char_t** data = 0;
+    // set the remaining runs from the strings
+    for (Int_t k = 0; res && k < nRuns; k++)
+    {
+        Int_t i = index[k];
 
-    // get token for first data (e.g., "NaI:1,2,5-9\0")
-    Char_t* datatok = strtok((Char_t*)tmp.Data(), ";");
+        // check run
+        outNScR[i] = nscr[k];
+        if (nscr[k] == -2 || inTable[k]) continue;
 
-    // loop over data tokens
-    while (datatok)
-    {
-        // create new pointer array
-        Char_t** data_tmp = new Char_t*[ndata + 1];
+        // parse the bad scaler reads of all data
+        TCBadScRElement** badscr_data = 0;
+        Int_t ndata = 0;
+        ParseAllBadScR((Char_t*)str[k].Data(), badscr_data, ndata);
 
-        // copy old pointers
-        for (Int_t i = 0; i < ndata; i++)
-            data_tmp[i] = data[i];
+        // add the bad scaler reads of the matching data
+        outBadScR[i] = new TCBadScRElement(sorted[k]);
+        for (Int_t d = 0; d < ndata; d++)
+        {
+            if (!data || strcmp(badscr_data[d]->GetCalibData(), data) == 0)
+                outBadScR[i]->AddBad(badscr_data[d]->GetNBad(), badscr_data[d]->GetBad());
+            delete badscr_data[d];
+        }
+        if (badscr_data) delete [] badscr_data;
+    }
 
-        // delete old pointer array
-        delete [] data;
+    // clean up
+    delete [] nscr;
+    delete [] str;
+    delete [] inTable;
 
-        // set pointer array to new pointer array
-        data = data_tmp;
+    // delete partial results
+    if (!res)
+    {
+        for (Int_t i = 0; i < nRuns; i++)
+        {
+            if (outBadScR[i]) delete outBadScR[i];
+            outBadScR[i] = 0;
+            outNScR[i] = -2;
+        }
+    }
 
-        // add new pointer
-        data[ndata] = datatok;
+    return res;
+}
 
-        // increment data counter
-        ndata++;
+//______________________________________________________________________________
+Bool_t TCMySQLManager::ChangeRunsBadScR(Int_t nRuns, TCBadScRElement* const* badscr, const Char_t* data)
+{
+    // Change the lists of bad scaler reads for 'data' of the 'nRuns' runs of
+    // the elements 'badscr' to the bad scaler reads of the elements.
+    // All runs are written in one transaction. The strings of the main table
+    // are always updated to stay compatible with older versions and with
+    // exports, the bad scaler read table is updated if it exists.
+    // Returns kTRUE on success, kFALSE otherwise.
 
-        // get next data token
-        datatok = strtok(0, ";");
+    // check data
+    if (!data)
+    {
+        if (!fSilence) Error("ChangeRunsBadScR", "No calibration data given!");
+        return kFALSE;
     }
+    if (nRuns <= 0) return kTRUE;
 
-    // create bad scaler read element array
-    if (ndata) badscr_data = new TCBadScRElement*[ndata];
+    // get short name (only last part of calib data, e.g. 'Data.Run.BadScR.NaI' --> 'NaI')
+    if (strrchr(data, '.')) data = strrchr(data, '.') + 1;
 
-    // loop over data
-    for (Int_t i = 0; i < ndata; i++)
+    // sort the runs for the look-up
+    Int_t runs[nRuns];
+    Int_t index[nRuns];
+    Int_t sorted[nRuns];
+    for (Int_t i = 0; i < nRuns; i++) runs[i] = badscr[i]->GetRunNumber();
+    TMath::Sort(nRuns, runs, index, kFALSE);
+    for (Int_t i = 0; i < nRuns; i++) sorted[i] = runs[index[i]];
+
+    // read the old strings
+    Int_t* nscr = new Int_t[nRuns];
+    TString* str = new TString[nRuns];
+    Bool_t res = ReadBadScRStrings(nRuns, sorted, nscr, str);
+
+    // check runs
+    for (Int_t k = 0; res && k < nRuns; k++)
     {
-        // create new element
-        badscr_data[i] = new TCBadScRElement();
+        if (nscr[k] == -2)
+        {
+            if (!fSilence) Error("ChangeRunsBadScR", "Run %d was not found!", sorted[k]);
+            res = kFALSE;
+        }
+    }
 
-        // get data name (e.g., "NaI\0")
-        Char_t* name = strtok(data[i], ":");
+    // begin the transaction
+    Bool_t trans = kFALSE;
+    if (res) res = trans = BeginTransaction();
 
-        // set name
-        badscr_data[i]->SetCalibData(name);
+    // update the strings
+    TSQLStatement* stmt = 0;
+    if (res)
+    {
+        stmt = PrepareStatement(TString::Format("UPDATE %s SET scr_bad = ? WHERE run = ?",
+                                                TCConfig::kCalibMainTableName).Data());
+        res = stmt != 0;
+    }
+    for (Int_t k = 0; res && k < nRuns; k++)
+    {
+        TCBadScRElement* e = badscr[index[k]];
 
-        // get first bad scr token (e.g., "1\0")
-        Char_t* bad = strtok(0, ",");
+        // parse the bad scaler reads of all data
+        TCBadScRElement** badscr_data = 0;
+        Int_t ndata = 0;
+        ParseAllBadScR((Char_t*)str[k].Data(), badscr_data, ndata);
 
-        // loop over bad scr
-        while (bad)
+        // replace the bad scaler reads of the data
+        TCBadScRElement** all = new TCBadScRElement*[ndata+1];
+        Int_t nall = 0;
+        Bool_t isAdded = kFALSE;
+        for (Int_t d = 0; d < ndata; d++)
         {
-            // detect series ('-' separated, e.g. "5-9\0")
-            Char_t* loc = strchr(bad, (Int_t) '-');
-
-            // check for series
-            if (!loc)
+            if (strcmp(badscr_data[d]->GetCalibData(), data) == 0)
             {
-                // add single bad scr
-                badscr_data[i]->AddBad(atoi(bad));
+                badscr_data[d]->RemBad();
+                badscr_data[d]->AddBad(e->GetNBad(), e->GetBad());
+                isAdded = kTRUE;
             }
-            else
-            {
-                // get start value of series
-                Int_t min = atoi(bad);
+            all[nall++] = badscr_data[d];
+        }
 
-                // get stop value of series
-                Int_t max = atoi(&loc[1]);
+        // append the data if it was not found
+        TCBadScRElement added(e->GetRunNumber(), e->GetNBad(), e->GetBad());
+        added.SetCalibData(data);
+        if (!isAdded) all[nall++] = &added;
 
-                // add series of bad scr
-                for (Int_t j = min; j <= max; j++)
-                    badscr_data[i]->AddBad(j);
-            }
+        // bind the new string
+        TString s = FormatAllBadScR(all, nall);
+        res = stmt->NextIteration() &&
+              stmt->SetString(0, s.Data(), TMath::Max(256, s.Length() + 1)) &&
+              stmt->SetInt(1, e->GetRunNumber());
 
-            // get next bad scr
-            bad = strtok(0, ",");
+        // clean up
+        for (Int_t d = 0; d < ndata; d++) delete badscr_data[d];
+        if (badscr_data) delete [] badscr_data;
+        delete [] all;
+    }
+    if (res) res = stmt->Process();
+    if (stmt) delete stmt;
+    stmt = 0;
+
+    // update the bad scaler read table
+    if (res && fBadScRTable)
+    {
+        // delete the old bitmaps
+        stmt = PrepareStatement(TString::Format("DELETE FROM %s WHERE run = ? AND data = ?",
+                                                TCConfig::kBadScRTableName).Data());
+        res = stmt != 0;
+        for (Int_t i = 0; res && i < nRuns; i++)
+            res = stmt->NextIteration() && stmt->SetInt(0, badscr[i]->GetRunNumber()) &&
+                  stmt->SetString(1, data);
+        if (res) res = stmt->Process();
+        if (stmt) delete stmt;
+
+        // insert the new bitmaps
+        stmt = res ? PrepareStatement(TString::Format("INSERT INTO %s (run, data, nbad, bitmap) VALUES (?, ?, ?, ?)",
+                                                      TCConfig::kBadScRTableName).Data()) : 0;
+        res = stmt != 0;
+        for (Int_t i = 0; res && i < nRuns; i++)
+        {
+            Int_t size;
+            Char_t* buffer = PackBadScR(badscr[i]->GetNBad(), badscr[i]->GetBad(), size);
+            res = stmt->NextIteration() && stmt->SetInt(0, badscr[i]->GetRunNumber()) &&
+                  stmt->SetString(1, data) && stmt->SetInt(2, badscr[i]->GetNBad()) &&
+                  stmt->SetBinary(3, buffer, size, size);
+            delete [] buffer;
         }
+        if (res) res = stmt->Process();
+        if (stmt) delete stmt;
+    }
+
+    // commit or roll back
+    if (trans)
+    {
+        if (res) res = CommitTransaction();
+        else RollbackTransaction();
+    }
+
+    // clean up
+    delete [] nscr;
+    delete [] str;
+
+    // check result
+    if (!res)
+    {
+        if (!fSilence) Error("ChangeRunsBadScR", "Could not write the bad scaler reads of '%s' for %d runs!",
+                             data, nRuns);
+        return kFALSE;
     }
 
     return kTRUE;
@@ -3284,113 +5658,145 @@ Bool_t TCMySQLManager::MergeSets(const Char_t* type, const Char_t* calibration,
 }
 
 //______________________________________________________________________________
-Int_t TCMySQLManager::DumpRuns(TCContainer* container, Int_t first_run, Int_t last_run)
+TSQLStatement* TCMySQLManager::QueryRuns(Int_t first_run, Int_t last_run)
 {
-    // Dump the run information from run 'first_run' to run 'last_run' to
-    // the CaLib container 'container'.
-    // If first_run and last_run is zero all available runs will be dumped.
-    // Return the number of dumped runs.
+    // Query all run information from run 'first_run' to run 'last_run' ordered
+    // by the run number using a single statement (see FillRun() for the columns).
+    // If first_run and last_run is zero all available runs will be selected.
+    // Return the processed statement or 0 if an error occurred.
+    // NOTE: The statement must be destroyed by the caller.
 
-    TString query;
-    TString tmp;
+    Bool_t range = first_run || last_run;
 
     // create the query
-    if (!first_run && !last_run)
-    {
-        query.Form("SELECT run FROM %s "
-                   "ORDER by run",
-                   TCConfig::kCalibMainTableName);
-    }
-    else
-    {
-        query.Form("SELECT run FROM %s "
-                   "WHERE run >= %d "
-                   "AND run <= %d "
-                   "ORDER by run",
-                   TCConfig::kCalibMainTableName, first_run, last_run);
-    }
-
-    // read from database
-    TSQLResult* res = SendQuery(query.Data());
+    TString query = TString::Format("SELECT run, path, filename, time, description, run_note, size, scr_n, scr_bad, "
+                                    "target, target_pol, target_pol_deg, beam_pol, beam_pol_deg FROM %s",
+                                    TCConfig::kCalibMainTableName);
+    if (range) query.Append(" WHERE run >= ? AND run <= ?");
+    query.Append(" ORDER by run");
 
-    // create list for run numbers
-    TList run_numbers;
-    run_numbers.SetOwner(kTRUE);
+    // prepare the statement
+    TSQLStatement* stmt = PrepareStatement(query.Data());
+    if (!stmt) return 0;
 
-    // read all rows/runs
-    TSQLRow* r = res->Next();
-    while (r)
-    {
-        run_numbers.Add(new TObjString(r->GetField(0)));
-        delete r;
-        r = res->Next();
-    }
+    // bind the run range
+    Bool_t res = kTRUE;
+    if (range) res = stmt->NextIteration() && stmt->SetInt(0, first_run) && stmt->SetInt(1, last_run);
 
-    // get number of runs
-    Int_t nruns = run_numbers.GetSize();
+    // read from database
+    if (res) res = stmt->Process() && stmt->StoreResult();
 
-    // loop over runs
-    for (Int_t i = 0; i < nruns; i++)
+    // check result
+    if (!res)
     {
-        // get next run
-        TObjString* rn = (TObjString*) run_numbers.At(i);
-
-        // get run number
-        Int_t run_number = atoi(rn->GetString().Data());
+        delete stmt;
+        return 0;
+    }
 
-        // add new run
-        TCRun* run = container->AddRun(run_number);
+    return stmt;
+}
 
-        // set path
-        if (SearchRunEntry(run_number, "path", tmp)) run->SetPath(tmp.Data());
+//______________________________________________________________________________
+void TCMySQLManager::FillRun(TCRun* run, TSQLStatement* stmt)
+{
+    // Set the run information of 'run' using the current result row of the
+    // statement 'stmt' obtained by QueryRuns(). NULL fields are treated as
+    // empty strings.
+
+    const Char_t* f[14];
+    for (Int_t i = 0; i < 14; i++) f[i] = stmt->IsNull(i) ? "" : stmt->GetString(i);
+
+    run->SetRun(stmt->GetInt(0));
+    run->SetPath(f[1]);
+    run->SetFileName(f[2]);
+    run->SetTime(f[3]);
+    run->SetDescription(f[4]);
+    run->SetRunNote(f[5]);
+    run->SetSize(stmt->GetLong64(6));
+    run->SetNScalerReads(stmt->GetInt(7));
+    run->SetBadScalerReads(f[8]);
+    run->SetTarget(f[9]);
+    run->SetTargetPol(f[10]);
+    run->SetTargetPolDeg(stmt->GetDouble(11));
+    run->SetBeamPol(f[12]);
+    run->SetBeamPolDeg(stmt->GetDouble(13));
+}
 
-        // set filename
-        if (SearchRunEntry(run_number, "filename", tmp)) run->SetFileName(tmp.Data());
+//______________________________________________________________________________
+Int_t TCMySQLManager::DumpRuns(TCContainer* container, Int_t first_run, Int_t last_run)
+{
+    // Dump the run information from run 'first_run' to run 'last_run' to
+    // the CaLib container 'container'.
+    // If first_run and last_run is zero all available runs will be dumped.
+    // Return the number of dumped runs.
 
-        // set time
-        if (SearchRunEntry(run_number, "time", tmp)) run->SetTime(tmp.Data());
+    // read from database
+    TSQLStatement* stmt = QueryRuns(first_run, last_run);
 
-        // set description
-        if (SearchRunEntry(run_number, "description", tmp)) run->SetDescription(tmp.Data());
+    // check result
+    if (!stmt)
+    {
+        if (!fSilence) Error("DumpRuns", "Could not read the runs!");
+        return 0;
+    }
 
-        // set run_note
-        if (SearchRunEntry(run_number, "run_note", tmp)) run->SetRunNote(tmp.Data());
+    // read all rows/runs
+    Int_t nruns = 0;
+    while (stmt->NextResultRow())
+    {
+        // add new run
+        TCRun* run = container->AddRun(0);
 
-        // set size
-        if (SearchRunEntry(run_number, "size", tmp))
-        {
-            Long64_t size;
-            sscanf(tmp.Data(), "%lld", &size);
-            run->SetSize(size);
-        }
+        // set run information
+        FillRun(run, stmt);
+        nruns++;
 
-        // set scaler reads
-        if (SearchRunEntry(run_number, "scr_n", tmp)) run->SetNScalerReads(atoi(tmp.Data()));
+        // user information
+        if (!fSilence) Info("DumpRuns", "Dumped run %d", run->GetRun());
+    }
 
-        // set bad scaler reads
-        if (SearchRunEntry(run_number, "scr_bad", tmp)) run->SetBadScalerReads(tmp.Data());
+    // clean-up
+    delete stmt;
 
-        // set target
-        if (SearchRunEntry(run_number, "target", tmp)) run->SetTarget(tmp.Data());
+    return nruns;
+}
 
-        // set target polarization
-        if (SearchRunEntry(run_number, "target_pol", tmp)) run->SetTargetPol(tmp.Data());
+//______________________________________________________________________________
+Int_t TCMySQLManager::ForEachRun(RunHandler_t handler, void* arg, Int_t first_run, Int_t last_run)
+{
+    // Call the function 'handler' for every run from run 'first_run' to run
+    // 'last_run' passing the run information and the user argument 'arg'.
+    // The runs are streamed from a single query and the run object is reused,
+    // i.e. it is only valid during the call of 'handler'.
+    // If first_run and last_run is zero all available runs will be processed.
+    // Return the number of processed runs.
 
-        // set target polarization degree
-        if (SearchRunEntry(run_number, "target_pol_deg", tmp)) run->SetTargetPolDeg(atof(tmp.Data()));
+    // read from database
+    TSQLStatement* stmt = QueryRuns(first_run, last_run);
 
-        // set beam polarization
-        if (SearchRunEntry(run_number, "beam_pol", tmp)) run->SetBeamPol(tmp.Data());
+    // check result
+    if (!stmt)
+    {
+        if (!fSilence) Error("ForEachRun", "Could not read the runs!");
+        return 0;
+    }
 
-        // set beam polarization degree
-        if (SearchRunEntry(run_number, "beam_pol_deg", tmp)) run->SetBeamPolDeg(atof(tmp.Data()));
+    // run object (large, hence not on the stack)
+    TCRun* run = new TCRun();
 
-        // user information
-        if (!fSilence) Info("DumpRuns", "Dumped run %d", run_number);
+    // loop over rows/runs
+    Int_t nruns = 0;
+    while (stmt->NextResultRow())
+    {
+        // set run information and call handler
+        FillRun(run, stmt);
+        handler(run, arg);
+        nruns++;
     }
 
     // clean-up
-    delete res;
+    delete run;
+    delete stmt;
 
     return nruns;
 }
@@ -3403,8 +5809,6 @@ Int_t TCMySQLManager::DumpCalibrations(TCContainer* container, const Char_t* cal
     // identifier 'calibration' to the CaLib container 'container'.
     // Return the number of dumped calibrations.
 
-    Char_t tmp[256];
-
     // get data
     TCCalibData* d = GetCalibData(data);
     if (!d) return 0;
@@ -3412,26 +5816,24 @@ Int_t TCMySQLManager::DumpCalibrations(TCContainer* container, const Char_t* cal
     // get number of parameters
     Int_t nPar = d->GetSize();
 
-    // create the parameter array
-    Double_t par[nPar];
-
-    // get the number of sets
-    Int_t nSet = GetNsets(data, calibration);
+    // read all sets
+    TList* sets = ReadSets(d, calibration);
+    Int_t nSet = sets ? sets->GetSize() : 0;
 
     // check calibration
     if (!nSet)
     {
         if (!fSilence) Error("DumpCalibrations", "No sets of '%s' of the calibration '%s' found!",
                              d->GetTitle(), calibration);
+        if (sets) delete sets;
         return 0;
     }
 
     // loop over sets
-    for (Int_t i = 0; i < nSet; i++)
+    TIter next(sets);
+    TCCalibration* set;
+    while ((set = (TCCalibration*)next()))
     {
-        // read parameters
-        ReadParameters(data, calibration, i, par, nPar);
-
         // add the calibration
         TCCalibration* c = container->AddCalibration(calibration);
 
@@ -3439,21 +5841,22 @@ Int_t TCMySQLManager::DumpCalibrations(TCContainer* container, const Char_t* cal
         c->SetCalibData(data);
 
         // set description
-        GetDescriptionOfSet(data, calibration, i, tmp);
-        c->SetDescription(tmp);
+        c->SetDescription(set->GetDescription());
 
         // set first and last run
-        c->SetFirstRun(GetFirstRunOfSet(data, calibration, i));
-        c->SetLastRun(GetLastRunOfSet(data, calibration, i));
+        c->SetFirstRun(set->GetFirstRun());
+        c->SetLastRun(set->GetLastRun());
 
         // set fill time
-        GetChangeTimeOfSet(data, calibration, i, tmp);
-        c->SetChangeTime(tmp);
+        c->SetChangeTime(set->GetChangeTime());
 
         // set parameters
-        c->SetParameters(nPar, par);
+        c->SetParameters(nPar, set->GetParameters());
     }
 
+    // clean-up
+    delete sets;
+
     // user information
     if (!fSilence) Info("DumpCalibrations", "Dumped %d sets of '%s' of the calibration '%s'",
                         nSet, d->GetTitle(), calibration);
@@ -3486,55 +5889,64 @@ Int_t TCMySQLManager::DumpAllCalibrations(TCContainer* container, const Char_t*
 Int_t TCMySQLManager::ImportRuns(TCContainer* container)
 {
     // Import all runs from the CaLib container 'container' to the database.
+    // The runs are written in batches of multi-row inserts (see BulkInsert()).
     // Return the number of imported runs.
 
     // get number of runs
     Int_t nRun = container->GetNRuns();
 
     // loop over runs
-    Int_t nRunAdded = 0;
+    TList rows;
+    rows.SetOwner(kTRUE);
     for (Int_t i = 0; i < nRun; i++)
     {
         // get the run
         TCRun* r = container->GetRun(i);
 
-        // prepare the insert query
-        TString ins_query = TString::Format("INSERT INTO %s (run, path, filename, time, description, run_note, size, scr_n, scr_bad, "
-                                            "target, target_pol, target_pol_deg, beam_pol, beam_pol_deg) "
-                                            "VALUES ( "
-                                            "%d, "
-                                            "'%s', "
-                                            "'%s', "
-                                            "'%s', "
-                                            "'%s', "
-                                            "'%s', "
-                                            "%lld, "
-                                            "%d, "
-                                            "'%s', "
-                                            "'%s', "
-                                            "'%s', "
-                                            "%lf, "
-                                            "'%s', "
-                                            "%lf )",
-                                            TCConfig::kCalibMainTableName,
-                                            r->GetRun(),
-                                            r->GetPath(),
-                                            r->GetFileName(),
-                                            r->GetTime(),
-                                            r->GetDescription(),
-                                            r->GetRunNote(),
-                                            r->GetSize(),
-                                            r->GetNScalerReads(),
-                                            r->GetBadScalerReads(),
-                                            r->GetTarget(),
-                                            r->GetTargetPol(),
-                                            r->GetTargetPolDeg(),
-                                            r->GetBeamPol(),
-                                            r->GetBeamPolDeg());
-
-        // try to write data to database
-        Bool_t res = SendExec(ins_query.Data());
-        if (res == kFALSE)
+        // prepare the row values
+        rows.Add(new TObjString(TString::Format("( "
+                                                "%d, "
+                                                "%s, "
+                                                "%s, "
+                                                "%s, "
+                                                "%s, "
+                                                "%s, "
+                                                "%lld, "
+                                                "%d, "
+                                                "%s, "
+                                                "%s, "
+                                                "%s, "
+                                                "%.17g, "
+                                                "%s, "
+                                                "%.17g )",
+                                                r->GetRun(),
+                                                QuoteString(r->GetPath()).Data(),
+                                                QuoteString(r->GetFileName()).Data(),
+                                                QuoteString(r->GetTime()).Data(),
+                                                QuoteString(r->GetDescription()).Data(),
+                                                QuoteString(r->GetRunNote()).Data(),
+                                                r->GetSize(),
+                                                r->GetNScalerReads(),
+                                                QuoteString(r->GetBadScalerReads()).Data(),
+                                                QuoteString(r->GetTarget()).Data(),
+                                                QuoteString(r->GetTargetPol()).Data(),
+                                                r->GetTargetPolDeg(),
+                                                QuoteString(r->GetBeamPol()).Data(),
+                                                r->GetBeamPolDeg())));
+    }
+
+    // try to write data to database
+    Bool_t added[nRun];
+    Int_t nRunAdded = BulkInsert(TCConfig::kCalibMainTableName,
+                                 "run, path, filename, time, description, run_note, size, scr_n, scr_bad, "
+                                 "target, target_pol, target_pol_deg, beam_pol, beam_pol_deg",
+                                 &rows, added);
+
+    // report the status of the runs
+    for (Int_t i = 0; i < nRun; i++)
+    {
+        TCRun* r = container->GetRun(i);
+        if (!added[i])
         {
             Warning("ImportRuns", "Run %d could not be added to the database!",
                     r->GetRun());
@@ -3542,10 +5954,25 @@ Int_t TCMySQLManager::ImportRuns(TCContainer* container)
         else
         {
             if (!fSilence) Info("ImportRuns", "Added run %d to the database", r->GetRun());
-            nRunAdded++;
         }
     }
 
+    // copy the bad scaler reads of the added runs to the bad scaler read table
+    if (nRunAdded && fBadScRTable)
+    {
+        Int_t first = kMaxInt;
+        Int_t last = 0;
+        for (Int_t i = 0; i < nRun; i++)
+        {
+            if (!added[i]) continue;
+            first = TMath::Min(first, container->GetRun(i)->GetRun());
+            last = TMath::Max(last, container->GetRun(i)->GetRun());
+        }
+        if (!MigrateBadScR(first, last))
+            Warning("ImportRuns", "Could not copy the bad scaler reads of runs %d to %d to the table '%s'!",
+                    first, last, TCConfig::kBadScRTableName);
+    }
+
     // user information
     if (!fSilence) Info("ImportRuns", "Added %d runs to the database", nRunAdded);
 
@@ -3559,6 +5986,8 @@ Int_t TCMySQLManager::ImportCalibrations(TCContainer* container, const Char_t* n
     // Import all calibrations from the CaLib container 'container' to the database.
     // If 'newCalibName' is non-zero rename the calibration to 'newCalibName'
     // If 'data' is not 0 import only calibrations of the data 'data'.
+    // The calibrations are added in batches, each in one transaction. The sets
+    // of a failed batch are added one by one and the failing sets are reported.
     // Return the number of imported calibrations.
 
     // check data
@@ -3567,36 +5996,58 @@ Int_t TCMySQLManager::ImportCalibrations(TCContainer* container, const Char_t* n
     // get number of calibrations
     Int_t nCalib = container->GetNCalibrations();
 
-    // loop over calibrations
+    // loop over batches of calibrations
     Int_t nCalibAdded = 0;
-    for (Int_t i = 0; i < nCalib; i++)
+    for (Int_t first = 0; first < nCalib; first += fBatchSize)
     {
-        // get the calibration
-        TCCalibration* c = container->GetCalibration(i);
+        Int_t last = TMath::Min(first + fBatchSize, nCalib);
 
-        // skip unwanted calibration data
-        if (data != 0 && strcmp(c->GetCalibData(), data)) continue;
-
-        // add the set with new calibration identifer or the same
-        const Char_t* calibration;
-        if (newCalibName) calibration = newCalibName;
-        else calibration = c->GetCalibration();
-
-        TCCalibData* d = GetCalibData(c->GetCalibData());
-        if (!d) continue;
+        // collect the calibrations of this batch
+        TList sets;
+        sets.SetOwner(kTRUE);
+        for (Int_t i = first; i < last; i++)
+        {
+            // get the calibration
+            TCCalibration* c = container->GetCalibration(i);
+
+            // skip unwanted calibration data
+            if (data != 0 && strcmp(c->GetCalibData(), data)) continue;
+            if (!GetCalibData(c->GetCalibData())) continue;
+
+            // copy the set with new calibration identifer or the same
+            TCCalibration* set = new TCCalibration();
+            set->SetCalibData(c->GetCalibData());
+            set->SetCalibration(newCalibName ? newCalibName : c->GetCalibration());
+            set->SetDescription(c->GetDescription());
+            set->SetFirstRun(c->GetFirstRun());
+            set->SetLastRun(c->GetLastRun());
+            set->SetParameters(c->GetNParameters(), c->GetParameters());
+            sets.Add(set);
+        }
 
-        // add the set
-        if (AddDataSet(c->GetCalibData(), calibration, c->GetDescription(),
-                       c->GetFirstRun(), c->GetLastRun(), c->GetParameters(), c->GetNParameters(), kTRUE))
+        // add the batch in one transaction
+        if (AddDataSets(&sets, kTRUE))
         {
-            if (!fSilence) Info("ImportCalibrations", "Added calibration '%s' of '%s' to the database",
-                                calibration, d->GetTitle());
-            nCalibAdded++;
+            nCalibAdded += sets.GetSize();
+            continue;
         }
-        else
+
+        // add the sets of the failed batch one by one
+        if (!fSilence) Warning("ImportCalibrations", "Could not add calibrations %d to %d in one transaction - "
+                               "adding them one by one", first, last-1);
+        TIter next(&sets);
+        TCCalibration* set;
+        while ((set = (TCCalibration*)next()))
         {
-            if (!fSilence) Error("ImportCalibrations", "Calibration '%s' of '%s' could not be added to the database!",
-                                 calibration, d->GetTitle());
+            TList one;
+            one.Add(set);
+            if (AddDataSets(&one, kTRUE)) nCalibAdded++;
+            else
+            {
+                if (!fSilence) Error("ImportCalibrations", "Could not add the set of '%s' of calibration '%s' "
+                                     "for runs %d to %d to the database!", set->GetCalibData(),
+                                     set->GetCalibration(), set->GetFirstRun(), set->GetLastRun());
+            }
         }
     }
 
@@ -3630,68 +6081,55 @@ Bool_t TCMySQLManager::CloneCalibration(const Char_t* calibration, const Char_t*
     Bool_t true_clone = (new_first_run == 0 && new_last_run == 0) ? kTRUE : kFALSE;
 
     // loop over calibration data
+    TList clone;
+    clone.SetOwner(kTRUE);
     TIter next(fData);
     TCCalibData* d;
-    Bool_t error = kFALSE;
     while ((d = (TCCalibData*)next()))
     {
-        // get number of original sets
-        Int_t nSets = GetNsets(d->GetName(), calibration);
+        // read all original sets
+        TList* sets = ReadSets(d, calibration);
+        if (!sets)
+        {
+            if (!fSilence) Error("CloneCalibration", "Could not read original data '%s'!", d->GetName());
+            return kFALSE;
+        }
 
-        // check for true clone
-        if (true_clone)
+        // skip calibration data without sets
+        if (!sets->GetSize())
         {
-            // loop over sets
-            for (Int_t i = 0; i < nSets; i++)
-            {
-                // get run range of set
-                Int_t first_run = GetFirstRunOfSet(d->GetName(), calibration, i);
-                Int_t last_run = GetLastRunOfSet(d->GetName(), calibration, i);
+            delete sets;
+            continue;
+        }
 
-                // read parameters
-                Double_t par[d->GetSize()];
-                if (ReadParameters(d->GetName(), calibration, i, par, d->GetSize()))
-                {
-                    // add new set
-                    if (!AddDataSet(d->GetName(), newCalibrationName, newDesc, first_run, last_run, par, d->GetSize()))
-                    {
-                        if (!fSilence) Error("CloneCalibration", "Could not clone calibration data '%s'!", d->GetName());
-                        error = kTRUE;
-                    }
-                }
-                else
-                {
-                    if (!fSilence) Error("CloneCalibration", "Could not read original data '%s'!", d->GetName());
-                    error = kTRUE;
-                }
-            }
+        // check for true clone
+        if (!true_clone)
+        {
+            // keep only the last set using the new run range
+            TCCalibration* c = (TCCalibration*) sets->Last();
+            sets->Remove(c);
+            sets->Delete();
+            sets->Add(c);
+            c->SetFirstRun(new_first_run);
+            c->SetLastRun(new_last_run);
         }
-        else
+
+        // rename the sets and move them to the clone
+        TCCalibration* c;
+        while ((c = (TCCalibration*)sets->First()))
         {
-            // read parameters
-            Double_t par[d->GetSize()];
-            if (ReadParameters(d->GetName(), calibration, nSets-1, par, d->GetSize()))
-            {
-                // add new set
-                if (!AddDataSet(d->GetName(), newCalibrationName, newDesc, new_first_run, new_last_run, par, d->GetSize()))
-                {
-                    if (!fSilence) Error("CloneCalibration", "Could not clone calibration data '%s'!", d->GetName());
-                    error = kTRUE;
-                }
-            }
-            else
-            {
-                if (!fSilence) Error("CloneCalibration", "Could not read original data '%s'!", d->GetName());
-                error = kTRUE;
-            }
+            sets->Remove(c);
+            c->SetCalibration(newCalibrationName);
+            c->SetDescription(newDesc ? newDesc : "");
+            clone.Add(c);
         }
+        delete sets;
     }
 
-    // check if an error occurred
-    if (error)
+    // add all new sets in one transaction
+    if (!AddDataSets(&clone))
     {
-        // remove partially cloned calibrations when an error occurred
-        RemoveAllCalibrations(newCalibrationName);
+        if (!fSilence) Error("CloneCalibration", "Could not clone calibration '%s'!", calibration);
         return kFALSE;
     }
     else
@@ -3959,23 +6397,45 @@ Bool_t TCMySQLManager::ExportDatabase(const Char_t* filename)
     // backup original database config
     TSQLServer* db_orig = fDB;
     ServerType_t type_orig = fDBType;
+    ParStorage_t storage_orig = fParStorage;
+    THashList* tstorage_orig = fTableStorage;
+    TCParCache* cache_orig = fParCache;
 
-    // configure db connection to SQLite database
+    // configure db connection to SQLite database (without parameter cache)
     fDB = db;
     fDBType = kSQLite;
+    fTableStorage = new THashList();
+    fTableStorage->SetOwner(kTRUE);
+    fParCache = 0;
+    ClearSetIndex();
 
     // init the database
     InitDatabase(kFALSE);
 
+    // write everything in one transaction
+    Bool_t trans = BeginTransaction();
+
     // import runs
     Int_t nRunImp = TCMySQLManager::GetManager()->ImportRuns(container);
 
     // import calibrations
     Int_t nCalibImp = TCMySQLManager::GetManager()->ImportCalibrations(container);
 
+    // commit the transaction
+    if (trans && !CommitTransaction())
+    {
+        nRunImp = 0;
+        nCalibImp = 0;
+    }
+
     // restore original db connection
     fDB = db_orig;
     fDBType = type_orig;
+    fParStorage = storage_orig;
+    delete fTableStorage;
+    fTableStorage = tstorage_orig;
+    fParCache = cache_orig;
+    ClearSetIndex();
 
     // clean-up
     delete c;
@@ -0,0 +1,609 @@
+/*************************************************************************
+ * Author: Dominik Werthmueller, Irakli Keshelashvili, Thomas Strub
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TCParCache                                                           //
+//                                                                      //
+// Local read-through cache file of calibration parameters.             //
+//                                                                      //
+// The parameters of a set are stored in an append-only file that is    //
+// memory mapped for reading and shared by all processes using the      //
+// same file (access is serialized via POSIX file locks, which do not  //
+// exclude threads of the same process, see TCMySQLManager). A set is   //
+// identified by its calibration data, calibration identifier and first //
+// run, and a record is only valid if its change time matches the       //
+// 'changed' column of the set in the database. Newer records of a set  //
+// supersede older ones. Compact() rewrites the file keeping only the  //
+// latest valid records. Processes using the replaced file switch to    //
+// the new file on their next access.                                   //
+//                                                                      //
+// NOTE: Change times have a resolution of one second. The cache is     //
+//       invalidated by the writing process, but sets modified by       //
+//       another process within the second they were cached are not    //
+//       detected.                                                      //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdio.h>
+
+#include "TList.h"
+#include "THashList.h"
+#include "TObjString.h"
+#include "TError.h"
+#include "TMath.h"
+
+#include "TCParCache.h"
+#include "TCContainer.h"
+
+ClassImp(TCParCacheEntry)
+ClassImp(TCParCache)
+
+// file format
+static const Char_t kMagic[8] = { 'C', 'A', 'L', 'I', 'B', 'P', 'C', '1' };
+static const UInt_t kEndianMarker = 0x01020304;
+static const Int_t kHeaderSize = 256;
+static const Int_t kIDSize = kHeaderSize - 16;
+static const Int_t kObsoleteOffset = 12;    // flag of files replaced by a compaction
+static const Long64_t kCompactMinSize = 1048576;
+
+// record header
+struct TCParCacheRecord
+{
+    Int_t fSize;                // total size of the record (multiple of 8)
+    UInt_t fChanged;            // change time of the set
+    Int_t fFirstRun;            // first run of the set
+    Int_t fLastRun;             // last run of the set
+    Int_t fNpar;                // number of parameters (-1: invalidated set)
+    Int_t fKeyLen;              // length of the key (incl. terminating null)
+    Int_t fDescLen;             // length of the description (incl. terminating null)
+    Int_t fTimeLen;             // length of the change time (incl. terminating null)
+};
+
+//______________________________________________________________________________
+TCParCache::TCParCache(const Char_t* fileName, const Char_t* id, Bool_t silence)
+{
+    // Constructor opening the cache file 'fileName' for the database identified
+    // by 'id'. Files created for another database are refused.
+
+    // init members
+    fFileName = fileName;
+    fID = id;
+    fFD = -1;
+    fReadOnly = kFALSE;
+    fMap = 0;
+    fMapSize = 0;
+    fScanned = 0;
+    fNRecords = 0;
+    fIndex = new THashList();
+    fIndex->SetOwner(kTRUE);
+    fSilence = silence;
+
+    // open the file
+    Open();
+}
+
+//______________________________________________________________________________
+TCParCache::~TCParCache()
+{
+    // Destructor.
+
+    Close();
+    if (fIndex) delete fIndex;
+}
+
+//______________________________________________________________________________
+Bool_t TCParCache::Open()
+{
+    // Open the cache file and index its records. The file is created if it
+    // does not exist and opened read-only if it is not writable. The file is
+    // compacted if more than half of its records are outdated.
+    // Return kTRUE on success, otherwise kFALSE.
+
+    // open the file
+    fFD = open(fFileName.Data(), O_RDWR | O_CREAT, 0664);
+    if (fFD == -1)
+    {
+        fFD = open(fFileName.Data(), O_RDONLY);
+        fReadOnly = kTRUE;
+    }
+
+    // check the file
+    if (fFD == -1)
+    {
+        if (!fSilence) Error("Open", "Could not open the parameter cache file '%s'!", fFileName.Data());
+        return kFALSE;
+    }
+
+    // write the header of new files
+    if (!Lock(kTRUE))
+    {
+        Close();
+        return kFALSE;
+    }
+    struct stat st;
+    if (!fstat(fFD, &st) && st.st_size == 0 && !fReadOnly)
+    {
+        Char_t header[kHeaderSize];
+        memset(header, 0, kHeaderSize);
+        memcpy(header, kMagic, sizeof(kMagic));
+        memcpy(header + 8, &kEndianMarker, sizeof(kEndianMarker));
+        strncpy(header + 16, fID.Data(), kIDSize - 1);
+        if (pwrite(fFD, header, kHeaderSize, 0) != kHeaderSize)
+        {
+            if (!fSilence) Error("Open", "Could not write the header of the parameter cache file '%s'!",
+                                 fFileName.Data());
+            Unlock();
+            Close();
+            return kFALSE;
+        }
+    }
+
+    // map and index the file
+    Bool_t res = Update();
+    Unlock();
+
+    // check the file
+    if (!res)
+    {
+        Close();
+        return kFALSE;
+    }
+
+    // compact the file
+    if (!fReadOnly && fMapSize > kCompactMinSize && fNRecords > 2*fIndex->GetSize()) Compact();
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+void TCParCache::Close()
+{
+    // Unmap and close the cache file.
+
+    if (fMap) munmap(fMap, fMapSize);
+    if (fFD != -1) close(fFD);
+    fMap = 0;
+    fMapSize = 0;
+    fScanned = 0;
+    fNRecords = 0;
+    fFD = -1;
+    if (fIndex) fIndex->Delete();
+}
+
+//______________________________________________________________________________
+Bool_t TCParCache::Lock(Bool_t exclusive)
+{
+    // Lock the whole cache file for reading or, if 'exclusive' is kTRUE, for
+    // writing. Wait until the lock is available. If the file was replaced by
+    // a compaction in the meantime the new file is opened and locked.
+    // Return kTRUE on success, otherwise kFALSE.
+
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = exclusive && !fReadOnly ? F_WRLCK : F_RDLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = 0;
+    fl.l_len = 0;
+
+    // wait for the lock
+    while (fcntl(fFD, F_SETLKW, &fl) == -1)
+    {
+        if (errno == EINTR) continue;
+        if (!fSilence) Error("Lock", "Could not lock the parameter cache file '%s'!", fFileName.Data());
+        return kFALSE;
+    }
+
+    // reopen a replaced file
+    Char_t obsolete = 0;
+    if (pread(fFD, &obsolete, 1, kObsoleteOffset) == 1 && obsolete)
+    {
+        Unlock();
+        Close();
+        if (!Open()) return kFALSE;
+        return Lock(exclusive);
+    }
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+void TCParCache::Unlock()
+{
+    // Release the lock of the cache file.
+
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_UNLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = 0;
+    fl.l_len = 0;
+    fcntl(fFD, F_SETLK, &fl);
+}
+
+//______________________________________________________________________________
+Bool_t TCParCache::Update()
+{
+    // Remap the cache file if it has grown and index the records appended
+    // since the last update. The file has to be locked.
+    // Return kFALSE if the file is not a valid cache file of this database.
+
+    // get the file size
+    struct stat st;
+    if (fstat(fFD, &st)) return kFALSE;
+    Long64_t size = st.st_size;
+
+    // remap the grown file
+    if (size > fMapSize)
+    {
+        if (fMap) munmap(fMap, fMapSize);
+        fMap = (Char_t*) mmap(0, size, PROT_READ, MAP_SHARED, fFD, 0);
+        if (fMap == (Char_t*) MAP_FAILED)
+        {
+            fMap = 0;
+            fMapSize = 0;
+            if (!fSilence) Error("Update", "Could not map the parameter cache file '%s'!", fFileName.Data());
+            return kFALSE;
+        }
+        fMapSize = size;
+    }
+
+    // check the header
+    if (!fScanned)
+    {
+        UInt_t endian = 0;
+        if (size >= kHeaderSize) memcpy(&endian, fMap + 8, sizeof(endian));
+        if (size < kHeaderSize || memcmp(fMap, kMagic, sizeof(kMagic)))
+        {
+            if (!fSilence) Error("Update", "'%s' is not a parameter cache file!", fFileName.Data());
+            return kFALSE;
+        }
+        if (endian != kEndianMarker)
+        {
+            if (!fSilence) Error("Update", "The parameter cache file '%s' was written with a different byte order!",
+                                 fFileName.Data());
+            return kFALSE;
+        }
+        if (strncmp(fMap + 16, fID.Data(), kIDSize - 1))
+        {
+            if (!fSilence) Error("Update", "The parameter cache file '%s' belongs to the database '%s'!",
+                                 fFileName.Data(), fMap + 16);
+            return kFALSE;
+        }
+        fScanned = kHeaderSize;
+    }
+
+    // index the new records (a truncated record ends the scan)
+    Long64_t end = TMath::Min(size, fMapSize);
+    while (fScanned + (Long64_t)sizeof(TCParCacheRecord) <= end)
+    {
+        TCParCacheRecord rec;
+        memcpy(&rec, fMap + fScanned, sizeof(rec));
+        if (rec.fSize < (Int_t)sizeof(rec) || fScanned + rec.fSize > end) break;
+
+        // update the entry of the key
+        const Char_t* key = fMap + fScanned + sizeof(rec);
+        TCParCacheEntry* e = (TCParCacheEntry*) fIndex->FindObject(key);
+        if (e) e->SetOffset(fScanned);
+        else fIndex->Add(new TCParCacheEntry(key, fScanned));
+
+        fScanned += rec.fSize;
+        fNRecords++;
+    }
+
+    return kTRUE;
+}
+
+//______________________________________________________________________________
+Bool_t TCParCache::Append(const Char_t* key, UInt_t changed, Int_t firstRun, Int_t lastRun,
+                          Int_t npar, const Char_t* desc, const Char_t* ctime, const Double_t* par)
+{
+    // Append a record of the set 'key' to the cache file. 'npar' equal to -1
+    // invalidates the set. The file has to be locked exclusively.
+    // Return kTRUE on success, otherwise kFALSE.
+
+    // discard a truncated record of a failed writer
+    if (ftruncate(fFD, fScanned)) return kFALSE;
+
+    // fill the record header
+    TCParCacheRecord rec;
+    rec.fChanged = changed;
+    rec.fFirstRun = firstRun;
+    rec.fLastRun = lastRun;
+    rec.fNpar = npar;
+    rec.fKeyLen = strlen(key) + 1;
+    rec.fDescLen = strlen(desc) + 1;
+    rec.fTimeLen = strlen(ctime) + 1;
+    Int_t strLen = sizeof(rec) + rec.fKeyLen + rec.fDescLen + rec.fTimeLen;
+    strLen = (strLen + 7) & ~7;
+    rec.fSize = strLen + (npar > 0 ? npar*sizeof(Double_t) : 0);
+
+    // create the record
+    Char_t* buffer = new Char_t[rec.fSize];
+    memset(buffer, 0, rec.fSize);
+    Char_t* p = buffer;
+    memcpy(p, &rec, sizeof(rec));
+    p += sizeof(rec);
+    memcpy(p, key, rec.fKeyLen);
+    p += rec.fKeyLen;
+    memcpy(p, desc, rec.fDescLen);
+    p += rec.fDescLen;
+    memcpy(p, ctime, rec.fTimeLen);
+    if (npar > 0) memcpy(buffer + strLen, par, npar*sizeof(Double_t));
+
+    // write the record
+    Bool_t res = pwrite(fFD, buffer, rec.fSize, fScanned) == rec.fSize;
+    delete [] buffer;
+
+    // index the record
+    if (res) res = Update();
+
+    return res;
+}
+
+//______________________________________________________________________________
+TString TCParCache::BuildKey(const Char_t* data, const Char_t* calibration, Int_t firstRun)
+{
+    // Return the key of the set starting at the run 'firstRun' of the calibration
+    // data 'data' and the calibration identifier 'calibration'.
+
+    return TString::Format("%s|%s|%d", data, calibration, firstRun);
+}
+
+//______________________________________________________________________________
+Int_t TCParCache::GetNEntries() const
+{
+    // Return the number of sets indexed in the cache file.
+
+    return fIndex ? fIndex->GetSize() : 0;
+}
+
+//______________________________________________________________________________
+TCCalibration* TCParCache::Read(const Char_t* data, const Char_t* calibration, Int_t firstRun,
+                                UInt_t changed)
+{
+    // Read the set starting at the run 'firstRun' of the calibration data 'data'
+    // and the calibration identifier 'calibration' having the change time 'changed'
+    // from the cache file.
+    // Return the calibration or 0 if the set is not cached or outdated.
+    // NOTE: The calibration must be destroyed by the caller.
+
+    // check file and change time
+    if (!IsOpen() || !changed) return 0;
+
+    // lock the file and index new records
+    if (!Lock(kFALSE)) return 0;
+    if (!Update())
+    {
+        Unlock();
+        return 0;
+    }
+
+    // search the set
+    TCCalibration* c = 0;
+    TCParCacheEntry* e = (TCParCacheEntry*) fIndex->FindObject(BuildKey(data, calibration, firstRun));
+    if (e)
+    {
+        // read the record
+        const Char_t* p = fMap + e->GetOffset();
+        TCParCacheRecord rec;
+        memcpy(&rec, p, sizeof(rec));
+
+        // check the change time
+        if (rec.fNpar >= 0 && rec.fChanged == changed)
+        {
+            const Char_t* desc = p + sizeof(rec) + rec.fKeyLen;
+            const Char_t* ctime = desc + rec.fDescLen;
+            Int_t strLen = (sizeof(rec) + rec.fKeyLen + rec.fDescLen + rec.fTimeLen + 7) & ~7;
+
+            // copy the parameters
+            Double_t* par = new Double_t[rec.fNpar ? rec.fNpar : 1];
+            memcpy(par, p + strLen, rec.fNpar*sizeof(Double_t));
+
+            // create the calibration
+            c = new TCCalibration();
+            c->SetCalibData(data);
+            c->SetCalibration(calibration);
+            c->SetDescription(desc);
+            c->SetFirstRun(rec.fFirstRun);
+            c->SetLastRun(rec.fLastRun);
+            c->SetChangeTime(ctime);
+            c->SetParameters(rec.fNpar, par);
+            delete [] par;
+        }
+    }
+
+    // unlock the file
+    Unlock();
+
+    return c;
+}
+
+//______________________________________________________________________________
+Bool_t TCParCache::Write(TCCalibration* calibration, UInt_t changed)
+{
+    // Write the set 'calibration' having the change time 'changed' to the
+    // cache file. Sets already cached with this change time are not rewritten.
+    // Return kTRUE on success, otherwise kFALSE.
+
+    // check file and change time
+    if (!IsOpen() || fReadOnly || !changed) return kFALSE;
+
+    // lock the file and index new records
+    if (!Lock(kTRUE)) return kFALSE;
+    Bool_t res = Update();
+
+    // check if another process has cached the set already
+    TString key = BuildKey(calibration->GetCalibData(), calibration->GetCalibration(),
+                           calibration->GetFirstRun());
+    TCParCacheEntry* e = res ? (TCParCacheEntry*) fIndex->FindObject(key) : 0;
+    if (e)
+    {
+        TCParCacheRecord rec;
+        memcpy(&rec, fMap + e->GetOffset(), sizeof(rec));
+        if (rec.fNpar == calibration->GetNParameters() && rec.fChanged == changed)
+        {
+            Unlock();
+            return kTRUE;
+        }
+    }
+
+    // append the set
+    if (res) res = Append(key.Data(), changed, calibration->GetFirstRun(), calibration->GetLastRun(),
+                          calibration->GetNParameters(), calibration->GetDescription(),
+                          calibration->GetChangeTime(), calibration->GetParameters());
+
+    // unlock the file
+    Unlock();
+
+    return res;
+}
+
+//______________________________________________________________________________
+void TCParCache::Invalidate(const Char_t* data, const Char_t* calibration, Int_t nSet,
+                            const Int_t* firstRun)
+{
+    // Invalidate the 'nSet' cached sets starting at the runs 'firstRun' of the
+    // calibration data 'data' and the calibration identifier 'calibration'.
+    // All sets of 'data' and 'calibration' are invalidated if 'nSet' is 0.
+
+    // check file
+    if (!IsOpen() || fReadOnly) return;
+
+    // lock the file and index new records
+    if (!Lock(kTRUE)) return;
+    if (!Update())
+    {
+        Unlock();
+        return;
+    }
+
+    // collect the valid sets
+    TString prefix = TString::Format("%s|%s|", data, calibration);
+    TList keys;
+    keys.SetOwner(kTRUE);
+    if (nSet)
+    {
+        for (Int_t i = 0; i < nSet; i++)
+        {
+            TCParCacheEntry* e = (TCParCacheEntry*) fIndex->FindObject(BuildKey(data, calibration, firstRun[i]));
+            if (!e || keys.FindObject(e->GetName())) continue;
+            TCParCacheRecord rec;
+            memcpy(&rec, fMap + e->GetOffset(), sizeof(rec));
+            if (rec.fNpar >= 0) keys.Add(new TObjString(e->GetName()));
+        }
+    }
+    else
+    {
+        TIter next(fIndex);
+        TCParCacheEntry* e;
+        while ((e = (TCParCacheEntry*)next()))
+        {
+            if (!TString(e->GetName()).BeginsWith(prefix)) continue;
+            TCParCacheRecord rec;
+            memcpy(&rec, fMap + e->GetOffset(), sizeof(rec));
+            if (rec.fNpar >= 0) keys.Add(new TObjString(e->GetName()));
+        }
+    }
+
+    // append an invalidation record for each set
+    TIter nextKey(&keys);
+    TObjString* s;
+    while ((s = (TObjString*)nextKey()))
+    {
+        if (!Append(s->GetString().Data(), 0, 0, 0, -1, "", "", 0)) break;
+    }
+
+    // unlock the file
+    Unlock();
+}
+
+//______________________________________________________________________________
+Bool_t TCParCache::Compact()
+{
+    // Rewrite the cache file keeping only the latest valid record of each set.
+    // The file is replaced atomically and the replaced file is flagged, so that
+    // other processes using it open the new file on their next access.
+    // Return kTRUE on success, otherwise kFALSE.
+
+    // check file
+    if (!IsOpen() || fReadOnly) return kFALSE;
+
+    // lock the file and index new records
+    if (!Lock(kTRUE)) return kFALSE;
+    if (!Update())
+    {
+        Unlock();
+        return kFALSE;
+    }
+
+    // create the new file next to the cache file
+    TString tmpName = TString::Format("%s.%d.tmp", fFileName.Data(), (Int_t) getpid());
+    Int_t fd = open(tmpName.Data(), O_RDWR | O_CREAT | O_TRUNC, 0664);
+    if (fd == -1)
+    {
+        if (!fSilence) Error("Compact", "Could not create the file '%s'!", tmpName.Data());
+        Unlock();
+        return kFALSE;
+    }
+
+    // copy the header
+    Bool_t res = pwrite(fd, fMap, kHeaderSize, 0) == kHeaderSize;
+
+    // copy the latest valid records
+    Long64_t pos = kHeaderSize;
+    Int_t nRec = 0;
+    TIter next(fIndex);
+    TCParCacheEntry* e;
+    while (res && (e = (TCParCacheEntry*)next()))
+    {
+        TCParCacheRecord rec;
+        memcpy(&rec, fMap + e->GetOffset(), sizeof(rec));
+        if (rec.fNpar < 0) continue;
+        res = pwrite(fd, fMap + e->GetOffset(), rec.fSize, pos) == rec.fSize;
+        pos += rec.fSize;
+        nRec++;
+    }
+    if (res) res = !fsync(fd);
+    close(fd);
+
+    // flag the cache file as replaced (seen by other processes only after the
+    // lock was released) and replace it
+    Char_t obsolete = 1;
+    if (res && pwrite(fFD, &obsolete, 1, kObsoleteOffset) != 1)
+    {
+        if (!fSilence) Error("Compact", "Could not flag the parameter cache file '%s' as replaced!",
+                             fFileName.Data());
+        res = kFALSE;
+    }
+    else if (res && rename(tmpName.Data(), fFileName.Data()))
+    {
+        // keep the cache file (remove it if it stays flagged, it is rebuilt then)
+        obsolete = 0;
+        if (pwrite(fFD, &obsolete, 1, kObsoleteOffset) != 1) unlink(fFileName.Data());
+        res = kFALSE;
+    }
+    if (!res)
+    {
+        if (!fSilence) Error("Compact", "Could not compact the parameter cache file '%s'!", fFileName.Data());
+        unlink(tmpName.Data());
+        Unlock();
+        return kFALSE;
+    }
+
+    // user information
+    if (!fSilence) Info("Compact", "Compacted the parameter cache file '%s' from %d to %d records",
+                        fFileName.Data(), fNRecords, nRec);
+
+    // open the new file
+    Unlock();
+    Close();
+    return Open();
+}
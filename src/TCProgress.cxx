@@ -0,0 +1,83 @@
+/*************************************************************************
+ * Author: Dominik Werthmueller, Irakli Keshelashvili, Thomas Strub
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TCProgress                                                           //
+//                                                                      //
+// Thread-safe progress reporter.                                       //
+//                                                                      //
+// Prints the percentage of finished steps of a task together with the  //
+// elapsed and the estimated remaining time every 'step' percent.       //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include "TSystem.h"
+#include "TMutex.h"
+#include "TVirtualMutex.h"
+
+#include "TCProgress.h"
+
+ClassImp(TCProgress)
+
+//______________________________________________________________________________
+TCProgress::TCProgress(const Char_t* name, Int_t total, Int_t step)
+{
+    // Constructor for the task 'name' consisting of 'total' steps reported
+    // every 'step' percent.
+
+    // init members
+    fName = name;
+    fTotal = total;
+    fDone = 0;
+    fStep = step > 0 ? step : 5;
+    fNext = fStep;
+    fStart = (Long64_t) gSystem->Now();
+    fMutex = new TMutex();
+}
+
+//______________________________________________________________________________
+TCProgress::~TCProgress()
+{
+    // Destructor.
+
+    if (fMutex) delete fMutex;
+}
+
+//______________________________________________________________________________
+void TCProgress::Increment(Int_t n)
+{
+    // Mark 'n' more steps as finished and report the progress if the next
+    // reporting step was reached.
+
+    TLockGuard lock(fMutex);
+
+    // count the steps
+    fDone += n;
+    if (fTotal <= 0) return;
+
+    // check the reporting step
+    Int_t per = (Int_t) (100. * fDone / fTotal);
+    if (per < fNext) return;
+    while (fNext <= per) fNext += fStep;
+
+    // report the progress
+    Double_t elapsed = ((Long64_t) gSystem->Now() - fStart) / 1000.;
+    Double_t left = fDone < fTotal ? elapsed * (fTotal - fDone) / fDone : 0;
+    printf("%s: %3d%% (%d/%d), %.1f s elapsed, %.1f s left\n",
+           fName.Data(), per, fDone, fTotal, elapsed, left);
+}
+
+//______________________________________________________________________________
+void TCProgress::Finish()
+{
+    // Report the total time of the task.
+
+    TLockGuard lock(fMutex);
+
+    Double_t elapsed = ((Long64_t) gSystem->Now() - fStart) / 1000.;
+    printf("%s: done (%d/%d) in %.1f s\n", fName.Data(), fDone, fTotal, elapsed);
+}
+
@@ -0,0 +1,166 @@
+/*************************************************************************
+ * Author: Dominik Werthmueller, Irakli Keshelashvili, Thomas Strub
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TCProjCache                                                          //
+//                                                                      //
+// Cache of the x-projections of all y-bins of a 2D histogram.          //
+//                                                                      //
+// The projections are extracted in one pass over the bins of the 2D    //
+// histogram into one contiguous buffer. Fill() copies a projection     //
+// into a histogram that is created once and reused afterwards, i.e.,   //
+// the result is the same as TH2::ProjectionX(name, i+1, i+1, "e")      //
+// (including the range of the x-axis set at the time of creation)      //
+// without creating a new histogram each time.                          //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include <cstring>
+
+#include "TH2.h"
+#include "TAxis.h"
+#include "TArrayD.h"
+#include "TList.h"
+#include "TError.h"
+#include "TMath.h"
+
+#include "TCProjCache.h"
+
+ClassImp(TCProjCache)
+
+//______________________________________________________________________________
+TCProjCache::TCProjCache(TH2* h)
+{
+    // Constructor extracting the x-projections of all y-bins of 'h'.
+
+    TAxis* xa = h->GetXaxis();
+
+    // projected range of the x-axis
+    Int_t nx = h->GetNbinsX();
+    Int_t first = xa->GetFirst();
+    Int_t last = xa->GetLast();
+
+    // init members
+    fNproj = h->GetNbinsY();
+    fNbins = last - first + 3;
+    fIsVariable = xa->GetXbins()->GetSize() > 0;
+    fEdges = new Double_t[fNbins-1];
+    fContent = new Double_t[fNproj*fNbins];
+    fError2 = new Double_t[fNproj*fNbins];
+    fTitle = h->GetTitle();
+    fAxis = new TAxis(*xa);
+
+    // bin edges
+    for (Int_t i = first; i <= last; i++) fEdges[i-first] = xa->GetBinLowEdge(i);
+    fEdges[fNbins-2] = xa->GetBinUpEdge(last);
+
+    // init buffers
+    for (Int_t i = 0; i < fNproj*fNbins; i++)
+    {
+        fContent[i] = 0;
+        fError2[i] = 0;
+    }
+
+    // squared errors
+    const TArrayD* sumw2 = h->GetSumw2();
+    Bool_t hasSumw2 = sumw2 && sumw2->GetSize() > 0;
+
+    // bin contents (read directly for double and float histograms)
+    const Double_t* wd = h->InheritsFrom(TH2D::Class()) ? ((TH2D*) h)->GetArray() : 0;
+    const Float_t* wf = h->InheritsFrom(TH2F::Class()) ? ((TH2F*) h)->GetArray() : 0;
+
+    // loop over the bins in memory order (the bins outside the projected
+    // range are added to the under- and overflow bins like ProjectionX() does)
+    for (Int_t j = 1; j <= fNproj; j++)
+    {
+        Double_t* c = fContent + (j-1)*fNbins;
+        Double_t* e = fError2 + (j-1)*fNbins;
+        Int_t bin = j*(nx+2);
+        for (Int_t i = 0; i <= nx+1; i++, bin++)
+        {
+            // target bin
+            Int_t k;
+            if (i < first) k = 0;
+            else if (i > last) k = fNbins-1;
+            else k = i - first + 1;
+
+            // add content and squared error
+            Double_t v = wd ? wd[bin] : (wf ? wf[bin] : h->GetBinContent(bin));
+            c[k] += v;
+            e[k] += hasSumw2 ? sumw2->GetAt(bin) : TMath::Abs(v);
+        }
+    }
+}
+
+//______________________________________________________________________________
+TCProjCache::~TCProjCache()
+{
+    // Destructor.
+
+    if (fEdges) delete [] fEdges;
+    if (fContent) delete [] fContent;
+    if (fError2) delete [] fError2;
+    if (fAxis) delete fAxis;
+}
+
+//______________________________________________________________________________
+TH1* TCProjCache::Fill(Int_t i, TH1*& h, const Char_t* name) const
+{
+    // Copy the projection 'i' to the histogram 'h' named 'name' and return it.
+    // 'h' is created if it is 0 or not a TH1D. Its binning is restored if it
+    // was changed (e.g. by rebinning), its axis range is reset and its fitted
+    // functions are deleted.
+    // Return 0 if 'i' is out of range.
+
+    // check the projection
+    if (i < 0 || i >= fNproj)
+    {
+        Error("TCProjCache::Fill", "Projection %d out of range [0,%d]", i, fNproj-1);
+        return 0;
+    }
+
+    // create the histogram
+    if (h && h->IsA() != TH1D::Class())
+    {
+        delete h;
+        h = 0;
+    }
+    if (!h)
+    {
+        if (fIsVariable) h = new TH1D(name, fTitle.Data(), fNbins-2, fEdges);
+        else h = new TH1D(name, fTitle.Data(), fNbins-2, fEdges[0], fEdges[fNbins-2]);
+        h->Sumw2();
+        h->GetXaxis()->ImportAttributes(fAxis);
+    }
+    else
+    {
+        // restore the histogram
+        h->SetName(name);
+        if (h->GetNbinsX() != fNbins-2)
+        {
+            if (fIsVariable) h->SetBins(fNbins-2, fEdges);
+            else h->SetBins(fNbins-2, fEdges[0], fEdges[fNbins-2]);
+        }
+        if (h->GetSumw2N() != fNbins) h->Sumw2();
+        h->GetXaxis()->SetRange(0, 0);
+
+        // delete the fitted functions (but keep the statistics box)
+        TList* funcs = h->GetListOfFunctions();
+        TObject* stats = funcs->FindObject("stats");
+        if (stats) funcs->Remove(stats);
+        funcs->Delete();
+        if (stats) funcs->Add(stats);
+    }
+
+    // copy the contents and the squared errors
+    memcpy(((TH1D*) h)->GetArray(), GetContent(i), fNbins*sizeof(Double_t));
+    memcpy(h->GetSumw2()->GetArray(), GetError2(i), fNbins*sizeof(Double_t));
+
+    // update the statistics
+    h->ResetStats();
+
+    return h;
+}
@@ -0,0 +1,139 @@
+/*************************************************************************
+ * Author: Dominik Werthmueller, Irakli Keshelashvili, Thomas Strub
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TCSetIndex                                                           //
+//                                                                      //
+// Run interval index of the sets of a calibration.                     //
+//                                                                      //
+// The first and last runs of the sets are stored sorted by the first   //
+// run so that the set containing a run can be found by binary search.  //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include "TCSetIndex.h"
+
+ClassImp(TCSetIndex)
+
+//______________________________________________________________________________
+TCSetIndex::TCSetIndex(const Char_t* data, const Char_t* calibration, Int_t nSet)
+    : TObject()
+{
+    // Constructor for the calibration data 'data' and the calibration
+    // identifier 'calibration' with 'nSet' sets to be set via SetSet().
+    // Further sets can be added via AddSet().
+
+    // init members
+    fKey = BuildKey(data, calibration);
+    fData = data;
+    fCalibration = calibration;
+    fNset = 0;
+    fSize = 0;
+    fFirstRun = 0;
+    fLastRun = 0;
+    fChanged = 0;
+
+    // create the arrays
+    if (nSet > 0)
+    {
+        Expand(nSet);
+        fNset = nSet;
+    }
+}
+
+//______________________________________________________________________________
+TCSetIndex::~TCSetIndex()
+{
+    // Destructor.
+
+    if (fFirstRun) delete [] fFirstRun;
+    if (fLastRun) delete [] fLastRun;
+    if (fChanged) delete [] fChanged;
+}
+
+//______________________________________________________________________________
+void TCSetIndex::Expand(Int_t size)
+{
+    // Expand the arrays to the size 'size'.
+
+    Int_t* firstRun = new Int_t[size];
+    Int_t* lastRun = new Int_t[size];
+    UInt_t* changed = new UInt_t[size];
+
+    // copy the old entries
+    for (Int_t i = 0; i < fNset; i++)
+    {
+        firstRun[i] = fFirstRun[i];
+        lastRun[i] = fLastRun[i];
+        changed[i] = fChanged[i];
+    }
+
+    // replace the arrays
+    if (fFirstRun) delete [] fFirstRun;
+    if (fLastRun) delete [] fLastRun;
+    if (fChanged) delete [] fChanged;
+    fFirstRun = firstRun;
+    fLastRun = lastRun;
+    fChanged = changed;
+    fSize = size;
+}
+
+//______________________________________________________________________________
+void TCSetIndex::SetSet(Int_t set, Int_t firstRun, Int_t lastRun, UInt_t changed)
+{
+    // Set the first run 'firstRun', the last run 'lastRun' and the change time
+    // 'changed' of the set 'set'.
+
+    fFirstRun[set] = firstRun;
+    fLastRun[set] = lastRun;
+    fChanged[set] = changed;
+}
+
+//______________________________________________________________________________
+void TCSetIndex::AddSet(Int_t firstRun, Int_t lastRun, UInt_t changed)
+{
+    // Add a set with the first run 'firstRun', the last run 'lastRun' and the
+    // change time 'changed'. Sets have to be added sorted by their first run.
+
+    if (fNset == fSize) Expand(fSize ? 2*fSize : 16);
+    SetSet(fNset++, firstRun, lastRun, changed);
+}
+
+//______________________________________________________________________________
+Int_t TCSetIndex::FindSet(Int_t run) const
+{
+    // Return the set containing the run 'run' or -1 if there is no such set.
+
+    // binary search for the last set starting before or at 'run'
+    // (sets are sorted by their first run and do not overlap)
+    Int_t lo = 0;
+    Int_t hi = fNset - 1;
+    Int_t set = -1;
+    while (lo <= hi)
+    {
+        Int_t mid = (lo + hi) / 2;
+        if (fFirstRun[mid] <= run)
+        {
+            set = mid;
+            lo = mid + 1;
+        }
+        else hi = mid - 1;
+    }
+
+    // check if run is in this set
+    if (set != -1 && run <= fLastRun[set]) return set;
+    else return -1;
+}
+
+//______________________________________________________________________________
+TString TCSetIndex::BuildKey(const Char_t* data, const Char_t* calibration)
+{
+    // Return the key of the index of the calibration data 'data' and the
+    // calibration identifier 'calibration'.
+
+    return TString::Format("%s|%s", data, calibration);
+}
+
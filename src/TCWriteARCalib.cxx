@@ -15,13 +15,79 @@
 
 #include "TError.h"
 #include "TString.h"
+#include "THashList.h"
+#include "TObjString.h"
+#include "TMath.h"
 
 #include "TCWriteARCalib.h"
 #include "TCMySQLManager.h"
 #include "TCReadARCalib.h"
+#include "TCContainer.h"
 
 ClassImp(TCWriteARCalib)
 
+// target elements of the calibration data
+enum EARTarget {
+    kARElement,         // elements
+    kARTimeWalk,        // time walk elements
+    kARElementSG        // TAPS SG elements
+};
+
+// calibration data written to the AcquRoot calibration files
+struct TCWriteARCalibData
+{
+    CalibDetector_t fDetector;                  // detector
+    const Char_t* fData;                        // calibration data
+    EARTarget fTarget;                          // target elements
+    void (TCARElement::*fSetElem)(Double_t);    // element setter
+    void (TCARTimeWalk::*fSetWalk)(Double_t);   // time walk element setter
+};
+
+static const TCWriteARCalibData gWriteARCalibData[] =
+{
+    // tagger time offset
+    { kDETECTOR_TAGG,  "Data.Tagger.T0",    kARElement,   &TCARElement::SetOffset,    0 },
+
+    // CB time offset, ADC gain and time walk parameters
+    { kDETECTOR_CB,    "Data.CB.T0",        kARElement,   &TCARElement::SetOffset,    0 },
+    { kDETECTOR_CB,    "Data.CB.E1",        kARElement,   &TCARElement::SetADCGain,   0 },
+    { kDETECTOR_CB,    "Data.CB.Walk.Par0", kARTimeWalk,  0, &TCARTimeWalk::SetPar0 },
+    { kDETECTOR_CB,    "Data.CB.Walk.Par1", kARTimeWalk,  0, &TCARTimeWalk::SetPar1 },
+    { kDETECTOR_CB,    "Data.CB.Walk.Par2", kARTimeWalk,  0, &TCARTimeWalk::SetPar2 },
+    { kDETECTOR_CB,    "Data.CB.Walk.Par3", kARTimeWalk,  0, &TCARTimeWalk::SetPar3 },
+
+    // TAPS time offset, TDC gain, ADC pedestal and gain, CFD threshold and SG ADC pedestal and gain
+    { kDETECTOR_TAPS,  "Data.TAPS.T0",      kARElement,   &TCARElement::SetOffset,    0 },
+    { kDETECTOR_TAPS,  "Data.TAPS.T1",      kARElement,   &TCARElement::SetTDCGain,   0 },
+    { kDETECTOR_TAPS,  "Data.TAPS.LG.E0",   kARElement,   &TCARElement::SetPedestal,  0 },
+    { kDETECTOR_TAPS,  "Data.TAPS.LG.E1",   kARElement,   &TCARElement::SetADCGain,   0 },
+    { kDETECTOR_TAPS,  "Data.TAPS.CFD",     kARElement,   &TCARElement::SetEnergyLow, 0 },
+    { kDETECTOR_TAPS,  "Data.TAPS.SG.E0",   kARElementSG, &TCARElement::SetPedestal,  0 },
+    { kDETECTOR_TAPS,  "Data.TAPS.SG.E1",   kARElementSG, &TCARElement::SetADCGain,   0 },
+
+    // PID phi angle, time offset, ADC pedestal and gain
+    { kDETECTOR_PID,   "Data.PID.Phi",      kARElement,   &TCARElement::SetZ,         0 },
+    { kDETECTOR_PID,   "Data.PID.T0",       kARElement,   &TCARElement::SetOffset,    0 },
+    { kDETECTOR_PID,   "Data.PID.E0",       kARElement,   &TCARElement::SetPedestal,  0 },
+    { kDETECTOR_PID,   "Data.PID.E1",       kARElement,   &TCARElement::SetADCGain,   0 },
+
+    // Veto time offset, TDC gain, ADC pedestal and gain and LED threshold
+    { kDETECTOR_VETO,  "Data.Veto.T0",      kARElement,   &TCARElement::SetOffset,    0 },
+    { kDETECTOR_VETO,  "Data.Veto.T1",      kARElement,   &TCARElement::SetTDCGain,   0 },
+    { kDETECTOR_VETO,  "Data.Veto.E0",      kARElement,   &TCARElement::SetPedestal,  0 },
+    { kDETECTOR_VETO,  "Data.Veto.E1",      kARElement,   &TCARElement::SetADCGain,   0 },
+    { kDETECTOR_VETO,  "Data.Veto.LED",     kARElement,   &TCARElement::SetEnergyLow, 0 },
+
+    // Pizza phi angle, time offset, ADC pedestal and gain
+    { kDETECTOR_PIZZA, "Data.Pizza.Phi",    kARElement,   &TCARElement::SetZ,         0 },
+    { kDETECTOR_PIZZA, "Data.Pizza.T0",     kARElement,   &TCARElement::SetOffset,    0 },
+    { kDETECTOR_PIZZA, "Data.Pizza.E0",     kARElement,   &TCARElement::SetPedestal,  0 },
+    { kDETECTOR_PIZZA, "Data.Pizza.E1",     kARElement,   &TCARElement::SetADCGain,   0 },
+
+    // end of table
+    { kDETECTOR_NODET, 0,                   kARElement,   0,                          0 }
+};
+
 //______________________________________________________________________________
 TCWriteARCalib::TCWriteARCalib(CalibDetector_t det, const Char_t* templateFile)
 {
@@ -59,156 +125,54 @@ void TCWriteARCalib::Write(const Char_t* calibFile,
     if (rSG) nDetSG = rSG->GetNelements();
 
     // create parameter array
-    Double_t par[nDet];
+    Double_t par[TMath::Max(nDet, TMath::Max(nDetTW, nDetSG))];
 
-    // check the detetector
-    switch (fDetector)
+    // read all calibrations of the detector at once
+    TList dataList;
+    dataList.SetOwner(kTRUE);
+    for (Int_t i = 0; gWriteARCalibData[i].fData; i++)
     {
-        case kDETECTOR_TAGG:
-        {
-            // read time offset
-            if (m->ReadParametersRun("Data.Tagger.T0", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetOffset(par[i]);
-
-            break;
-
-        }
-        case kDETECTOR_CB:
-        {
-            // read time offset
-            if (m->ReadParametersRun("Data.CB.T0", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetOffset(par[i]);
-
-            // read ADC gain
-            if (m->ReadParametersRun("Data.CB.E1", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetADCGain(par[i]);
-
-            if (nDetTW)
-            {
-                // read time walk parameter 0
-                if (m->ReadParametersRun("Data.CB.Walk.Par0", calibration, run, par, nDetTW))
-                    for (Int_t i = 0; i < nDetTW; i++) r->GetTimeWalk(i)->SetPar0(par[i]);
-
-                // read time walk parameter 1
-                if (m->ReadParametersRun("Data.CB.Walk.Par1", calibration, run, par, nDetTW))
-                    for (Int_t i = 0; i < nDetTW; i++) r->GetTimeWalk(i)->SetPar1(par[i]);
-
-                // read time walk parameter 2
-                if (m->ReadParametersRun("Data.CB.Walk.Par2", calibration, run, par, nDetTW))
-                    for (Int_t i = 0; i < nDetTW; i++) r->GetTimeWalk(i)->SetPar2(par[i]);
-
-                // read time walk parameter 3
-                if (m->ReadParametersRun("Data.CB.Walk.Par3", calibration, run, par, nDetTW))
-                    for (Int_t i = 0; i < nDetTW; i++) r->GetTimeWalk(i)->SetPar3(par[i]);
-            }
-
-            break;
-        }
-        case kDETECTOR_TAPS:
-        {
-            // read time offset
-            if (m->ReadParametersRun("Data.TAPS.T0", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetOffset(par[i]);
-
-            // read TDC gain
-            if (m->ReadParametersRun("Data.TAPS.T1", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetTDCGain(par[i]);
-
-            // read ADC pedestal
-            if (m->ReadParametersRun("Data.TAPS.LG.E0", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetPedestal(par[i]);
-
-            // read ADC gain
-            if (m->ReadParametersRun("Data.TAPS.LG.E1", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetADCGain(par[i]);
-
-            // read CFD threshold
-            if (m->ReadParametersRun("Data.TAPS.CFD", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetEnergyLow(par[i]);
-
-            if (nDetSG)
-            {
-                // read SG ADC pedestal
-                if (m->ReadParametersRun("Data.TAPS.SG.E0", calibration, run, par, nDetSG))
-                    for (Int_t i = 0; i < nDetSG; i++) rSG->GetElement(i)->SetPedestal(par[i]);
-
-                // read SG ADC gain
-                if (m->ReadParametersRun("Data.TAPS.SG.E1", calibration, run, par, nDetSG))
-                    for (Int_t i = 0; i < nDetSG; i++) rSG->GetElement(i)->SetADCGain(par[i]);
-            }
-
-            break;
-        }
-        case kDETECTOR_PID:
-        {
-            // read phi angle
-            if (m->ReadParametersRun("Data.PID.Phi", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetZ(par[i]);
-
-            // read time offset
-            if (m->ReadParametersRun("Data.PID.T0", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetOffset(par[i]);
-
-            // read ADC pedestal
-            if (m->ReadParametersRun("Data.PID.E0", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetPedestal(par[i]);
-
-            // read ADC gain
-            if (m->ReadParametersRun("Data.PID.E1", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetADCGain(par[i]);
-
-            break;
-        }
-        case kDETECTOR_VETO:
-        {
-            // read time offset
-            if (m->ReadParametersRun("Data.Veto.T0", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetOffset(par[i]);
+        const TCWriteARCalibData& d = gWriteARCalibData[i];
 
-            // read TDC gain
-            if (m->ReadParametersRun("Data.Veto.T1", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetTDCGain(par[i]);
-
-            // read ADC pedestal
-            if (m->ReadParametersRun("Data.Veto.E0", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetPedestal(par[i]);
-
-            // read ADC gain
-            if (m->ReadParametersRun("Data.Veto.E1", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetADCGain(par[i]);
-
-            // read LED thresholds
-            if (m->ReadParametersRun("Data.Veto.LED", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetEnergyLow(par[i]);
+        // skip other detectors and time walk and SG data if not present in the template
+        if (d.fDetector != fDetector) continue;
+        if (d.fTarget == kARTimeWalk && !nDetTW) continue;
+        if (d.fTarget == kARElementSG && !nDetSG) continue;
+        dataList.Add(new TObjString(d.fData));
+    }
+    THashList* calibs = 0;
+    if (dataList.GetSize()) calibs = m->ReadParametersRunMulti(calibration, run, &dataList);
 
-            break;
-        }
-        case kDETECTOR_PIZZA:
-        {
-            // read phi angle
-            if (m->ReadParametersRun("Data.Pizza.Phi", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetZ(par[i]);
+    // set the parameters of the elements
+    for (Int_t i = 0; gWriteARCalibData[i].fData; i++)
+    {
+        const TCWriteARCalibData& d = gWriteARCalibData[i];
 
-            // read time offset
-            if (m->ReadParametersRun("Data.Pizza.T0", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetOffset(par[i]);
+        // skip other detectors and missing time walk and SG elements
+        if (d.fDetector != fDetector) continue;
+        if (d.fTarget == kARTimeWalk && !nDetTW) continue;
+        if (d.fTarget == kARElementSG && !nDetSG) continue;
 
-            // read ADC pedestal
-            if (m->ReadParametersRun("Data.Pizza.E0", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetPedestal(par[i]);
+        // get the number of elements
+        Int_t n = nDet;
+        if (d.fTarget == kARTimeWalk) n = nDetTW;
+        else if (d.fTarget == kARElementSG) n = nDetSG;
 
-            // read ADC gain
-            if (m->ReadParametersRun("Data.Pizza.E1", calibration, run, par, nDet))
-                for (Int_t i = 0; i < nDet; i++) r->GetElement(i)->SetADCGain(par[i]);
+        // read the parameters
+        if (!CopyParameters(calibs, d.fData, par, n)) continue;
 
-            break;
-        }
-        case kDETECTOR_NODET:
+        // set the parameters
+        for (Int_t j = 0; j < n; j++)
         {
-            break;
+            if (d.fTarget == kARTimeWalk) (r->GetTimeWalk(j)->*d.fSetWalk)(par[j]);
+            else if (d.fTarget == kARElementSG) (rSG->GetElement(j)->*d.fSetElem)(par[j]);
+            else (r->GetElement(j)->*d.fSetElem)(par[j]);
         }
     }
 
+    // clean-up
+    if (calibs) delete calibs;
+
     // open the template file
     std::ifstream ftemp;
     ftemp.open(fTemplate);
@@ -271,3 +235,27 @@ void TCWriteARCalib::Write(const Char_t* calibFile,
     if (rSG) delete rSG;
 }
 
+//______________________________________________________________________________
+Bool_t TCWriteARCalib::CopyParameters(THashList* calibs, const Char_t* data,
+                                      Double_t* par, Int_t length)
+{
+    // Copy at most 'length' parameters of the calibration data 'data' found
+    // in the list of calibrations 'calibs' to the array 'par'. Elements of
+    // 'par' without parameter are set to 0.
+    // Return kTRUE on success, kFALSE if the calibration data was not found.
+
+    // check the list
+    if (!calibs) return kFALSE;
+
+    // get the calibration
+    TCCalibration* c = (TCCalibration*) calibs->FindObject(data);
+    if (!c) return kFALSE;
+
+    // copy the parameters
+    Int_t n = TMath::Min(length, c->GetNParameters());
+    for (Int_t i = 0; i < n; i++) par[i] = c->GetParameters()[i];
+    for (Int_t i = n; i < length; i++) par[i] = 0;
+
+    return kTRUE;
+}
+